@@ -5,10 +5,23 @@
 
 #include "test_pointer.h"
 #include "test_string.h"
+#include "test_intern_string.h"
 #include "test_vector.h"
+#include "test_array.h"
+#include "test_small_vector.h"
 #include "test_list.h"
+#include "test_intrusive_list.h"
+#include "test_deque.h"
 #include "test_hash.h"
+#include "test_flat_hash.h"
+#include "test_unordered_map.h"
 #include "test_map.h"
+#include "test_btree_map.h"
+#include "test_move.h"
+#include "test_ring.h"
+#include "test_change_log.h"
+#include "test_persist.h"
+#include "test_model.h"
 
 int main(int argc, char* argv[]) {
 	smd::SetLogHandler(
@@ -45,20 +58,40 @@ int main(int argc, char* argv[]) {
 	for (int i = 0; i < 2; i++) {
 		TestPointer test_pointer;
 		TestString test_string;
+		TestInternString test_intern_string;
 		TestList test_list;
+		TestIntrusiveList test_intrusive_list;
+		TestDeque test_deque;
 		TestVector test_vector;
+		TestArray test_array;
+		TestSmallVector test_small_vector;
 		TestHash test_hash;
+		TestFlatHash test_flat_hash;
+		TestUnorderedMap test_unordered_map;
 		TestMap test_map;
+		TestBTreeMap test_btree_map;
+		TestMove test_move;
+		TestRing test_ring;
+		TestChangeLog test_change_log;
+		TestPersist test_persist;
+		TestModel test_model;
 	}
 
 	std::string key("StartCounter");
 	smd::Slice value;
 	int count = 0;
-	if (env->SGet(key, &value)) {
+	auto mem_usage = smd::g_alloc->GetUsed();
+	const bool exist = env->SGet(key, &value);
+	assert(!env->SDel("NotExistKey"));
+	// 读操作不会分配共享内存
+	assert(mem_usage == smd::g_alloc->GetUsed());
+	if (exist) {
 		// 如果已经存在
 		count = std::stoi(value.ToString());
 		count++;
 		env->SSet(key, std::to_string(count));
+		// 覆盖已有的key不会分配共享内存
+		assert(mem_usage == smd::g_alloc->GetUsed());
 
 		SMD_LOG_INFO("%s is %d", key.data(), count);
 	} else {
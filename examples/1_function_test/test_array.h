@@ -0,0 +1,74 @@
+﻿#pragma once
+#include <smd.h>
+
+class TestArray {
+public:
+	TestArray() {
+		TestShmArray();
+		TestShmArrayNested();
+	}
+
+private:
+	void TestShmArray() {
+		smd::shm_array<int, 8> a;
+		assert(a.size() == 8);
+		assert(!a.empty());
+		for (size_t i = 0; i < a.size(); i++) {
+			// 缺省值初始化为0
+			assert(a[i] == 0);
+		}
+
+		a.fill(7);
+		assert(a.front() == 7);
+		assert(a.back() == 7);
+
+		int i = 0;
+		for (auto& element : a) {
+			element = i++;
+		}
+		assert(a[3] == 3);
+		assert(a.data() + 3 == &a[3]);
+
+		smd::shm_array<int, 8> b(a);
+		assert(b == a);
+		b[0] = 100;
+		assert(b != a);
+		b.swap(a);
+		assert(a[0] == 100);
+		assert(b[0] == 0);
+
+		SMD_LOG_INFO("TestShmArray complete");
+	}
+
+	void TestShmArrayNested() {
+		struct StEquip {
+			int64_t item_id;
+			int slot_type;
+		};
+
+		struct StRole {
+			uint64_t role_id;
+			smd::shm_array<StEquip, 16> equips;
+			smd::shm_array<smd::shm_string, 4> titles;
+		};
+
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto role = smd::g_alloc->New<StRole>();
+
+		// 装备直接存放在角色对象里，只有一次分配
+		assert(smd::g_alloc->GetUsed() - mem_usage < 2 * sizeof(StRole) + 4 * 16);
+		assert((char*)&role->equips[0] > (char*)role.Ptr());
+		assert((char*)&role->equips[15] < (char*)role.Ptr() + sizeof(StRole));
+
+		role->equips[3].item_id = 1001;
+		role->equips[3].slot_type = 3;
+		role->titles[1] = "champion";
+		assert(role->equips[3].item_id == 1001);
+		assert(role->titles[1].ToString() == "champion");
+
+		smd::g_alloc->Delete(role);
+		assert(role == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmArrayNested complete");
+	}
+};
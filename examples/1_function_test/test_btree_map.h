@@ -0,0 +1,176 @@
+﻿#pragma once
+#include <map>
+#include <algorithm>
+#include <smd.h>
+
+class TestBTreeMap {
+public:
+	TestBTreeMap() {
+		// 节点很小的时候树比较高，分裂合并的路径都能覆盖到
+		TestBTreeMapPod<smd::shm_btree_map<uint64_t, uint64_t, 64>>("small node");
+		TestBTreeMapPod<smd::shm_btree_map<uint64_t, uint64_t>>("default node");
+		TestBTreeMapString();
+		TestBTreeMapRange();
+	}
+
+private:
+	template <class Map>
+	void TestBTreeMapPod(const char* name) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<Map>();
+		std::map<uint64_t, uint64_t> ref;
+
+		std::default_random_engine generator{std::random_device{}()};
+		const size_t COUNT = 20000;
+		for (size_t i = 0; i < COUNT; i++) {
+			uint64_t key = generator() % (COUNT * 2);
+			auto res = obj->insert(std::make_pair(key, i));
+			auto ref_res = ref.insert(std::make_pair(key, i));
+			assert(res.second == ref_res.second);
+			assert(res.first->first == key && res.first->second == ref_res.first->second);
+		}
+		assert(IsEqual(*obj, ref));
+
+		// 拷贝之后互不影响
+		do {
+			Map copy(*obj);
+			assert(IsEqual(copy, ref));
+			copy.clear();
+			assert(copy.empty() && copy.begin() == copy.end());
+		} while (false);
+
+		// 随机删除，删除返回下一个元素
+		for (size_t i = 0; i < COUNT && !ref.empty(); i++) {
+			uint64_t key = generator() % (COUNT * 2);
+			auto it = obj->find(key);
+			auto it_ref = ref.find(key);
+			assert((it == obj->end()) == (it_ref == ref.end()));
+			if (it == obj->end())
+				continue;
+
+			it = obj->erase(it);
+			it_ref = ref.erase(it_ref);
+			assert((it == obj->end()) == (it_ref == ref.end()));
+			assert(it == obj->end() || it->first == it_ref->first);
+			assert(obj->size() == ref.size());
+			if (i % 1000 == 0) {
+				assert(IsEqual(*obj, ref));
+			}
+		}
+		assert(IsEqual(*obj, ref));
+
+		// 全部删除
+		for (auto it = obj->begin(); it != obj->end();) {
+			it = obj->erase(it);
+		}
+		assert(obj->empty() && obj->rbegin() == obj->rend());
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestBTreeMapPod %s complete", name);
+	}
+
+	void TestBTreeMapString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		do {
+			smd::shm_btree_map<smd::shm_string, smd::shm_string> obj;
+			std::map<std::string, std::string> ref;
+			for (int i = 0; i < 3000; i++) {
+				// 一部分key超过22个字符，放在堆上
+				std::string key = smd::util::Text::Format(i % 2 ? "key_%06d" : "long_key_with_heap_storage_%06d", i * 7 % 3000);
+				std::string value = std::to_string(i);
+				obj.insert(std::make_pair(smd::shm_string(key), smd::shm_string(value)));
+				ref.insert(std::make_pair(key, value));
+			}
+			assert(obj.size() == ref.size());
+
+			auto it_ref = ref.begin();
+			for (auto it = obj.begin(); it != obj.end(); ++it, ++it_ref) {
+				assert(it->first == it_ref->first && it->second == it_ref->second);
+			}
+
+			// 用Slice查找不用构造shm_string
+			auto used = smd::g_alloc->GetUsed();
+			assert(obj.find(smd::Slice("key_000007")) != obj.end());
+			assert(obj.find(smd::Slice("key_000007"))->second == ref["key_000007"]);
+			assert(obj.find(smd::Slice("key_999999")) == obj.end());
+			assert(obj.lower_bound(smd::Slice("key_"))->first == ref.lower_bound("key_")->first);
+			assert(used == smd::g_alloc->GetUsed());
+
+			for (int i = 0; i < 3000; i += 3) {
+				std::string key = smd::util::Text::Format(i % 2 ? "key_%06d" : "long_key_with_heap_storage_%06d", i * 7 % 3000);
+				assert(obj.erase(smd::shm_string(key)) == ref.erase(key));
+			}
+			assert(obj.size() == ref.size());
+			it_ref = ref.begin();
+			for (auto it = obj.begin(); it != obj.end(); ++it, ++it_ref) {
+				assert(it->first == it_ref->first && it->second == it_ref->second);
+			}
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestBTreeMapString complete");
+	}
+
+	void TestBTreeMapRange() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		do {
+			smd::shm_btree_map<uint64_t, uint64_t, 64> obj;
+			std::map<uint64_t, uint64_t> ref;
+			for (uint64_t i = 0; i < 500; i++) {
+				obj.insert(std::make_pair(i * 2, i));
+				ref.insert(std::make_pair(i * 2, i));
+			}
+
+			for (uint64_t key = 0; key <= 1001; key++) {
+				auto lb = obj.lower_bound(key);
+				auto ub = obj.upper_bound(key);
+				auto ref_lb = ref.lower_bound(key);
+				auto ref_ub = ref.upper_bound(key);
+				assert((lb == obj.end()) == (ref_lb == ref.end()));
+				assert((ub == obj.end()) == (ref_ub == ref.end()));
+				assert(lb == obj.end() || lb->first == ref_lb->first);
+				assert(ub == obj.end() || ub->first == ref_ub->first);
+
+				auto range = obj.equal_range(key);
+				assert(range.first == lb && range.second == ub);
+			}
+
+			// 反向遍历
+			auto rit = obj.rbegin();
+			for (auto it_ref = ref.rbegin(); it_ref != ref.rend(); ++it_ref, ++rit) {
+				assert(rit != obj.rend() && rit->first == it_ref->first);
+			}
+			assert(rit == obj.rend());
+
+			// 删除一段范围
+			auto it = obj.erase(obj.lower_bound(200), obj.upper_bound(400));
+			assert(it->first == 402);
+			ref.erase(ref.lower_bound(200), ref.upper_bound(400));
+			assert(IsEqual(obj, ref));
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestBTreeMapRange complete");
+	}
+
+	template <class Map>
+	static bool IsEqual(Map& l, const std::map<uint64_t, uint64_t>& r) {
+		assert(l.size() == r.size());
+		auto it = l.begin();
+		for (auto it_ref = r.begin(); it_ref != r.end(); ++it_ref, ++it) {
+			assert(it != l.end());
+			assert(it->first == it_ref->first && it->second == it_ref->second);
+		}
+		assert(it == l.end());
+
+		// 反向遍历得到的顺序相反
+		auto rit = l.rbegin();
+		for (auto it_ref = r.rbegin(); it_ref != r.rend(); ++it_ref, ++rit) {
+			assert(rit->first == it_ref->first);
+		}
+		assert(rit == l.rend());
+		return true;
+	}
+};
@@ -0,0 +1,125 @@
+﻿#pragma once
+#include <thread>
+#include <vector>
+#include <smd.h>
+
+class TestChangeLog {
+public:
+	TestChangeLog() {
+		TestChangeLogBatch();
+		TestChangeLogOverflow();
+		TestChangeLogThread();
+	}
+
+private:
+	enum { kTablePlayers = 1, kTableItems = 2 };
+
+	void TestChangeLogBatch() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			auto log = smd::g_alloc->New<smd::shm_change_log>(1024);
+			static_assert(sizeof(smd::ChangeRecord) == 24, "change record should stay compact");
+
+			// 写入不分配共享内存
+			auto used = smd::g_alloc->GetUsed();
+			for (int64_t i = 0; i < 600; i++) {
+				log->emit(kTablePlayers, smd::ChangeOp::kUpdate, i % 100);
+				if (i % 10 == 0) {
+					log->emit(kTableItems, smd::ChangeOp::kInsert, i % 100, i);
+				}
+			}
+			assert(used == smd::g_alloc->GetUsed() && log->size() == 660);
+
+			// 按批读取，每批不超过256条
+			std::vector<smd::ChangeRecord> all;
+			size_t batches = 0;
+			auto n = log->consume([&](const smd::ChangeRecord* records, size_t count) {
+				assert(count <= 256);
+				all.insert(all.end(), records, records + count);
+				++batches;
+			});
+			assert(n == 660 && all.size() == 660 && batches == 3 && log->size() == 0);
+			assert(all[0].table == kTablePlayers && all[0].key == 0 && all[0].op == smd::ChangeOp::kUpdate);
+			assert(all[1].table == kTableItems && all[1].sub_key == 0 && all[1].op == smd::ChangeOp::kInsert);
+			assert(all[0].same_object(all[1]) == false && all[0].same_object(all[all.size() - 1]) == false);
+
+			// 最多取max_count条
+			for (int64_t i = 0; i < 10; i++) {
+				log->emit(kTablePlayers, smd::ChangeOp::kErase, i);
+			}
+			assert(log->consume([](const smd::ChangeRecord*, size_t) {}, 4) == 4 && log->size() == 6);
+
+			// 空的时候等待超时
+			log->consume([](const smd::ChangeRecord*, size_t) {});
+			assert(log->consume([](const smd::ChangeRecord*, size_t) {}, SIZE_MAX, 10) == 0);
+			assert(log->take_overflow() == 0);
+			smd::g_alloc->Delete(log);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestChangeLogBatch complete");
+	}
+
+	// 消费方跟不上时写入方不阻塞，只记录溢出次数
+	void TestChangeLogOverflow() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			auto log = smd::g_alloc->New<smd::shm_change_log>(64);
+			for (int64_t i = 0; i < 100; i++) {
+				log->emit(kTablePlayers, smd::ChangeOp::kUpdate, i);
+			}
+			assert(log->size() == 64 && log->take_overflow() == 36 && log->take_overflow() == 0);
+
+			int64_t expect = 0;
+			log->consume([&expect](const smd::ChangeRecord* records, size_t count) {
+				for (size_t i = 0; i < count; i++) {
+					assert(records[i].key == expect++);
+				}
+			});
+			assert(expect == 64);
+			smd::g_alloc->Delete(log);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestChangeLogOverflow complete");
+	}
+
+	// 写入和读取在不同的线程，读到的加上溢出的等于写入的
+	void TestChangeLogThread() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			const int64_t COUNT = 200000;
+			auto log = smd::g_alloc->New<smd::shm_change_log>(4096);
+			std::atomic<bool> done{false};
+			std::thread producer([&log, &done, COUNT] {
+				for (int64_t i = 0; i < COUNT; i++) {
+					log->emit(kTablePlayers, smd::ChangeOp::kUpdate, i);
+				}
+				done = true;
+			});
+
+			int64_t consumed = 0;
+			int64_t last = -1;
+			while (!done || log->size() > 0) {
+				consumed += log->consume(
+					[&last](const smd::ChangeRecord* records, size_t count) {
+						for (size_t i = 0; i < count; i++) {
+							assert(records[i].key > last);
+							last = records[i].key;
+						}
+					},
+					SIZE_MAX, 1);
+			}
+			producer.join();
+			consumed += log->consume([](const smd::ChangeRecord*, size_t) {});
+			assert(consumed + int64_t(log->take_overflow()) == COUNT);
+			smd::g_alloc->Delete(log);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestChangeLogThread complete");
+	}
+};
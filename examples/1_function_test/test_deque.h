@@ -0,0 +1,203 @@
+﻿#pragma once
+#include <deque>
+#include <string>
+#include <algorithm>
+#include <smd.h>
+
+class TestDeque {
+public:
+	TestDeque() {
+		TestDequePod();
+		TestDequeString();
+		TestDequeQueue();
+		TestDequeIterator();
+	}
+
+private:
+	template <class T, size_t B, class U>
+	static bool IsEqual(const smd::shm_deque<T, B>& d, const std::deque<U>& r) {
+		if (d.size() != r.size())
+			return false;
+
+		size_t i = 0;
+		for (auto it = d.begin(); it != d.end(); ++it, ++i) {
+			if (!(*it == r[i]) || !(d[i] == r[i]))
+				return false;
+		}
+		return i == r.size();
+	}
+
+	// 块比较小，随机在两端增删，经常跨过块的边界
+	void TestDequePod() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_deque<int64_t, 64> d;
+			std::deque<int64_t> ref;
+			assert(d.empty() && d.begin() == d.end());
+			assert(mem_usage == smd::g_alloc->GetUsed());
+
+			for (int64_t i = 0; i < 20000; i++) {
+				switch (std::rand() % 5) {
+				case 0:
+				case 1:
+					d.push_back(i);
+					ref.push_back(i);
+					break;
+				case 2:
+					d.push_front(i);
+					ref.push_front(i);
+					break;
+				case 3:
+					if (!ref.empty()) {
+						d.pop_back();
+						ref.pop_back();
+					}
+					break;
+				default:
+					if (!ref.empty()) {
+						d.pop_front();
+						ref.pop_front();
+					}
+					break;
+				}
+				assert(d.size() == ref.size());
+				if (!ref.empty()) {
+					assert(d.front() == ref.front() && d.back() == ref.back());
+				}
+			}
+			assert(IsEqual(d, ref));
+
+			// 弹空之后还可以继续使用，clear把块和中控数组都还回去
+			while (!d.empty()) {
+				d.pop_front();
+			}
+			d.push_front(1);
+			d.push_back(2);
+			assert(d.size() == 2 && d[0] == 1 && d[1] == 2);
+			d.clear();
+			assert(mem_usage == smd::g_alloc->GetUsed());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestDequePod complete");
+	}
+
+	void TestDequeString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_deque<smd::shm_string> d;
+			std::deque<std::string> ref;
+			for (int i = 0; i < 1000; i++) {
+				std::string s = smd::util::Text::Format("TestText%04d", i) + std::string(i % 50, 'x');
+				if (i % 3 == 0) {
+					d.emplace_front(s);
+					ref.push_front(s);
+				} else {
+					d.push_back(smd::shm_string(s));
+					ref.push_back(s);
+				}
+			}
+			assert(IsEqual(d, ref));
+
+			for (int i = 0; i < 300; i++) {
+				d.pop_front();
+				ref.pop_front();
+				d.pop_back();
+				ref.pop_back();
+			}
+			assert(IsEqual(d, ref));
+
+			// 拷贝和移动
+			smd::shm_deque<smd::shm_string> copy(d);
+			assert(IsEqual(copy, ref));
+			auto& front = d.front();
+			smd::shm_deque<smd::shm_string> moved(std::move(d));
+			assert(d.empty() && &moved.front() == &front && IsEqual(moved, ref));
+			d = copy;
+			copy = std::move(moved);
+			assert(moved.empty() && IsEqual(d, ref) && IsEqual(copy, ref));
+
+			d.emplace_back("again");
+			assert(d.back() == "again" && d.size() == ref.size() + 1);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestDequeString complete");
+	}
+
+	// 先进先出的队列长度稳定之后，腾空的块挪到尾部复用，不再分配
+	void TestDequeQueue() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_deque<int64_t> q;
+			const size_t block = smd::shm_deque<int64_t>::kBlockSize;
+			int64_t head = 0;
+			int64_t tail = 0;
+			for (size_t i = 0; i < block * 3; i++) {
+				q.push_back(tail++);
+			}
+
+			// 先转一圈，之后的内存占用不再变化
+			auto used = smd::g_alloc->GetUsed();
+			for (size_t i = 0; i < block * 20; i++) {
+				if (i == block * 2) {
+					used = smd::g_alloc->GetUsed();
+				}
+				q.push_back(tail++);
+				assert(q.front() == head++);
+				q.pop_front();
+			}
+			assert(q.size() == block * 3 && q.back() == tail - 1);
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 引用不会因为两端的增删而失效
+			auto& value = q[block];
+			auto expect = value;
+			for (size_t i = 0; i < block * 4; i++) {
+				q.push_back(0);
+				q.push_front(0);
+			}
+			assert(&value == &q[block * 5] && value == expect);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestDequeQueue complete");
+	}
+
+	void TestDequeIterator() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_deque<int, 32> d;
+			for (int i = 0; i < 100; i++) {
+				d.push_front(i);
+			}
+
+			// 随机访问迭代器可以直接用于标准库的算法
+			std::sort(d.begin(), d.end());
+			for (int i = 0; i < 100; i++) {
+				assert(d[i] == i);
+			}
+			assert(std::lower_bound(d.begin(), d.end(), 42) - d.begin() == 42);
+			assert(*std::find(d.begin(), d.end(), 77) == 77);
+
+			auto it = d.end();
+			--it;
+			assert(*it == 99 && *(it - 50) == 49 && it[-99] == 0);
+			it -= 99;
+			assert(it == d.begin());
+
+			int sum = 0;
+			for (auto& v : d) {
+				sum += v;
+			}
+			assert(sum == 99 * 100 / 2);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestDequeIterator complete");
+	}
+};
@@ -0,0 +1,196 @@
+﻿#pragma once
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <smd.h>
+
+class TestFlatHash {
+public:
+	TestFlatHash() {
+		TestFlatHashSetPod();
+		TestFlatHashSetString();
+		TestFlatHashMap();
+		TestFlatHashChurn();
+	}
+
+private:
+	void TestFlatHashSetPod() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_set<uint64_t>>();
+		std::unordered_set<uint64_t> ref;
+
+		std::vector<uint64_t> vRoleIds;
+		const size_t COUNT = 10000;
+		for (size_t i = 0; i < COUNT; i++) {
+			vRoleIds.push_back(i * 7919);
+		}
+
+		std::default_random_engine generator{std::random_device{}()};
+		std::shuffle(vRoleIds.begin(), vRoleIds.end(), generator);
+
+		for (size_t i = 0; i < vRoleIds.size(); i++) {
+			auto res = obj->insert(vRoleIds[i]);
+			assert(res.second);
+			assert(*res.first == vRoleIds[i]);
+			ref.insert(vRoleIds[i]);
+		}
+
+		// 重复插入失败
+		assert(!obj->insert(vRoleIds[0]).second);
+		assert(IsEqual(*obj, ref));
+		assert(obj->size() == COUNT);
+		assert(obj->load_factor() <= 0.875f);
+		assert(obj->contains(3 * 7919));
+		assert(!obj->contains(3));
+
+		std::shuffle(vRoleIds.begin(), vRoleIds.end(), generator);
+		for (size_t i = 0; i < vRoleIds.size() / 2; i++) {
+			assert(obj->erase(vRoleIds[i]) == 1);
+			assert(obj->erase(vRoleIds[i]) == 0);
+			ref.erase(vRoleIds[i]);
+		}
+		assert(IsEqual(*obj, ref));
+
+		// 边遍历边删除
+		for (auto it = obj->begin(); it != obj->end();) {
+			if (*it % 2 == 0) {
+				ref.erase(*it);
+				it = obj->erase(it);
+			} else {
+				++it;
+			}
+		}
+		assert(IsEqual(*obj, ref));
+
+		do {
+			smd::shm_flat_hash_set<uint64_t> copy(*obj);
+			assert(IsEqual(copy, ref));
+		} while (false);
+
+		obj->clear();
+		assert(obj->size() == 0);
+		assert(obj->begin() == obj->end());
+
+		smd::g_alloc->Delete(obj);
+		assert(obj == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestFlatHashSetPod complete");
+	}
+
+	void TestFlatHashSetString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_set<smd::shm_string>>();
+
+		const int COUNT = 1000;
+		for (int i = 0; i < COUNT; i++) {
+			obj->emplace(GetKey(i));
+		}
+		assert(obj->size() == COUNT);
+		for (int i = 0; i < COUNT; i++) {
+			auto it = obj->find(smd::shm_string(GetKey(i)));
+			assert(it != obj->end());
+			assert(it->ToString() == GetKey(i));
+		}
+		assert(obj->find(smd::shm_string(GetKey(COUNT))) == obj->end());
+
+		smd::g_alloc->Delete(obj);
+		assert(obj == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestFlatHashSetString complete");
+	}
+
+	void TestFlatHashMap() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_map<uint64_t, smd::shm_string>>();
+		std::unordered_map<uint64_t, std::string> ref;
+
+		const int COUNT = 1000;
+		for (int i = 0; i < COUNT; i++) {
+			auto res = obj->try_emplace(i, GetKey(i));
+			assert(res.second);
+			ref[i] = GetKey(i);
+		}
+
+		// 已存在的时候不会构造新的值
+		auto res = obj->try_emplace(5, "not used");
+		assert(!res.second);
+		assert(res.first->second.ToString() == GetKey(5));
+
+		// 已存在的时候覆盖
+		res = obj->insert_or_assign(5, smd::shm_string("five"));
+		assert(!res.second);
+		ref[5] = "five";
+		res = obj->insert_or_assign(COUNT, smd::shm_string("new"));
+		assert(res.second);
+		ref[COUNT] = "new";
+
+		(*obj)[7] = std::string("seven");
+		ref[7] = "seven";
+		(*obj)[COUNT + 1];
+		ref[COUNT + 1];
+
+		assert(obj->size() == ref.size());
+		for (auto it = obj->begin(); it != obj->end(); ++it) {
+			assert(ref[it->first] == it->second.ToString());
+		}
+
+		smd::g_alloc->Delete(obj);
+		assert(obj == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestFlatHashMap complete");
+	}
+
+	// 反复插入删除，已删除的槽位要能被回收
+	void TestFlatHashChurn() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_set<uint64_t>>();
+		std::unordered_set<uint64_t> ref;
+
+		for (int round = 0; round < 100000; round++) {
+			auto key = smd::util::Random::RandomInt<uint64_t>(0, 2000);
+			if (ref.count(key)) {
+				assert(obj->erase(key) == 1);
+				ref.erase(key);
+			} else {
+				assert(obj->insert(key).second);
+				ref.insert(key);
+			}
+		}
+
+		assert(IsEqual(*obj, ref));
+		assert(obj->capacity() <= 4096);
+
+		smd::g_alloc->Delete(obj);
+		assert(obj == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestFlatHashChurn complete");
+	}
+
+private:
+	static std::string GetKey(int key) {
+		return smd::util::Text::Format("Key%05d", key);
+	}
+
+	//测试专用
+	bool IsEqual(const smd::shm_flat_hash_set<uint64_t>& l, const std::unordered_set<uint64_t>& r) {
+		if (l.size() != r.size()) {
+			assert(false);
+		}
+
+		size_t count = 0;
+		for (auto it = l.begin(); it != l.end(); ++it) {
+			++count;
+			if (r.find(*it) == r.end()) {
+				assert(false);
+			}
+		}
+
+		for (auto key : r) {
+			if (!l.contains(key)) {
+				assert(false);
+			}
+		}
+
+		return count == r.size();
+	}
+};
@@ -8,6 +8,7 @@ public:
 	TestHash() {
 		TestHashPod();
 		TestHashString();
+		TestHashRehash();
 	}
 
 private:
@@ -134,6 +135,66 @@ private:
 		SMD_LOG_INFO("TestMapPod complete");
 	}
 
+	void TestHashRehash() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_hash<uint64_t>>();
+		std::unordered_set<uint64_t> ref;
+
+		// 插入过程中会多次触发渐进式rehash，任何时候两张表中的元素都能查到
+		const uint64_t COUNT = 5000;
+		bool rehashed = false;
+		for (uint64_t i = 0; i < COUNT; i++) {
+			assert(obj->insert(i * 7).second);
+			assert(!obj->insert(i * 7).second);
+			ref.insert(i * 7);
+			rehashed = rehashed || obj->is_rehashing();
+
+			if (obj->is_rehashing()) {
+				assert(obj->find(0) != obj->end());
+				assert(obj->find(i * 7) != obj->end());
+				assert(obj->find(i * 7 + 1) == obj->end());
+			}
+		}
+		assert(rehashed);
+		assert(obj->size() == COUNT);
+		assert(IsEqual(*obj, ref));
+
+		// 迁移到一半的时候遍历、删除都要正确
+		obj->rehash(obj->bucket_count() * 2);
+		assert(!obj->is_rehashing());
+		for (uint64_t i = COUNT; !obj->is_rehashing(); i++) {
+			obj->insert(i * 7);
+			ref.insert(i * 7);
+		}
+		assert(obj->is_rehashing());
+		assert(obj->rehash_step(1));
+
+		for (auto it = obj->begin(); it != obj->end();) {
+			if (*it % 2 == 0) {
+				ref.erase(*it);
+				it = obj->erase(it);
+			} else {
+				++it;
+			}
+		}
+		assert(obj->is_rehashing());
+		assert(IsEqual(*obj, ref));
+
+		assert(obj->erase(uint64_t(7)));
+		assert(!obj->erase(uint64_t(7)));
+		ref.erase(7);
+
+		// 空闲的时候主动迁移
+		while (obj->rehash_step(16)) {
+		}
+		assert(!obj->is_rehashing());
+		assert(IsEqual(*obj, ref));
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestHashRehash complete");
+	}
+
 private:
 
 	static std::string GetKey(int key) {
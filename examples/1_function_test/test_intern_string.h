@@ -0,0 +1,137 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <smd.h>
+
+class TestInternString {
+public:
+	TestInternString() {
+		// 池中的bucket只增不减，先预留好，后面才能用GetUsed检查泄漏
+		smd::g_string_pool->reserve(smd::g_string_pool->size() + 1024);
+
+		TestInternBasic();
+		TestInternContainer();
+		TestInternMemory();
+	}
+
+private:
+	void TestInternBasic() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto pool_size = smd::g_string_pool->size();
+
+		do {
+			// 空字符串不占用池中的条目
+			smd::shm_intern_string empty;
+			smd::shm_intern_string empty2("");
+			assert(empty.empty() && empty == empty2 && empty == "");
+			assert(strcmp(empty.data(), "") == 0);
+			assert(mem_usage == smd::g_alloc->GetUsed());
+
+			// 内容相同的字符串共享同一个条目
+			smd::shm_intern_string a("LongSword");
+			smd::shm_intern_string b(std::string("LongSword"));
+			assert(a == b && a.data() == b.data());
+			assert(a.ref_count() == 2);
+			assert(smd::g_string_pool->size() == pool_size + 1);
+
+			smd::shm_intern_string c("ShortSword");
+			assert(a != c && (a < c) == (a.ToString() < c.ToString()));
+			assert(a == smd::Slice("LongSword") && c == "ShortSword");
+
+			// 拷贝只增加引用计数
+			auto used = smd::g_alloc->GetUsed();
+			smd::shm_intern_string d(c);
+			assert(d == c && c.ref_count() == 2);
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 重新赋值之后旧内容的引用计数减少
+			b = c;
+			assert(a.ref_count() == 1 && c.ref_count() == 3);
+			b = "LongSword";
+			assert(a.ref_count() == 2 && c.ref_count() == 2);
+			b = b;
+			assert(a.ref_count() == 2);
+
+			d = smd::Slice("");
+			assert(d.empty() && c.ref_count() == 1);
+		} while (false);
+
+		// 所有引用都释放之后从池中删除
+		assert(smd::g_string_pool->size() == pool_size);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestInternBasic complete");
+	}
+
+	void TestInternContainer() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto pool_size = smd::g_string_pool->size();
+
+		do {
+			smd::shm_vector<smd::shm_intern_string> v;
+			for (int i = 0; i < 1000; i++) {
+				v.push_back(smd::shm_intern_string("guild_" + std::to_string(i % 10)));
+			}
+			assert(smd::g_string_pool->size() == pool_size + 10);
+			for (int i = 0; i < 1000; i++) {
+				assert(v[i] == "guild_" + std::to_string(i % 10));
+				assert(v[i].ref_count() == 100);
+			}
+
+			// 作为key使用
+			smd::shm_map<smd::shm_intern_string, int> m;
+			smd::shm_unordered_map<smd::shm_intern_string, int> um;
+			for (int i = 0; i < 1000; i++) {
+				m.insert(std::make_pair(v[i], i));
+				um.insert(std::make_pair(v[i], i));
+			}
+			assert(m.size() == 10 && um.size() == 10);
+			assert(um.find(smd::Slice("guild_3")) != um.end());
+			assert(um.find(smd::Slice("guild_3"))->second == 3);
+			assert(um.find(smd::Slice("guild_x")) == um.end());
+		} while (false);
+
+		assert(smd::g_string_pool->size() == pool_size);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestInternContainer complete");
+	}
+
+	void TestInternMemory() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		const size_t COUNT = 10000;
+
+		// 内容大量重复的长字符串
+		std::vector<std::string> names;
+		for (int i = 0; i < 16; i++) {
+			names.push_back("item_type_name_for_equipment_" + std::to_string(i));
+		}
+
+		size_t plain_used = 0;
+		do {
+			smd::shm_vector<smd::shm_string> v;
+			v.reserve(COUNT);
+			for (size_t i = 0; i < COUNT; i++) {
+				v.push_back(smd::shm_string(names[i % names.size()]));
+			}
+			plain_used = smd::g_alloc->GetUsed() - mem_usage;
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		size_t intern_used = 0;
+		do {
+			smd::shm_vector<smd::shm_intern_string> v;
+			v.reserve(COUNT);
+			for (size_t i = 0; i < COUNT; i++) {
+				v.push_back(smd::shm_intern_string(names[i % names.size()]));
+			}
+			intern_used = smd::g_alloc->GetUsed() - mem_usage;
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("shm_string: %llu bytes, shm_intern_string: %llu bytes", plain_used, intern_used);
+		assert(intern_used * 2 < plain_used);
+
+		SMD_LOG_INFO("TestInternMemory complete");
+	}
+};
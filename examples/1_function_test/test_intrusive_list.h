@@ -0,0 +1,153 @@
+﻿#pragma once
+#include <vector>
+#include <smd.h>
+
+class TestIntrusiveList {
+public:
+	TestIntrusiveList() {
+		TestIntrusiveBasic();
+		TestIntrusiveOnline();
+	}
+
+private:
+	struct OnlineTag {};
+	struct GuildTag {};
+
+	// 同时挂在在线/离线列表和帮派成员列表上
+	struct Player
+		: smd::shm_list_hook<OnlineTag>
+		, smd::shm_list_hook<GuildTag> {
+		int64_t player_id = 0;
+		smd::shm_string name;
+
+		explicit Player(int64_t id)
+			: player_id(id)
+			, name(smd::util::Text::Format("Player%020lld", (long long)id)) {}
+	};
+
+	typedef smd::shm_intrusive_list<Player, OnlineTag> OnlineList;
+	typedef smd::shm_intrusive_list<Player, GuildTag> GuildList;
+
+	static std::vector<int64_t> Ids(OnlineList& l) {
+		std::vector<int64_t> ids;
+		for (auto& p : l) {
+			ids.push_back(p.player_id);
+		}
+		return ids;
+	}
+
+	void TestIntrusiveBasic() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_unordered_map<int64_t, Player> players;
+			for (int64_t i = 0; i < 5; i++) {
+				players.try_emplace(i, i);
+			}
+
+			auto used = smd::g_alloc->GetUsed();
+			OnlineList l;
+			l.push_back(players.find(1)->second);
+			l.push_back(players.find(2)->second);
+			l.push_front(players.find(0)->second);
+			l.insert(OnlineList::iterator_to(players.find(2)->second), players.find(3)->second);
+			assert(l.size() == 4 && Ids(l) == std::vector<int64_t>({ 0, 1, 3, 2 }));
+			assert(l.front().player_id == 0 && l.back().player_id == 2);
+
+			// 摘下中间的元素
+			l.remove(players.find(1)->second);
+			assert(l.size() == 3 && Ids(l) == std::vector<int64_t>({ 0, 3, 2 }));
+
+			// 同一个链表内调整顺序
+			l.splice(l.begin(), l, players.find(2)->second);
+			assert(Ids(l) == std::vector<int64_t>({ 2, 0, 3 }));
+			l.splice(l.end(), l, players.find(2)->second);
+			assert(Ids(l) == std::vector<int64_t>({ 0, 3, 2 }));
+
+			// 倒着遍历
+			auto it = OnlineList::iterator_to(l.back());
+			assert((it--)->player_id == 2 && (it--)->player_id == 3 && it->player_id == 0);
+
+			l.pop_front();
+			assert(Ids(l) == std::vector<int64_t>({ 3, 2 }));
+
+			// 链表本身不分配共享内存
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 拷贝出来的元素不在任何链表中
+			auto& copy = players.try_emplace(5, players.find(3)->second).first->second;
+			assert(copy.smd::shm_list_hook<OnlineTag>::hook_next == smd::shm_nullptr);
+			l.push_back(copy);
+			assert(l.size() == 3 && l.back().player_id == 3);
+			l.pop_back();
+			l.clear();
+			assert(l.empty() && l.begin() == l.end());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestIntrusiveBasic complete");
+	}
+
+	// 玩家上下线在两个列表之间移动，同时还在帮派列表中
+	void TestIntrusiveOnline() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			const int64_t COUNT = 100;
+			std::vector<smd::shm_pointer<Player>> players;
+			for (int64_t i = 0; i < COUNT; i++) {
+				players.push_back(smd::g_alloc->New<Player>(i));
+			}
+
+			auto lists = smd::g_alloc->New<OnlineList>();
+			auto offline = smd::g_alloc->New<OnlineList>();
+			auto guild = smd::g_alloc->New<GuildList>();
+			OnlineList& online = *lists;
+			for (auto& p : players) {
+				offline->push_back(*p);
+				if (p->player_id % 2 == 0) {
+					guild->push_back(*p);
+				}
+			}
+
+			auto used = smd::g_alloc->GetUsed();
+			for (int64_t i = 0; i < COUNT; i += 3) {
+				online.splice(online.end(), *offline, *players[i]);
+			}
+			assert(online.size() == 34 && offline->size() == 66);
+			assert(online.front().player_id == 0 && online.back().player_id == 99);
+			for (auto& p : *offline) {
+				assert(p.player_id % 3 != 0);
+			}
+
+			// 帮派列表不受影响
+			assert(guild->size() == 50);
+			int64_t expect = 0;
+			for (auto& p : *guild) {
+				assert(p.player_id == expect);
+				expect += 2;
+			}
+
+			// 全部下线
+			offline->splice(offline->begin(), online);
+			assert(online.empty() && offline->size() == COUNT && offline->front().player_id == 0);
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 移动之后元素还在原来的位置
+			OnlineList moved(std::move(*offline));
+			assert(offline->empty() && moved.size() == COUNT);
+			moved.clear();
+			assert(players[0]->smd::shm_list_hook<OnlineTag>::hook_next == smd::shm_nullptr);
+
+			smd::g_alloc->Delete(guild);
+			smd::g_alloc->Delete(offline);
+			smd::g_alloc->Delete(lists);
+			for (auto& p : players) {
+				smd::g_alloc->Delete(p);
+			}
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestIntrusiveOnline complete");
+	}
+};
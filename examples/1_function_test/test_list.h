@@ -8,6 +8,8 @@ public:
 		TestShmList();
 		TestListEqual();
 		TestShmListPod();
+		TestListNodePool();
+		TestListSplice();
 	}
 
 private:
@@ -154,6 +156,133 @@ private:
 		SMD_LOG_INFO("TestListEqual complete");
 	}
 
+	// 节点从链表自己的节点池中分配，删除的节点会被复用
+	void TestListNodePool() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_list<int64_t> a;
+			smd::shm_list<int64_t> b;
+			for (int64_t i = 0; i < 100; i++) {
+				a.push_back(i);
+				b.push_back(i);
+			}
+
+			auto used = smd::g_alloc->GetUsed();
+			for (int i = 0; i < 50; i++) {
+				a.pop_front();
+			}
+			for (int64_t i = 0; i < 50; i++) {
+				a.push_back(i);
+			}
+			assert(a.size() == 100 && used == smd::g_alloc->GetUsed());
+
+			// 移动之后节点池跟着链表一起走
+			smd::shm_list<int64_t> c(std::move(a));
+			assert(c.size() == 100 && c.front() == 50 && a.empty());
+			c.clear();
+			b.clear();
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestListNodePool complete");
+	}
+
+	void TestListSplice() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			// 空链表不分配哨兵节点
+			smd::shm_list<int64_t> a;
+			assert(mem_usage == smd::g_alloc->GetUsed());
+
+			std::list<int64_t> ref;
+			for (int64_t i = 0; i < 10; i++) {
+				a.push_back(i);
+				ref.push_back(i);
+			}
+			a.insert(a.begin(), -1);
+			ref.insert(ref.begin(), -1);
+			assert(a.size() == 11 && IsEqual(a, ref));
+
+			// 同一个链表内移动元素
+			auto it = a.begin();
+			for (int i = 0; i < 5; i++) {
+				++it;
+			}
+			a.splice(a.begin(), it);
+			ref.splice(ref.begin(), ref, std::next(ref.begin(), 5));
+			assert(IsEqual(a, ref));
+
+			auto first = a.begin();
+			++first;
+			auto last = first;
+			for (int i = 0; i < 4; i++) {
+				++last;
+			}
+			a.splice(a.end(), first, last);
+			ref.splice(ref.end(), ref, std::next(ref.begin()), std::next(ref.begin(), 5));
+			assert(IsEqual(a, ref));
+
+			// 移到自己前面或者自己后面一个元素前面，位置不变，比如LRU把已经在最前面的元素移到最前面
+			auto nth = [&a](int n) {
+				auto res = a.begin();
+				for (int i = 0; i < n; i++) {
+					++res;
+				}
+				return res;
+			};
+			a.splice(a.begin(), a.begin());
+			assert(a.size() == ref.size() && IsEqual(a, ref));
+			a.splice(nth(1), a.begin());
+			assert(a.size() == ref.size() && IsEqual(a, ref));
+			a.splice(a.end(), nth(int(a.size()) - 1));
+			assert(a.size() == ref.size() && IsEqual(a, ref));
+			a.splice(a.begin(), a.begin(), nth(3));
+			a.splice(nth(3), a.begin(), nth(3));
+			assert(a.size() == ref.size() && IsEqual(a, ref));
+
+			// 最后一个移到最前面
+			a.splice(a.begin(), nth(int(a.size()) - 1));
+			ref.splice(ref.begin(), ref, std::prev(ref.end()));
+			assert(a.size() == ref.size() && IsEqual(a, ref));
+
+			// 整个链表接过来，节点池也一起合并，不需要分配
+			smd::shm_list<int64_t> b;
+			std::list<int64_t> ref_b;
+			for (int64_t i = 100; i < 120; i++) {
+				b.push_back(i);
+				ref_b.push_back(i);
+			}
+			b.pop_front();
+			ref_b.pop_front();
+			auto used = smd::g_alloc->GetUsed();
+			auto pos = a.begin();
+			++pos;
+			a.splice(pos, b);
+			ref.splice(std::next(ref.begin()), ref_b);
+			assert(b.empty() && b.size() == 0 && IsEqual(a, ref));
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 合并过来的节点和空闲节点都能正常释放和复用
+			for (int i = 0; i < 10; i++) {
+				a.pop_back();
+				ref.pop_back();
+			}
+			for (int64_t i = 0; i < 10; i++) {
+				a.push_front(i);
+				ref.push_front(i);
+			}
+			assert(IsEqual(a, ref) && used == smd::g_alloc->GetUsed());
+
+			b.push_back(1);
+			assert(b.size() == 1 && b.front() == 1 && b.back() == 1);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestListSplice complete");
+	}
+
 	void TestShmListPod() {
 		struct StMyData {
 			uint64_t role_id_;
@@ -181,7 +310,8 @@ private:
 
 private:
 	//测试专用
-	bool IsEqual(smd::shm_list<smd::shm_string>& l, const std::list<std::string>& r) {
+	template <class T, class U>
+	bool IsEqual(smd::shm_list<T>& l, const std::list<U>& r) {
 		if (l.size() != r.size()) {
 			assert(false);
 		}
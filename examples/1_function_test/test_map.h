@@ -9,6 +9,13 @@ public:
 	TestMap() {
 		TestMapPod();
 		TestMapString();
+		TestMapKeyPrefix();
+		TestMapNodePool();
+		TestMapRank();
+		TestMapRange();
+		TestMapBuild();
+		TestMapEmplace<smd::shm_map<uint64_t, Counted>>("shm_map");
+		TestMapEmplace<smd::shm_btree_map<uint64_t, Counted>>("shm_btree_map");
 	}
 
 private:
@@ -81,6 +88,426 @@ private:
 		SMD_LOG_INFO("TestMapString complete");
 	}
 
+	// 节点中缓存了key的前8个字节，前缀相同、长度不足8、带0和高位字节的key都要和std::map的顺序一致
+	void TestMapKeyPrefix() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_map<smd::shm_string, smd::shm_string> obj;
+			std::map<std::string, std::string> ref;
+
+			std::vector<std::string> keys;
+			const std::string stems[] = { "", "a", "abcdefg", "abcdefgh", "abcdefghi", std::string("ab\0", 3),
+				std::string("ab\0\0\0\0\0\0\0", 9), "\xff\xfe", "\x80", "player_000000000000000000000000" };
+			for (const auto& stem : stems) {
+				keys.push_back(stem);
+				for (int i = 0; i < 20; i++) {
+					keys.push_back(stem + std::to_string(i));
+					keys.push_back(stem + std::string(1, char(i * 13)));
+				}
+			}
+
+			std::default_random_engine generator{ std::random_device{}() };
+			std::shuffle(keys.begin(), keys.end(), generator);
+			for (const auto& key : keys) {
+				auto res = obj.insert(std::make_pair(smd::shm_string(key), smd::shm_string(key)));
+				assert(res.second == ref.insert(std::make_pair(key, key)).second);
+			}
+			assert(IsEqual(obj, ref));
+
+			for (const auto& key : keys) {
+				assert(obj.find(key) != obj.end() && obj.find(smd::Slice(key))->second == key);
+				assert(obj.rank(smd::Slice(key)) == size_t(std::distance(ref.begin(), ref.lower_bound(key))));
+				auto probe = key + "\x01";
+				auto it = obj.upper_bound(smd::Slice(probe));
+				auto it_ref = ref.upper_bound(probe);
+				assert((it == obj.end()) == (it_ref == ref.end()));
+				assert(it == obj.end() || it->first == it_ref->first);
+			}
+			assert(obj.find("abcdefgh") != obj.end() && obj.find("abcdefgz") == obj.end());
+
+			// 删除有两个孩子的节点时会和前驱交换元素，缓存的前缀也要跟着更新
+			std::shuffle(keys.begin(), keys.end(), generator);
+			for (size_t i = 0; i < keys.size() / 2; i++) {
+				assert(obj.erase(smd::shm_string(keys[i])) == ref.erase(keys[i]));
+			}
+			assert(IsEqual(obj, ref));
+			for (size_t i = 0; i < keys.size(); i++) {
+				assert((obj.find(keys[i]) != obj.end()) == (ref.count(keys[i]) == 1));
+			}
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMapKeyPrefix complete");
+	}
+
+	// 两个map交替插入，各自的节点仍然从自己的节点池中连续分配
+	void TestMapNodePool() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			typedef smd::RBTreeNode<std::pair<uint64_t, uint64_t>> node_type;
+			smd::shm_map<uint64_t, uint64_t> a;
+			smd::shm_map<uint64_t, uint64_t> b;
+			const uint64_t COUNT = 256;
+			for (uint64_t i = 0; i < COUNT; i++) {
+				a.insert(std::make_pair(i, i));
+				b.insert(std::make_pair(i, i));
+			}
+
+			// 按顺序插入的节点按顺序遍历，除了换块的地方，相邻元素的地址都是连续的
+			size_t adjacent = 0;
+			const char* prev = nullptr;
+			for (auto& kv : a) {
+				const char* cur = (const char*)&kv;
+				if (prev != nullptr && cur - prev == ptrdiff_t(sizeof(node_type))) {
+					++adjacent;
+				}
+				prev = cur;
+			}
+			assert(adjacent + 16 > COUNT);
+
+			// 删除的节点放回空闲链表，再插入时直接复用
+			auto used = smd::g_alloc->GetUsed();
+			for (uint64_t i = 0; i < COUNT; i += 2) {
+				a.erase(i);
+			}
+			for (uint64_t i = COUNT; i < COUNT * 3 / 2; i++) {
+				a.insert(std::make_pair(i, i));
+			}
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 删光或者clear之后整块归还
+			for (uint64_t i = 0; i < COUNT * 3 / 2; i++) {
+				a.erase(i);
+			}
+			assert(a.empty());
+			b.clear();
+			assert(mem_usage == smd::g_alloc->GetUsed());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMapNodePool complete");
+	}
+
+	void TestMapRank() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_map<uint64_t, uint64_t>>();
+		std::map<uint64_t, uint64_t> ref;
+
+		// 分数跨度超过int64_t的范围，比较时不能直接相减
+		std::default_random_engine generator{std::random_device{}()};
+		std::uniform_int_distribution<uint64_t> dist;
+		const size_t COUNT = 600;
+		for (size_t i = 0; i < COUNT * 2; i++) {
+			auto score = dist(generator);
+			if (i % 3 == 2 && !ref.empty()) {
+				// 随机删除一部分
+				auto it_ref = ref.begin();
+				std::advance(it_ref, score % ref.size());
+				obj->erase(obj->find(it_ref->first));
+				ref.erase(it_ref);
+			} else {
+				obj->insert(std::make_pair(score, i));
+				ref.insert(std::make_pair(score, i));
+			}
+
+			assert(IsEqual(*obj, ref));
+			assert(IsRankEqual(*obj, ref));
+		}
+
+		// 查询不存在的key的名次和区间
+		for (size_t i = 0; i < 100; i++) {
+			auto low = dist(generator);
+			auto high = dist(generator);
+			auto rank = std::distance(ref.begin(), ref.lower_bound(low));
+			assert(obj->rank(low) == size_t(rank));
+
+			size_t expected = 0;
+			if (low < high) {
+				expected = std::distance(ref.lower_bound(low), ref.lower_bound(high));
+			}
+			assert(obj->count_range(low, high) == expected);
+		}
+		assert(obj->rank(uint64_t(0)) == 0);
+		assert(obj->rank(UINT64_MAX) == ref.size() - (ref.count(UINT64_MAX) ? 1 : 0));
+		assert(obj->select(ref.size()) == obj->end());
+		assert(obj->index_of(obj->end()) == obj->size());
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestMapRank complete");
+	}
+
+	// 每个名次都和std::map对比
+	static bool IsRankEqual(smd::shm_map<uint64_t, uint64_t>& l, const std::map<uint64_t, uint64_t>& r) {
+		size_t index = 0;
+		for (auto it = r.begin(); it != r.end(); ++it, ++index) {
+			auto sel = l.select(index);
+			assert(sel != l.end() && sel->first == it->first);
+			assert(l.rank(it->first) == index);
+			assert(l.index_of(sel) == index);
+		}
+		assert(l.select(r.size()) == l.end());
+		return true;
+	}
+
+	void TestMapRange() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		do {
+			smd::shm_map<uint64_t, uint64_t> obj;
+			std::map<uint64_t, uint64_t> ref;
+			for (uint64_t i = 0; i < 500; i++) {
+				// 只放偶数，奇数用来查询不存在的key
+				obj.insert(std::make_pair(i * 2, i));
+				ref.insert(std::make_pair(i * 2, i));
+			}
+
+			for (uint64_t key = 0; key <= 1001; key++) {
+				auto lb = obj.lower_bound(key);
+				auto ub = obj.upper_bound(key);
+				auto ref_lb = ref.lower_bound(key);
+				auto ref_ub = ref.upper_bound(key);
+				assert((lb == obj.end()) == (ref_lb == ref.end()));
+				assert((ub == obj.end()) == (ref_ub == ref.end()));
+				assert(lb == obj.end() || lb->first == ref_lb->first);
+				assert(ub == obj.end() || ub->first == ref_ub->first);
+
+				auto range = obj.equal_range(key);
+				assert(range.first == lb && range.second == ub);
+				assert((range.first != range.second) == (key % 2 == 0 && key < 1000));
+			}
+
+			// [a, b)范围扫描
+			const auto& cobj = obj;
+			uint64_t sum = 0;
+			for (auto it = cobj.lower_bound(101); it != cobj.lower_bound(301); ++it) {
+				sum += it->second;
+			}
+			assert(sum == (51 + 150) * 100 / 2);
+
+			// 反向遍历
+			auto rit = obj.rbegin();
+			for (auto it_ref = ref.rbegin(); it_ref != ref.rend(); ++it_ref, ++rit) {
+				assert(rit != obj.rend() && rit->first == it_ref->first);
+			}
+			assert(rit == obj.rend());
+			assert(cobj.rbegin()->first == 998);
+
+			// 删除返回下一个元素
+			auto it = obj.find(100);
+			it = obj.erase(it);
+			assert(it != obj.end() && it->first == 102);
+			ref.erase(100);
+
+			// 删除一段范围
+			it = obj.erase(obj.lower_bound(200), obj.upper_bound(400));
+			assert(it->first == 402);
+			ref.erase(ref.lower_bound(200), ref.upper_bound(400));
+			assert(IsEqual(obj, ref));
+
+			assert(obj.erase(uint64_t(500)) == 1 && obj.erase(uint64_t(501)) == 0);
+			ref.erase(500);
+			assert(IsEqual(obj, ref));
+			assert(obj.lower_bound(uint64_t(999)) == obj.end());
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 用Slice查找范围，不需要构造shm_string
+		do {
+			smd::shm_map<smd::shm_string, int> obj;
+			for (int i = 0; i < 100; i++) {
+				obj.insert(std::make_pair(smd::shm_string(smd::util::Text::Format("item_%03d", i)), i));
+			}
+
+			auto used = smd::g_alloc->GetUsed();
+			int count = 0;
+			auto last = obj.lower_bound(smd::Slice("item_030"));
+			for (auto it = obj.lower_bound(smd::Slice("item_020")); it != last; ++it) {
+				count++;
+			}
+			assert(count == 10);
+			auto range = obj.equal_range(smd::Slice("item_050"));
+			assert(range.first->second == 50 && range.second->second == 51);
+			assert(obj.upper_bound(smd::Slice("item_099")) == obj.end());
+			assert(used == smd::g_alloc->GetUsed());
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestMapRange complete");
+	}
+
+	// 检查红黑树的性质和子树计数
+	class CheckedMap : public smd::shm_map<uint64_t, uint64_t> {
+	public:
+		bool IsValid() const {
+			return color(root_) == smd::RBTREE_NODE_BLACK && BlackHeight(root_) >= 0;
+		}
+
+	private:
+		static int BlackHeight(rbtree_node_ptr n) {
+			if (n == smd::shm_nullptr)
+				return 1;
+
+			assert(n->count == count(n->left_child) + count(n->right_child) + 1);
+			if (color(n) == smd::RBTREE_NODE_RED) {
+				assert(color(n->left_child) == smd::RBTREE_NODE_BLACK);
+				assert(color(n->right_child) == smd::RBTREE_NODE_BLACK);
+			}
+
+			int left = BlackHeight(n->left_child);
+			int right = BlackHeight(n->right_child);
+			assert(left == right);
+			return left + (color(n) == smd::RBTREE_NODE_BLACK ? 1 : 0);
+		}
+	};
+
+	void TestMapBuild() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 各种大小的树形状都不一样，逐个检查
+		for (uint64_t n = 0; n <= 70; n++) {
+			CheckedMap obj;
+			std::map<uint64_t, uint64_t> ref;
+			for (uint64_t i = 0; i < n; i++) {
+				ref.insert(std::make_pair(i * 3, i));
+			}
+
+			std::vector<std::pair<uint64_t, uint64_t>> sorted(ref.begin(), ref.end());
+			obj.build_sorted(sorted.begin(), sorted.end());
+			assert(obj.IsValid());
+			assert(IsEqual(obj, ref));
+			assert(IsRankEqual(obj, ref));
+
+			// 构建之后可以继续正常插入删除
+			for (uint64_t i = 0; i < n; i++) {
+				obj.insert(std::make_pair(i * 3 + 1, i));
+				ref.insert(std::make_pair(i * 3 + 1, i));
+				obj.erase(obj.find(i * 3));
+				ref.erase(i * 3);
+				assert(obj.IsValid());
+			}
+			assert(IsEqual(obj, ref));
+			assert(IsRankEqual(obj, ref));
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 无序输入，重复的key保留第一个
+		do {
+			std::default_random_engine generator{std::random_device{}()};
+			std::vector<std::pair<uint64_t, uint64_t>> rows;
+			std::map<uint64_t, uint64_t> ref;
+			for (uint64_t i = 0; i < 5000; i++) {
+				auto key = uint64_t(generator() % 3000);
+				rows.push_back(std::make_pair(key, i));
+				ref.insert(std::make_pair(key, i));
+			}
+
+			CheckedMap obj;
+			obj.insert(std::make_pair(uint64_t(999999), uint64_t(0)));
+			obj.build(rows.begin(), rows.end());
+			assert(obj.IsValid());
+			assert(IsEqual(obj, ref));
+			assert(IsRankEqual(obj, ref));
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 非数值类型的key
+		do {
+			std::vector<std::pair<smd::shm_string, smd::shm_string>> rows;
+			for (int i = 0; i < 100; i++) {
+				rows.push_back(std::make_pair(smd::shm_string(GetKey(99 - i)), smd::shm_string(GetValue(99 - i))));
+			}
+
+			smd::shm_map<smd::shm_string, smd::shm_string> obj;
+			obj.build(rows.begin(), rows.end());
+			assert(obj.size() == 100);
+			assert(obj.find(GetKey(42))->second == GetValue(42));
+			auto prev = obj.begin();
+			for (auto it = ++obj.begin(); it != obj.end(); ++it, ++prev) {
+				assert(prev->first < it->first);
+			}
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestMapBuild complete");
+	}
+
+	// 统计构造次数，用来检查key已经存在时没有多余的构造
+	struct Counted {
+		inline static int s_constructed = 0;
+		uint64_t value;
+		uint64_t extra;
+
+		Counted(uint64_t v = 0, uint64_t e = 0)
+			: value(v)
+			, extra(e) {
+			s_constructed++;
+		}
+
+		Counted(const Counted& r)
+			: value(r.value)
+			, extra(r.extra) {
+			s_constructed++;
+		}
+
+		Counted& operator=(const Counted& r) = default;
+	};
+
+	template <class Map>
+	void TestMapEmplace(const char* name) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		do {
+			Map obj;
+			const auto row = std::make_pair(uint64_t(1), Counted(10));
+
+			// 第一次插入才构造
+			Counted::s_constructed = 0;
+			assert(obj.insert(row).second);
+			assert(Counted::s_constructed == 1);
+
+			// key已经存在，不分配也不构造
+			auto used = smd::g_alloc->GetUsed();
+			Counted::s_constructed = 0;
+			auto res = obj.insert(row);
+			assert(!res.second && res.first->second.value == 10);
+			res = obj.try_emplace(uint64_t(1), uint64_t(20), uint64_t(30));
+			assert(!res.second && res.first->second.value == 10);
+			assert(Counted::s_constructed == 0);
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 用参数直接构造，只构造一次
+			res = obj.try_emplace(uint64_t(2), uint64_t(20), uint64_t(30));
+			assert(res.second && res.first->first == 2);
+			assert(res.first->second.value == 20 && res.first->second.extra == 30);
+			assert(Counted::s_constructed == 1);
+
+			// 已经存在的key直接赋值
+			res = obj.insert_or_assign(uint64_t(2), Counted(21));
+			assert(!res.second && obj.at(uint64_t(2)).value == 21);
+			res = obj.insert_or_assign(uint64_t(3), Counted(31));
+			assert(res.second && obj.at(uint64_t(3)).value == 31);
+
+			res = obj.emplace(uint64_t(4), Counted(40));
+			assert(res.second && res.first->second.value == 40);
+			res = obj.emplace(uint64_t(4), Counted(41));
+			assert(!res.second && res.first->second.value == 40);
+
+			obj[uint64_t(5)].value = 50;
+			assert(obj[uint64_t(5)].value == 50);
+			assert(obj.size() == 5);
+
+			uint64_t key = 1;
+			for (auto it = obj.begin(); it != obj.end(); ++it, ++key) {
+				assert(it->first == key);
+			}
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestMapEmplace %s complete", name);
+	}
+
 	void TestMapPod() {
 		auto mem_usage = smd::g_alloc->GetUsed();
 		auto obj = smd::g_alloc->New<smd::shm_map<uint64_t, uint64_t>>();
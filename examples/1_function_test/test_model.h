@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <vector>
+#include <smd.h>
+#include "DataCenter.h"
+
+// 生成的数据模型：字段和map中对象的脏标记
+class TestModel {
+public:
+	TestModel() {
+		TestModelDirty();
+		TestModelDataCenter();
+	}
+
+private:
+	void TestModelDirty() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			auto player = smd::g_alloc->New<UniqsModel::Player>();
+			assert(!player->IsDirty());
+
+			UniqsModel::Item item;
+			item.SetItemid(200);
+			item.SetParam1(1234);
+			assert(item.GetDirtyFields() == 0x3);
+			player->SetItems(200, item);
+			item.SetItemid(199);
+			player->SetItems(199, item);
+			player->SetLevel(2);
+			assert(player->IsDirty(UniqsModel::Player::kItems) && player->IsDirty(UniqsModel::Player::kLevel));
+			assert(player->GetItemsDirty().size() == 2);
+
+			// 落地之后map中的对象也不再是脏的
+			player->ClearDirty();
+			assert(!player->IsDirty() && player->GetItemsDirty().empty());
+			for (auto& kv : player->GetItems()) {
+				assert(!kv.second.IsDirty());
+			}
+
+			// 只修改一个字段，落地时只有这个字段是脏的，不会带上上次的标记
+			player->MutableItems(200)->SetParam1(5678);
+			assert(player->GetDirtyFields() == (1u << UniqsModel::Player::kItems));
+			assert(player->GetItemsDirty().size() == 1 && player->GetItemsDirty().count(200) == 1);
+			assert(player->GetItems().find(200)->second.GetDirtyFields() == (1u << UniqsModel::Item::kParam1));
+			assert(!player->GetItems().find(199)->second.IsDirty());
+
+			player->ClearDirty();
+			assert(!player->GetItems().find(200)->second.IsDirty());
+
+			// 覆盖写入的对象整个是脏的，删除的key记在脏key中
+			item.ClearDirty();
+			item.SetParam1(1);
+			player->SetItems(199, item);
+			player->EraseItems(200);
+			assert(player->GetItems().find(199)->second.GetDirtyFields() == (1u << UniqsModel::Item::kParam1));
+			assert(player->GetItemsDirty().size() == 2 && player->GetItems().size() == 1);
+			player->ClearDirty();
+			assert(!player->IsDirty() && !player->GetItems().find(199)->second.IsDirty());
+
+			smd::g_alloc->Delete(player);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestModelDirty complete");
+	}
+
+	void TestModelDataCenter() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			auto data_center = smd::g_alloc->New<UniqsModel::DataCenter>();
+
+			for (int64_t id = 1; id <= 3; id++) {
+				auto res = data_center->EmplacePlayer(id);
+				assert(res.second && res.first->GetPlayerid() == uint64_t(id));
+				UniqsModel::Item item;
+				item.SetItemid(100 + id);
+				res.first->SetItems(100 + id, item);
+			}
+			data_center->ClearDirty();
+			assert(data_center->dirty_players.empty());
+
+			// 第二次落地只有改过的玩家和改过的物品
+			data_center->MutablePlayer(2)->MutableItems(102)->SetParam1(7);
+			data_center->ErasePlayer(3);
+			std::vector<int64_t> saved;
+			std::vector<int64_t> erased;
+			data_center->ForEachDirtyPlayer([&](int64_t id, const UniqsModel::Player* player) {
+				if (player == nullptr) {
+					erased.push_back(id);
+					return;
+				}
+				saved.push_back(id);
+				assert(player->GetDirtyFields() == (1u << UniqsModel::Player::kItems));
+				assert(player->GetItems().find(102)->second.GetDirtyFields() == (1u << UniqsModel::Item::kParam1));
+			});
+			assert(saved.size() == 1 && saved[0] == 2 && erased.size() == 1 && erased[0] == 3);
+
+			data_center->ClearDirty();
+			assert(!data_center->players.find(2)->second.GetItems().find(102)->second.IsDirty());
+			assert(data_center->changes.size() == 5);
+			smd::g_alloc->Delete(data_center);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestModelDataCenter complete");
+	}
+};
@@ -0,0 +1,249 @@
+﻿#pragma once
+#include <string>
+#include <smd.h>
+
+class TestMove {
+public:
+	TestMove() {
+		TestMoveString();
+		TestMoveVector();
+		TestMoveList();
+		TestMoveMap();
+		TestMoveHash();
+		TestMoveNested();
+	}
+
+private:
+	// 嵌套了多层容器的对象，类似Player
+	struct Nested {
+		int64_t id = 0;
+		smd::shm_string name;
+		smd::shm_vector<smd::shm_string> tags;
+		smd::shm_map<int64_t, smd::shm_string> items;
+		smd::shm_btree_map<int64_t, int64_t> equips;
+	};
+
+	void TestMoveString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			// 长字符串移动之后还是原来那块空间，对方变成空的短字符串
+			smd::shm_string a(std::string(100, 'a'));
+			const char* data = a.data();
+			auto used = smd::g_alloc->GetUsed();
+			smd::shm_string b(std::move(a));
+			assert(b.data() == data && b.size() == 100);
+			assert(a.empty() && a.is_inline());
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 移动赋值释放自己原来的空间
+			smd::shm_string c(std::string(200, 'c'));
+			c = std::move(b);
+			assert(c.data() == data && b.empty());
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 短字符串直接按字节拷贝
+			smd::shm_string d("short");
+			smd::shm_string e(std::move(d));
+			assert(e == "short" && d.empty());
+
+			// 被移动过的对象还可以继续使用
+			a = "reuse";
+			a.append(std::string(50, 'x'));
+			assert(a.size() == 55);
+
+			// 驻留字符串移动时不改引用计数
+			smd::shm_intern_string f("MoveIntern");
+			smd::shm_intern_string g(std::move(f));
+			assert(f.empty() && g.ref_count() == 1);
+			f = std::move(g);
+			assert(g.empty() && f == "MoveIntern" && f.ref_count() == 1);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMoveString complete");
+	}
+
+	void TestMoveVector() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_vector<smd::shm_string> v;
+			for (int i = 0; i < 100; i++) {
+				v.push_back(smd::shm_string(std::string(30, char('a' + i % 26))));
+			}
+			auto first = v.data();
+			auto used = smd::g_alloc->GetUsed();
+
+			smd::shm_vector<smd::shm_string> v2(std::move(v));
+			assert(v2.size() == 100 && v2.data() == first);
+			assert(v.empty() && v.capacity() == 0);
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 被移动过的vector可以继续插入
+			v.push_back(smd::shm_string("again"));
+			v.insert(v.begin(), smd::shm_string("front"));
+			assert(v.size() == 2 && v[0] == "front" && v[1] == "again");
+
+			v = std::move(v2);
+			assert(v.size() == 100 && v.data() == first && v2.empty());
+
+			// 对象内部和堆上的small_vector都可以移动
+			smd::shm_small_vector<smd::shm_string, 2> s;
+			s.push_back(smd::shm_string(std::string(40, 's')));
+			smd::shm_small_vector<smd::shm_string, 2> s2(std::move(s));
+			assert(s2.size() == 1 && s2.is_inline() && s.empty());
+			for (int i = 0; i < 10; i++) {
+				s2.emplace_back("heap");
+			}
+			auto heap = s2.data();
+			s = std::move(s2);
+			assert(s.size() == 11 && s.data() == heap && s2.empty() && s2.is_inline());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMoveVector complete");
+	}
+
+	void TestMoveList() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_list<smd::shm_string> l;
+			for (int i = 0; i < 10; i++) {
+				l.emplace_back(std::string(30, char('a' + i)));
+			}
+			l.emplace_front("first");
+			auto& front = l.front();
+
+			smd::shm_list<smd::shm_string> l2(std::move(l));
+			assert(l.empty() && l2.size() == 11);
+			assert(&l2.front() == &front);
+
+			l.push_back(smd::shm_string("again"));
+			l = std::move(l2);
+			assert(l.size() == 11 && &l.front() == &front && l2.empty());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMoveList complete");
+	}
+
+	void TestMoveMap() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_map<int64_t, smd::shm_string> m;
+			smd::shm_btree_map<int64_t, smd::shm_string> b;
+			for (int64_t i = 0; i < 100; i++) {
+				m.insert(std::make_pair(i, smd::shm_string(std::string(30, 'm'))));
+				b.insert(std::make_pair(i, smd::shm_string(std::string(30, 'b'))));
+			}
+			auto m_value = &m.find(50)->second;
+			auto b_value = &b.find(50)->second;
+			auto used = smd::g_alloc->GetUsed();
+
+			smd::shm_map<int64_t, smd::shm_string> m2(std::move(m));
+			smd::shm_btree_map<int64_t, smd::shm_string> b2(std::move(b));
+			assert(m.empty() && m2.size() == 100 && &m2.find(50)->second == m_value);
+			assert(b.empty() && b2.size() == 100 && &b2.find(50)->second == b_value);
+			assert(m.begin() == m.end() && b.begin() == b.end());
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 插入右值时value的内容直接移动到节点中
+			smd::shm_string value(std::string(30, 'v'));
+			const char* data = value.data();
+			auto pair = std::make_pair(int64_t(1000), std::move(value));
+			assert(m2.insert(std::move(pair)).second);
+			assert(m2.find(1000)->second.data() == data && pair.second.empty());
+
+			m = std::move(m2);
+			b = std::move(b2);
+			assert(m.size() == 101 && m2.empty() && b.size() == 100 && b2.empty());
+
+			m2.insert(std::make_pair(int64_t(1), smd::shm_string("again")));
+			b2.insert(std::make_pair(int64_t(1), smd::shm_string("again")));
+			assert(m2.size() == 1 && b2.size() == 1);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMoveMap complete");
+	}
+
+	void TestMoveHash() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_unordered_map<int64_t, smd::shm_string> u;
+			smd::shm_flat_hash_map<int64_t, smd::shm_string> f;
+			for (int64_t i = 0; i < 100; i++) {
+				u.insert(std::make_pair(i, smd::shm_string(std::string(30, 'u'))));
+				f.insert(std::make_pair(i, smd::shm_string(std::string(30, 'f'))));
+			}
+			auto u_value = &u.find(50)->second;
+			auto used = smd::g_alloc->GetUsed();
+
+			smd::shm_unordered_map<int64_t, smd::shm_string> u2(std::move(u));
+			smd::shm_flat_hash_map<int64_t, smd::shm_string> f2(std::move(f));
+			assert(u2.size() == 100 && &u2.find(50)->second == u_value);
+			assert(f2.size() == 100 && f2.find(50) != f2.end());
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 被移动过的哈希表没有bucket，查找、删除和插入都要能正常工作
+			assert(u.empty() && u.bucket_count() == 0 && u.begin() == u.end());
+			assert(u.find(50) == u.end() && u.erase(50) == 0);
+			assert(f.empty() && f.capacity() == 0 && f.find(50) == f.end());
+			for (int64_t i = 0; i < 10; i++) {
+				u.insert(std::make_pair(i, smd::shm_string("again")));
+				f.insert(std::make_pair(i, smd::shm_string("again")));
+			}
+			assert(u.size() == 10 && u.find(5)->second == "again");
+			assert(f.size() == 10 && f.find(5)->second == "again");
+
+			u = std::move(u2);
+			f = std::move(f2);
+			assert(u.size() == 100 && &u.find(50)->second == u_value && u2.empty());
+			assert(f.size() == 100 && f2.empty());
+
+			smd::shm_hash<int64_t> h;
+			h.insert(1);
+			smd::shm_hash<int64_t> h2(std::move(h));
+			assert(h.empty() && h2.count(1) == 1);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMoveHash complete");
+	}
+
+	// 把构造好的嵌套对象插入到map中，只搬动偏移，不会深拷贝里面的容器
+	void TestMoveNested() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			smd::shm_map<int64_t, Nested> all;
+			Nested obj;
+			obj.id = 1;
+			obj.name = std::string(50, 'n');
+			for (int64_t i = 0; i < 100; i++) {
+				obj.tags.emplace_back(std::string(30, 't'));
+				obj.items.try_emplace(i, std::string(30, 'i'));
+				obj.equips.try_emplace(i, i);
+			}
+			auto name = obj.name.data();
+			auto tags = obj.tags.data();
+			auto item = &obj.items.find(50)->second;
+			auto equip = &obj.equips.find(50)->second;
+
+			auto used = smd::g_alloc->GetUsed();
+			auto& inserted = all.try_emplace(obj.id, std::move(obj)).first->second;
+			// 只多了一个map节点
+			assert(smd::g_alloc->GetUsed() - used <= sizeof(smd::RBTreeNode<std::pair<int64_t, Nested>>) * 2);
+			assert(inserted.name.data() == name && inserted.tags.data() == tags);
+			assert(&inserted.items.find(50)->second == item && &inserted.equips.find(50)->second == equip);
+			assert(obj.name.empty() && obj.tags.empty() && obj.items.empty() && obj.equips.empty());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMoveNested complete");
+	}
+};
@@ -0,0 +1,273 @@
+﻿#pragma once
+#include <thread>
+#include <vector>
+#include <string>
+#include <map>
+#include <atomic>
+#include <smd.h>
+#include <common/persist_pipeline.h>
+
+class TestPersist {
+public:
+	TestPersist() {
+		TestPersistOrder();
+		TestPersistBackpressure();
+		TestPersistRetry();
+		TestPersistFile();
+	}
+
+private:
+	enum { kTablePlayers = 1 };
+
+	// 把每一批记录存下来的sink
+	class MemorySink : public smd::PersistSink {
+	public:
+		bool Write(const std::vector<smd::PersistRecord>& batch) override {
+			while (blocked) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			if (fail_times > 0) {
+				--fail_times;
+				return false;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			batches.push_back(batch.size());
+			records.insert(records.end(), batch.begin(), batch.end());
+			return true;
+		}
+
+		std::mutex mutex;
+		std::vector<smd::PersistRecord> records;
+		std::vector<size_t> batches;
+		std::atomic<bool> blocked{false};
+		std::atomic<int> fail_times{0};
+	};
+
+	// 前fail_times次只写一半就失败，模拟磁盘写满之类的错误
+	class PartialFileSink : public smd::PersistFileSink {
+	public:
+		explicit PartialFileSink(const std::string& path)
+			: smd::PersistFileSink(path) {}
+
+		std::atomic<int> fail_times{0};
+
+	protected:
+		size_t WriteData(const char* data, size_t size) override {
+			if (fail_times > 0) {
+				--fail_times;
+				return smd::PersistFileSink::WriteData(data, size / 2);
+			}
+			return smd::PersistFileSink::WriteData(data, size);
+		}
+	};
+
+	// 序列化耗时不一样，完成的顺序是乱的，写入的顺序仍然和提交顺序一致
+	void TestPersistOrder() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			MemorySink sink;
+			smd::PersistOptions options;
+			options.serialize_threads = 4;
+			options.max_batch = 64;
+			smd::PersistPipeline pipeline(&sink, options);
+
+			const int64_t COUNT = 2000;
+			for (int64_t i = 0; i < COUNT; i++) {
+				if (i % 100 == 99) {
+					assert(pipeline.SubmitErase(kTablePlayers, i % 50));
+					continue;
+				}
+				assert(pipeline.Submit(kTablePlayers, i % 50, [i](std::string* out) {
+					if (i % 7 == 0) {
+						std::this_thread::sleep_for(std::chrono::microseconds(50));
+					}
+					*out = std::to_string(i);
+				}));
+			}
+			assert(pipeline.Flush() && pipeline.pending() == 0);
+
+			assert(sink.records.size() == COUNT);
+			for (int64_t i = 0; i < COUNT; i++) {
+				auto& r = sink.records[i];
+				assert(r.table == kTablePlayers && r.key == i % 50);
+				if (i % 100 == 99) {
+					assert(r.erased && r.data.empty());
+				} else {
+					assert(!r.erased && r.data == std::to_string(i));
+				}
+			}
+			for (auto n : sink.batches) {
+				assert(n > 0 && n <= 64);
+			}
+
+			auto stats = pipeline.GetStats();
+			assert(stats.submitted == COUNT && stats.written == COUNT && stats.failed == 0);
+			assert(stats.batches == sink.batches.size() && stats.batches >= COUNT / 64);
+
+			// 停止之后不再接受提交
+			pipeline.Stop();
+			assert(!pipeline.Submit(kTablePlayers, 1, [](std::string*) {}));
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestPersistOrder complete");
+	}
+
+	// sink写不动的时候积压的记录不超过max_pending，提交方被挡住
+	void TestPersistBackpressure() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			MemorySink sink;
+			sink.blocked = true;
+			smd::PersistOptions options;
+			options.serialize_threads = 1;
+			options.max_pending = 8;
+			options.batch_delay_ms = 0;
+			smd::PersistPipeline pipeline(&sink, options);
+
+			for (int64_t i = 0; i < 8; i++) {
+				assert(pipeline.Submit(kTablePlayers, i, [](std::string* out) { *out = "p"; }, 0));
+			}
+			assert(pipeline.pending() == 8);
+			assert(!pipeline.Submit(kTablePlayers, 8, [](std::string*) {}, 0));
+			assert(!pipeline.SubmitErase(kTablePlayers, 8, 10));
+			assert(!pipeline.Flush(10));
+
+			// 被阻塞的提交在sink写完之后继续
+			std::thread producer([&pipeline] {
+				for (int64_t i = 8; i < 100; i++) {
+					pipeline.Submit(kTablePlayers, i, [](std::string* out) { *out = "p"; });
+					assert(pipeline.pending() <= 8);
+				}
+			});
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			sink.blocked = false;
+			producer.join();
+			assert(pipeline.Flush());
+
+			assert(sink.records.size() == 100);
+			for (int64_t i = 0; i < 100; i++) {
+				assert(sink.records[i].key == i);
+			}
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestPersistBackpressure complete");
+	}
+
+	// 写失败时整批重试，重试次数用完就丢弃这一批
+	void TestPersistRetry() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			MemorySink sink;
+			smd::PersistOptions options;
+			options.max_retries = 2;
+			options.retry_interval_ms = 1;
+			smd::PersistPipeline pipeline(&sink, options);
+
+			sink.fail_times = 2;
+			assert(pipeline.Submit(kTablePlayers, 1, [](std::string* out) { *out = "a"; }));
+			assert(pipeline.Flush());
+			assert(sink.records.size() == 1 && sink.records[0].data == "a");
+
+			sink.fail_times = 3;
+			assert(pipeline.Submit(kTablePlayers, 2, [](std::string* out) { *out = "b"; }));
+			assert(pipeline.Flush());
+			assert(sink.records.size() == 1);
+
+			assert(pipeline.Submit(kTablePlayers, 3, [](std::string* out) { *out = "c"; }));
+			assert(pipeline.Flush());
+			assert(sink.records.size() == 2 && sink.records[1].data == "c");
+
+			auto stats = pipeline.GetStats();
+			assert(stats.submitted == 3 && stats.written == 2 && stats.failed == 1);
+		} while (false);
+
+		// 写文件失败时截掉写了一半的数据，重试和之后的写入不会接在残缺的记录后面
+		do {
+			const std::string path = "test_persist_retry.dat";
+			remove(path.c_str());
+
+			do {
+				PartialFileSink sink(path);
+				smd::PersistOptions options;
+				options.max_retries = 2;
+				options.retry_interval_ms = 1;
+				options.batch_delay_ms = 0;
+				smd::PersistPipeline pipeline(&sink, options);
+
+				sink.fail_times = 2;
+				assert(pipeline.Submit(kTablePlayers, 1, [](std::string* out) { *out = "first record"; }));
+				assert(pipeline.Flush());
+
+				sink.fail_times = 3;
+				assert(pipeline.Submit(kTablePlayers, 2, [](std::string* out) { *out = "dropped record"; }));
+				assert(pipeline.Flush());
+
+				assert(pipeline.Submit(kTablePlayers, 3, [](std::string* out) { *out = "last record"; }));
+				assert(pipeline.Flush());
+
+				auto stats = pipeline.GetStats();
+				assert(stats.written == 2 && stats.failed == 1);
+			} while (false);
+
+			std::vector<smd::PersistRecord> records;
+			auto n = smd::PersistFileSink::Load(path, [&records](const smd::PersistRecord& r) { records.push_back(r); });
+			assert(n == 2 && records.size() == 2);
+			assert(records[0].key == 1 && records[0].data == "first record");
+			assert(records[1].key == 3 && records[1].data == "last record");
+			remove(path.c_str());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestPersistRetry complete");
+	}
+
+	// 写到文件再读回来，后写的覆盖先写的
+	void TestPersistFile() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			const std::string path = "test_persist.dat";
+			remove(path.c_str());
+
+			do {
+				smd::PersistFileSink sink(path, true);
+				assert(sink.IsOpen());
+				smd::PersistPipeline pipeline(&sink);
+				for (int64_t i = 0; i < 1000; i++) {
+					pipeline.Submit(kTablePlayers, i % 100, [i](std::string* out) {
+						*out = "player" + std::to_string(i) + std::string(i % 30, 'x');
+					});
+				}
+				pipeline.SubmitErase(kTablePlayers, 7);
+				pipeline.Submit(kTablePlayers, 200, [](std::string*) {});
+				// 析构时写完剩下的记录
+			} while (false);
+
+			std::map<int64_t, std::string> players;
+			auto n = smd::PersistFileSink::Load(path, [&players](const smd::PersistRecord& r) {
+				assert(r.table == kTablePlayers);
+				if (r.erased) {
+					players.erase(r.key);
+				} else {
+					players[r.key] = r.data;
+				}
+			});
+			assert(n == 1002 && players.size() == 100);
+			assert(players.count(7) == 0 && players[200].empty());
+			for (int64_t i = 900; i < 1000; i++) {
+				if (i % 100 != 7) {
+					assert(players[i % 100] == "player" + std::to_string(i) + std::string(i % 30, 'x'));
+				}
+			}
+			remove(path.c_str());
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestPersistFile complete");
+	}
+};
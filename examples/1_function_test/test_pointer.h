@@ -9,6 +9,7 @@ public:
 		TestNewDelete();
 		TestArrayPointer();
 		TestPointerToObject();
+		TestExpand();
 	}
 
 private:
@@ -144,4 +145,43 @@ private:
 		assert(mem_usage == smd::g_alloc->GetUsed());
 		SMD_LOG_INFO("TestPointer complete");
 	}
+
+	// 块的实际容量与原地扩容
+	void TestExpand() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 伙伴算法按2的幂分配，多出来的部分也可以用
+		auto shm_ptr = smd::g_alloc->Malloc<int>(5);
+		assert(smd::g_alloc->GetCapacity(shm_ptr) == 8);
+		for (auto i = 0; i < 8; i++) {
+			shm_ptr[i] = i;
+		}
+
+		// 扩容成功的话位置不变，数据不变；失败的话什么也不改变
+		auto old_ptr = shm_ptr;
+		if (smd::g_alloc->TryExpand(shm_ptr, 32)) {
+			assert(smd::g_alloc->GetCapacity(shm_ptr) == 32);
+		} else {
+			assert(smd::g_alloc->GetCapacity(shm_ptr) == 8);
+		}
+		assert(shm_ptr == old_ptr);
+		for (auto i = 0; i < 8; i++) {
+			assert(shm_ptr[i] == i);
+		}
+
+		// 刚释放的大块再分配出来，左半边一定可以原地扩回去
+		auto big = smd::g_alloc->Malloc<char>(4096);
+		auto raw = big.Raw();
+		smd::g_alloc->Free(big, 4096);
+		auto small = smd::g_alloc->Malloc<char>(1024);
+		if (small.Raw() == raw) {
+			assert(smd::g_alloc->TryExpand(small, 4096));
+			assert(smd::g_alloc->GetCapacity(small) == 4096);
+		}
+
+		smd::g_alloc->Free(small, 4096);
+		smd::g_alloc->Free(shm_ptr, 32);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestExpand complete");
+	}
 };
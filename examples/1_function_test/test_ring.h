@@ -0,0 +1,250 @@
+﻿#pragma once
+#include <thread>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <smd.h>
+
+class TestRing {
+public:
+	TestRing() {
+		TestSpscRing();
+		TestSpscRingThread();
+		TestMpmcRingThread();
+		TestRecordRing();
+		TestRecordRingThread();
+	}
+
+private:
+	struct Event {
+		uint64_t seq;
+		int64_t player_id;
+		int op;
+	};
+
+	void TestSpscRing() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			auto ring = smd::g_alloc->New<smd::shm_spsc_ring<Event>>(100);
+			assert(ring->capacity() == 128 && ring->empty());
+
+			// 写满之后写不进去
+			for (uint64_t i = 0; i < 128; i++) {
+				assert(ring->try_push(Event{i, int64_t(i) * 10, 1}));
+			}
+			assert(!ring->try_push(Event{128, 0, 0}) && ring->size() == 128);
+
+			// 批量读写跨过缓冲区末尾
+			Event out[100];
+			assert(ring->pop_batch(out, 100) == 100);
+			assert(out[0].seq == 0 && out[99].seq == 99 && out[99].player_id == 990);
+			Event in[200];
+			for (uint64_t i = 0; i < 200; i++) {
+				in[i] = Event{128 + i, 0, 2};
+			}
+			assert(ring->push_batch(in, 200) == 100 && ring->size() == 128);
+			uint64_t expect = 100;
+			Event e;
+			while (ring->try_pop(e)) {
+				assert(e.seq == expect++);
+			}
+			assert(expect == 228 && ring->empty());
+
+			// 空队列等待超时
+			auto start = std::chrono::steady_clock::now();
+			assert(!ring->pop(e, 20));
+			assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+			// 读写不访问g_alloc
+			auto used = smd::g_alloc->GetUsed();
+			assert(ring->push(Event{1, 2, 3}) && ring->pop(e, 0) && e.player_id == 2);
+			assert(used == smd::g_alloc->GetUsed());
+			smd::g_alloc->Delete(ring);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestSpscRing complete");
+	}
+
+	// 队列很小，生产者和消费者都会阻塞等待对方
+	void TestSpscRingThread() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			const uint64_t COUNT = 200000;
+			auto ring = smd::g_alloc->New<smd::shm_spsc_ring<Event>>(64);
+
+			std::thread producer([&ring, COUNT] {
+				Event batch[16];
+				uint64_t seq = 0;
+				while (seq < COUNT) {
+					if (seq % 3 == 0) {
+						ring->push(Event{seq, int64_t(seq), 0});
+						++seq;
+						continue;
+					}
+					size_t n = 0;
+					for (; n < 16 && seq + n < COUNT; n++) {
+						batch[n] = Event{seq + n, int64_t(seq + n), 0};
+					}
+					size_t done = 0;
+					while (done < n) {
+						done += ring->push_batch(batch + done, n - done);
+						if (done < n) {
+							ring->push(batch[done]);
+							++done;
+						}
+					}
+					seq += n;
+				}
+			});
+
+			uint64_t expect = 0;
+			Event out[32];
+			while (expect < COUNT) {
+				size_t n = ring->pop_batch_wait(out, 32);
+				for (size_t i = 0; i < n; i++) {
+					assert(out[i].seq == expect && out[i].player_id == int64_t(expect));
+					++expect;
+				}
+			}
+			producer.join();
+			assert(ring->empty());
+			smd::g_alloc->Delete(ring);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestSpscRingThread complete");
+	}
+
+	// 多个生产者和消费者，每个元素只被取出一次
+	void TestMpmcRingThread() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			const int THREADS = 4;
+			const uint64_t COUNT = 50000;
+			auto ring = smd::g_alloc->New<smd::shm_mpmc_ring<Event>>(128);
+
+			std::vector<std::thread> threads;
+			std::atomic<uint64_t> popped{0};
+			std::vector<uint64_t> sums(THREADS, 0);
+			std::vector<uint64_t> last(THREADS * THREADS, 0);
+			for (int t = 0; t < THREADS; t++) {
+				threads.emplace_back([&ring, t, COUNT] {
+					for (uint64_t i = 1; i <= COUNT; i++) {
+						ring->push(Event{i, t, 0});
+					}
+				});
+			}
+			for (int t = 0; t < THREADS; t++) {
+				threads.emplace_back([&, t] {
+					Event out[8];
+					while (popped.load() < COUNT * THREADS) {
+						size_t n = ring->pop_batch_wait(out, 8, 10);
+						for (size_t i = 0; i < n; i++) {
+							sums[t] += out[i].seq;
+							// 同一个生产者的元素在同一个消费者看来是有序的
+							auto& prev = last[t * THREADS + out[i].player_id];
+							assert(out[i].seq > prev);
+							prev = out[i].seq;
+						}
+						popped += n;
+					}
+				});
+			}
+			for (auto& t : threads) {
+				t.join();
+			}
+
+			uint64_t total = 0;
+			for (auto s : sums) {
+				total += s;
+			}
+			assert(popped == COUNT * THREADS && total == THREADS * COUNT * (COUNT + 1) / 2);
+			assert(ring->empty());
+			smd::g_alloc->Delete(ring);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMpmcRingThread complete");
+	}
+
+	void TestRecordRing() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			auto ring = smd::g_alloc->New<smd::shm_record_ring>(256);
+			assert(ring->capacity() == 256 && ring->max_record_size() == 124);
+
+			// 长度不一的记录，写满后读出一部分再写，末尾放不下的记录从头开始
+			std::vector<std::string> expect;
+			size_t next = 0;
+			std::string record;
+			for (int round = 0; round < 50; round++) {
+				while (true) {
+					std::string s = smd::util::Text::Format("record%d:", int(expect.size())) +
+									std::string(expect.size() * 7 % 100, 'r');
+					if (!ring->try_push(s))
+						break;
+					expect.push_back(s);
+				}
+				assert(ring->try_pop(record) && record == expect[next++]);
+				size_t n = ring->pop_batch([&](const smd::Slice& r) { assert(r == smd::Slice(expect[next++])); }, 2);
+				assert(n <= 2);
+			}
+			while (ring->try_pop(record)) {
+				assert(record == expect[next++]);
+			}
+			assert(next == expect.size() && ring->empty());
+
+			// 空记录和最大的记录
+			std::string big(ring->max_record_size(), 'b');
+			smd::Slice batch[3] = {smd::Slice(), smd::Slice(big), smd::Slice("x")};
+			assert(ring->push_batch(batch, 3) >= 2);
+			assert(ring->try_pop(record) && record.empty());
+			assert(ring->try_pop(record) && record == big);
+			ring->pop_batch([](const smd::Slice&) {});
+			assert(ring->empty());
+
+			smd::g_alloc->Delete(ring);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestRecordRing complete");
+	}
+
+	void TestRecordRingThread() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		do {
+			const int COUNT = 100000;
+			auto ring = smd::g_alloc->New<smd::shm_record_ring>(4096);
+
+			std::thread producer([&ring, COUNT] {
+				for (int i = 0; i < COUNT; i++) {
+					std::string s = std::to_string(i) + ":" + std::string(i % 300, 'p');
+					ring->push(s);
+				}
+			});
+
+			int expect = 0;
+			while (expect < COUNT) {
+				ring->pop_batch_wait(
+					[&expect](const smd::Slice& r) {
+						std::string s = std::to_string(expect) + ":" + std::string(expect % 300, 'p');
+						assert(r == smd::Slice(s));
+						++expect;
+					},
+					64);
+			}
+			producer.join();
+			assert(ring->empty());
+			smd::g_alloc->Delete(ring);
+		} while (false);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestRecordRingThread complete");
+	}
+};
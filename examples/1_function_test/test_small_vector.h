@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <vector>
+#include <smd.h>
+
+class TestSmallVector {
+public:
+	TestSmallVector() {
+		TestShmSmallVector();
+		TestShmSmallVectorString();
+	}
+
+private:
+	void TestShmSmallVector() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto v = smd::g_alloc->New<smd::shm_small_vector<int64_t, 4>>();
+		auto mem_object = smd::g_alloc->GetUsed();
+
+		// 不超过4个元素的时候不需要额外分配
+		for (int i = 0; i < 4; i++) {
+			v->push_back(i);
+		}
+		assert(v->is_inline());
+		assert(v->size() == 4);
+		assert(mem_object == smd::g_alloc->GetUsed());
+
+		// 超过之后搬到堆上
+		for (int i = 4; i < 100; i++) {
+			v->push_back(i);
+		}
+		assert(!v->is_inline());
+		assert(v->size() == 100);
+		for (int i = 0; i < 100; i++) {
+			assert((*v)[i] == i);
+		}
+
+		// 元素变少之后可以搬回来
+		v->resize(3, 0);
+		v->shrink_to_fit();
+		assert(v->is_inline());
+		assert(mem_object == smd::g_alloc->GetUsed());
+		assert(v->back() == 2);
+
+		do {
+			smd::shm_small_vector<int64_t, 4> v1(*v);
+			assert(v1.size() == 3);
+			v1.push_back(v1.front());
+			assert(v1.back() == 0);
+		} while (false);
+
+		smd::g_alloc->Delete(v);
+		assert(v == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmSmallVector complete");
+	}
+
+	void TestShmSmallVectorString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto v = smd::g_alloc->New<smd::shm_small_vector<smd::shm_string, 2>>();
+		std::vector<std::string> ref;
+
+		for (int i = 0; i < 100; i++) {
+			auto text = smd::util::Text::Format("TestText%02d", i);
+			v->emplace_back(text);
+			ref.push_back(text);
+		}
+		v->push_back(v->front());
+		ref.push_back(ref.front());
+
+		assert(v->size() == ref.size());
+		size_t i = 0;
+		for (auto& element : *v) {
+			assert(element.ToString() == ref[i++]);
+		}
+
+		do {
+			smd::shm_small_vector<smd::shm_string, 2> v1;
+			v1 = *v;
+			assert(v1.size() == v->size());
+			assert(v1[50] == (*v)[50]);
+		} while (false);
+
+		smd::g_alloc->Delete(v);
+		assert(v == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmSmallVectorString complete");
+	}
+};
@@ -1,10 +1,15 @@
 ﻿#pragma once
+#include <set>
+#include <string_view>
 #include <smd.h>
 
 class TestString {
 public:
 	TestString() {
 		TestShmString();
+		TestShmStringHash();
+		TestShmStringInline();
+		TestShmStringAssign();
 	}
 
 private:
@@ -74,4 +79,172 @@ private:
 
 		SMD_LOG_INFO("TestShmString complete");
 	}
+
+	void TestShmStringInline() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		assert(sizeof(smd::shm_string) == 24);
+
+		// 短字符串不分配共享内存
+		do {
+			smd::shm_string empty;
+			assert(empty.empty() && empty.is_inline());
+			assert(strcmp(empty.data(), "") == 0);
+
+			std::string text22(22, 'a');
+			smd::shm_string s22(text22);
+			assert(s22.is_inline());
+			assert(s22.ToString() == text22);
+			assert(s22.data()[22] == '\0');
+			assert(mem_usage == smd::g_alloc->GetUsed());
+
+			// 超过22个字符放到堆上
+			std::string text23(23, 'b');
+			smd::shm_string s23(text23);
+			assert(!s23.is_inline());
+			assert(s23.ToString() == text23);
+			assert(mem_usage < smd::g_alloc->GetUsed());
+
+			// 长短字符串互相赋值
+			s22 = s23;
+			assert(!s22.is_inline() && s22 == s23);
+			// 赋值沿用原有的堆空间，shrink_to_fit之后才搬回对象内部
+			s23 = std::string("short");
+			assert(!s23.is_inline() && s23.ToString() == "short");
+			s23.shrink_to_fit();
+			assert(s23.is_inline() && s23.ToString() == "short");
+			smd::shm_string copy(s23);
+			assert(copy.is_inline() && copy == s23 && copy.data() != s23.data());
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 放在容器中搬迁之后内容不变
+		do {
+			smd::shm_vector<smd::shm_string> v;
+			for (int i = 0; i < 100; i++) {
+				v.push_back(smd::shm_string(std::string(i % 40, char('a' + i % 26))));
+			}
+			for (int i = 0; i < 100; i++) {
+				assert(v[i].ToString() == std::string(i % 40, char('a' + i % 26)));
+				assert(v[i].is_inline() == (i % 40 <= 22));
+			}
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestShmStringInline complete");
+	}
+
+	void TestShmStringAssign() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 连续append的结果和std::string一致
+		do {
+			smd::shm_string s;
+			std::string stl;
+			for (int i = 0; i < 200; i++) {
+				std::string piece(i % 7 + 1, char('a' + i % 26));
+				s.append(piece);
+				stl.append(piece);
+				assert(s.ToString() == stl);
+				assert(s.data()[s.size()] == '\0');
+			}
+			s.push_back('!');
+			s += smd::Slice("?");
+			stl += "!?";
+			assert(s.ToString() == stl);
+
+			// 追加自身
+			s.append(s);
+			assert(s.ToString() == stl + stl);
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 放得下的时候赋值不分配内存
+		do {
+			smd::shm_string s(std::string(100, 'x'));
+			const char* ori_ptr = s.data();
+			auto used = smd::g_alloc->GetUsed();
+			for (int i = 0; i < 100; i++) {
+				s = std::to_string(i * 1000003);
+				s.assign(smd::Slice(std::string(i, 'y')));
+				s = "hello";
+			}
+			assert(s.data() == ori_ptr && s.ToString() == "hello");
+			assert(used == smd::g_alloc->GetUsed());
+
+			// 用自身的一部分赋值
+			s.assign(s.data() + 1, 3);
+			assert(s.ToString() == "ell");
+
+			// clear之后空间依然保留
+			s.clear();
+			assert(s.empty() && s.data() == ori_ptr);
+			assert(used == smd::g_alloc->GetUsed());
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// reserve和shrink_to_fit
+		do {
+			smd::shm_string s("abc");
+			s.reserve(1000);
+			assert(s.capacity() >= 1000 && !s.is_inline() && s.ToString() == "abc");
+			auto used = smd::g_alloc->GetUsed();
+			for (int i = 0; i < 990; i++) {
+				s.push_back('d');
+			}
+			assert(used == smd::g_alloc->GetUsed());
+
+			s.assign(std::string(100, 'e'));
+			s.shrink_to_fit();
+			assert(s.capacity() < 1000 && s.ToString() == std::string(100, 'e'));
+
+			s = smd::Slice("short");
+			s.shrink_to_fit();
+			assert(s.is_inline() && s.ToString() == "short");
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 用Slice构造，覆盖已有key的value不分配内存
+		do {
+			smd::shm_unordered_map<smd::shm_string, smd::shm_string> strings;
+			std::string_view key("HotKey");
+			strings.emplace(smd::shm_string(smd::Slice(key)), smd::shm_string(std::string(64, 'v')));
+			auto used = smd::g_alloc->GetUsed();
+			for (int i = 0; i < 1000; i++) {
+				strings.find(smd::Slice(key))->second.assign(smd::Slice(std::to_string(i)));
+			}
+			assert(strings.find(key)->second == "999");
+			assert(used == smd::g_alloc->GetUsed());
+		} while (false);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestShmStringAssign complete");
+	}
+
+	void TestShmStringHash() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		std::set<size_t> hashes;
+		std::string text;
+		for (size_t len = 0; len <= 200; len++) {
+			std::string_view view(text);
+			smd::shm_string s(text);
+
+			// 不同的输入类型，只要字节相同，哈希值就相同
+			const size_t h = std::hash<smd::shm_string>()(s);
+			assert(h == std::hash<smd::Slice>()(smd::Slice(view.data(), view.size())));
+			assert(h == smd::util::Hash::Bytes(view.data(), view.size()));
+			hashes.insert(h);
+
+			text.push_back(char('a' + len % 26));
+		}
+		assert(hashes.size() == 201);
+
+		// 只改变一个字节，哈希值也要不同
+		std::string a(100, 'x');
+		std::string b(a);
+		b[57] = 'y';
+		assert(smd::util::Hash::Bytes(a.data(), a.size()) != smd::util::Hash::Bytes(b.data(), b.size()));
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmStringHash complete");
+	}
 };
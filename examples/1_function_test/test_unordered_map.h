@@ -0,0 +1,194 @@
+﻿#pragma once
+#include <unordered_map>
+#include <algorithm>
+#include <string_view>
+#include <smd.h>
+
+class TestUnorderedMap {
+public:
+	TestUnorderedMap() {
+		TestUnorderedMapPod();
+		TestUnorderedMapString();
+		TestHeterogeneousLookup();
+	}
+
+private:
+	void TestUnorderedMapPod() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_unordered_map<uint64_t, uint64_t>>();
+		std::unordered_map<uint64_t, uint64_t> ref;
+
+		std::vector<uint64_t> vRoleIds;
+		const size_t COUNT = 5000;
+		for (size_t i = 0; i < COUNT; i++) {
+			vRoleIds.push_back(i * 7919);
+		}
+
+		std::default_random_engine generator{std::random_device{}()};
+		std::shuffle(vRoleIds.begin(), vRoleIds.end(), generator);
+
+		// 第一个元素的引用在多次rehash之后仍然有效
+		auto& first = (*obj)[vRoleIds[0]];
+		first = 1;
+		ref[vRoleIds[0]] = 1;
+		for (size_t i = 1; i < vRoleIds.size(); i++) {
+			auto res = obj->insert(std::make_pair(vRoleIds[i], vRoleIds[i] + 1));
+			assert(res.second);
+			assert(res.first->first == vRoleIds[i]);
+			ref[vRoleIds[i]] = vRoleIds[i] + 1;
+		}
+		assert(&first == &obj->at(vRoleIds[0]));
+		assert(first == 1);
+		assert(IsEqual(*obj, ref));
+
+		// 已经存在的key
+		assert(!obj->insert(std::make_pair(vRoleIds[1], uint64_t(0))).second);
+		assert(!obj->try_emplace(vRoleIds[1], uint64_t(0)).second);
+		assert(!obj->emplace(vRoleIds[1], uint64_t(0)).second);
+		assert(obj->at(vRoleIds[1]) == vRoleIds[1] + 1);
+
+		auto res = obj->insert_or_assign(vRoleIds[1], uint64_t(5));
+		assert(!res.second && res.first->second == 5);
+		ref[vRoleIds[1]] = 5;
+		res = obj->insert_or_assign(3, uint64_t(6));
+		assert(res.second && res.first->second == 6);
+		ref[3] = 6;
+		assert(obj->try_emplace(4, uint64_t(7)).second);
+		ref[4] = 7;
+		assert(obj->emplace(5, uint64_t(8)).second);
+		ref[5] = 8;
+		assert(IsEqual(*obj, ref));
+
+		std::shuffle(vRoleIds.begin(), vRoleIds.end(), generator);
+		for (size_t i = 0; i < vRoleIds.size() / 2; i++) {
+			assert(obj->erase(vRoleIds[i]) == 1);
+			assert(obj->erase(vRoleIds[i]) == 0);
+			ref.erase(vRoleIds[i]);
+		}
+		assert(IsEqual(*obj, ref));
+
+		// 拷贝出来的和原来的一样
+		auto copy = smd::g_alloc->New<smd::shm_unordered_map<uint64_t, uint64_t>>(*obj);
+		assert(IsEqual(*copy, ref));
+		smd::g_alloc->Delete(copy);
+
+		obj->clear();
+		assert(obj->empty());
+		assert(obj->begin() == obj->end());
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestUnorderedMapPod complete");
+	}
+
+	void TestUnorderedMapString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_unordered_map<smd::shm_string, smd::shm_string>>();
+		std::unordered_map<std::string, std::string> ref;
+
+		const int COUNT = 1000;
+		for (int i = 0; i < COUNT; i++) {
+			auto key = smd::util::Text::Format("Key%05d", i);
+			auto value = smd::util::Text::Format("Value%05d", i);
+			(*obj)[smd::shm_string(key)] = value;
+			ref[key] = value;
+		}
+		assert(obj->size() == COUNT);
+
+		for (int i = 0; i < COUNT; i += 3) {
+			auto key = smd::util::Text::Format("Key%05d", i);
+			assert(obj->erase(smd::shm_string(key)) == 1);
+			ref.erase(key);
+		}
+
+		assert(obj->size() == ref.size());
+		for (auto it = obj->begin(); it != obj->end(); ++it) {
+			auto it_ref = ref.find(it->first.ToString());
+			assert(it_ref != ref.end());
+			assert(it_ref->second == it->second.ToString());
+		}
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestUnorderedMapString complete");
+	}
+
+	// 用Slice、std::string_view、const char*、std::string查找，不能分配共享内存
+	void TestHeterogeneousLookup() {
+		auto total_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_unordered_map<smd::shm_string, smd::shm_string>>();
+		auto set = smd::g_alloc->New<smd::shm_hash<smd::shm_string>>();
+		auto flat = smd::g_alloc->New<smd::shm_flat_hash_map<smd::shm_string, int>>();
+		auto tree = smd::g_alloc->New<smd::shm_map<smd::shm_string, int>>();
+		for (int i = 0; i < 100; i++) {
+			auto key = smd::util::Text::Format("Key%05d", i);
+			(*obj)[smd::shm_string(key)] = key;
+			set->insert(smd::shm_string(key));
+			(*flat)[smd::shm_string(key)] = i;
+			tree->insert(std::make_pair(smd::shm_string(key), i));
+		}
+
+		auto mem_usage = smd::g_alloc->GetUsed();
+		const std::string key = "Key00042";
+		const smd::Slice slice(key);
+		const std::string_view view(key);
+		const char* cstr = key.c_str();
+
+		assert(obj->find(slice) != obj->end() && obj->find(slice)->second == key);
+		assert(obj->find(view) != obj->end());
+		assert(obj->find(cstr) != obj->end());
+		assert(obj->find(key) != obj->end());
+		assert(obj->count("Key00007") == 1);
+		assert(obj->contains(smd::Slice("Key00100")) == false);
+
+		assert(set->find(slice) != set->end());
+		assert(set->contains(view));
+		assert(!set->contains("Key99999"));
+
+		assert(flat->find(slice) != flat->end() && flat->find(slice)->second == 42);
+		assert(flat->contains(view));
+		assert(flat->count(cstr) == 1);
+		assert(!flat->contains("Key99999"));
+
+		assert(tree->find(slice) != tree->end() && tree->find(slice)->second == 42);
+		assert(tree->find(view) != tree->end());
+		assert(tree->find(key) != tree->end());
+		assert(tree->find(smd::Slice("Key99999")) == tree->end());
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		// 删除也可以直接用Slice
+		assert(obj->erase(slice) == 1);
+		assert(obj->erase(view) == 0);
+		assert(set->erase(cstr) == 1);
+		assert(flat->erase(slice) == 1);
+		assert(obj->size() == 99 && set->size() == 99 && flat->size() == 99);
+		assert(mem_usage > smd::g_alloc->GetUsed());
+
+		smd::g_alloc->Delete(tree);
+		smd::g_alloc->Delete(flat);
+		smd::g_alloc->Delete(set);
+		smd::g_alloc->Delete(obj);
+		assert(total_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestHeterogeneousLookup complete");
+	}
+
+	template <class Map>
+	static bool IsEqual(Map& l, const std::unordered_map<uint64_t, uint64_t>& r) {
+		if (l.size() != r.size())
+			return false;
+
+		for (auto it = l.begin(); it != l.end(); ++it) {
+			auto it_ref = r.find(it->first);
+			if (it_ref == r.end() || it_ref->second != it->second)
+				return false;
+		}
+
+		for (auto it = r.begin(); it != r.end(); ++it) {
+			auto itl = l.find(it->first);
+			if (itl == l.end() || itl->second != it->second)
+				return false;
+		}
+
+		return true;
+	}
+};
@@ -7,6 +7,8 @@ public:
 		TestShmVector();
 		TestShmVectorResize();
 		TestShmVectorPod();
+		TestShmVectorContiguous();
+		TestShmVectorInsertErase();
 	}
 
 private:
@@ -122,6 +124,127 @@ private:
 		SMD_LOG_INFO("TestShmVectorPod complete");
 	}
 
+	void TestShmVectorContiguous() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto v = smd::g_alloc->New<smd::shm_vector<int>>();
+
+		// 元素连续存放，扩容的时候整体搬迁
+		const int COUNT = 1000;
+		for (int i = 0; i < COUNT; i++) {
+			v->push_back(i);
+		}
+		assert(v->size() == COUNT);
+		assert(v->capacity() >= COUNT);
+		for (int i = 0; i < COUNT; i++) {
+			assert((*v)[i] == i);
+			assert(&(*v)[i] == v->data() + i);
+		}
+
+		int sum = 0;
+		for (auto& element : *v) {
+			sum += element;
+		}
+		assert(sum == COUNT * (COUNT - 1) / 2);
+
+		// 自身元素作为参数，扩容之后仍然正确
+		while (v->size() != v->capacity()) {
+			v->push_back(0);
+		}
+		v->push_back(v->front());
+		assert(v->back() == 0);
+		assert((*v)[1] == 1);
+
+		smd::g_alloc->Delete(v);
+		assert(v == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		auto s = smd::g_alloc->New<smd::shm_vector<smd::shm_string>>();
+		for (int i = 0; i < COUNT; i++) {
+			s->push_back(smd::shm_string(smd::util::Text::Format("TestText%04d", i)));
+		}
+		s->push_back(s->front());
+		assert(s->size() == COUNT + 1);
+		assert(s->back().ToString() == "TestText0000");
+		assert((*s)[COUNT - 1].ToString() == "TestText0999");
+
+		smd::g_alloc->Delete(s);
+		assert(s == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmVectorContiguous complete");
+	}
+
+	void TestShmVectorInsertErase() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto v = smd::g_alloc->New<smd::shm_vector<smd::shm_string>>();
+		std::vector<std::string> ref;
+
+		for (int i = 0; i < 100; i++) {
+			auto text = smd::util::Text::Format("TestText%02d", i);
+			auto& element = v->emplace_back(text);
+			assert(element.ToString() == text);
+			ref.emplace_back(text);
+		}
+		assert(IsEqual(*v, ref));
+
+		// 在任意位置插入
+		v->insert(v->begin(), smd::shm_string("head"));
+		ref.insert(ref.begin(), "head");
+		v->insert(v->begin() + 50, smd::shm_string("middle"));
+		ref.insert(ref.begin() + 50, "middle");
+		v->emplace(v->end(), "tail");
+		ref.emplace(ref.end(), "tail");
+		v->insert(v->begin() + 3, (*v)[7]);
+		ref.insert(ref.begin() + 3, ref[7]);
+		assert(IsEqual(*v, ref));
+
+		// 在任意位置删除
+		auto it = v->erase(v->begin() + 10);
+		ref.erase(ref.begin() + 10);
+		assert(*it == ref[10]);
+		v->erase(v->begin(), v->begin() + 20);
+		ref.erase(ref.begin(), ref.begin() + 20);
+		v->erase(v->end() + (-1));
+		ref.pop_back();
+		assert(IsEqual(*v, ref));
+
+		// 缩容之后元素不变
+		auto old_capacity = v->capacity();
+		v->shrink_to_fit();
+		assert(v->capacity() <= old_capacity);
+		assert(v->capacity() >= v->size());
+		assert(IsEqual(*v, ref));
+
+		v->clear();
+		v->shrink_to_fit();
+		assert(v->capacity() == 0);
+		v->push_back(smd::shm_string("again"));
+		assert(v->size() == 1);
+		smd::g_alloc->Delete(v);
+
+		auto pod = smd::g_alloc->New<smd::shm_vector<int>>();
+		std::vector<int> pod_ref;
+		for (int i = 0; i < 1000; i++) {
+			auto pos = smd::util::Random::RandomInt<size_t>(0, pod->size());
+			pod->insert(pod->begin() + pos, i);
+			pod_ref.insert(pod_ref.begin() + pos, i);
+		}
+		for (int i = 0; i < 500; i++) {
+			auto pos = smd::util::Random::RandomInt<size_t>(0, pod->size() - 1);
+			pod->erase(pod->begin() + pos);
+			pod_ref.erase(pod_ref.begin() + pos);
+		}
+		assert(pod->size() == pod_ref.size());
+		for (size_t i = 0; i < pod_ref.size(); i++) {
+			assert((*pod)[i] == pod_ref[i]);
+		}
+		pod->shrink_to_fit();
+		assert(pod->capacity() < 1000);
+		smd::g_alloc->Delete(pod);
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmVectorInsertErase complete");
+	}
+
 private:
 	//测试专用
 	bool IsEqual(smd::shm_vector<smd::shm_string>& l, const std::vector<std::string>& r) {
@@ -1,8 +1,9 @@
 ﻿#include <stdio.h>
 #include <sm_env.h>
 
+// 日志只在尾部追加，按顺序读出，用分段连续的shm_deque比链表省掉了每条日志一个节点
 struct StSmdLog {
-	smd::shm_list<smd::shm_string> logs;
+	smd::shm_deque<smd::shm_string> logs;
 };
 
 int main(int argc, char* argv[]) {
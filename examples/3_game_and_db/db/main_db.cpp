@@ -1,6 +1,9 @@
 ﻿#include "main_db.h"
 #include <iostream>
 #include <limits.h>
+#include <set>
+#include <vector>
+#include <common/persist_pipeline.h>
 #include "DataCenter.h"
 
 using std::cin;
@@ -17,8 +20,118 @@ std::string getTime() {
 	return sztmp;
 }
 
+// 从共享内存中拷出来的玩家，落地线程池只访问这份拷贝
+struct PlayerSnapshot {
+	uint64_t playerid;
+	std::string playername;
+	int level;
+	std::string lastlogintime;
+	std::string lastlogouttime;
+	std::vector<std::pair<int64_t, int>> items;
+};
+
+// 在主线程中调用，读完就不再引用共享内存
+PlayerSnapshot snapshotPlayer(const UniqsModel::Player& player) {
+	PlayerSnapshot snapshot;
+	snapshot.playerid = player.GetPlayerid();
+	snapshot.playername = player.GetPlayername().ToString();
+	snapshot.level = player.GetLevel();
+	snapshot.lastlogintime = player.GetLastlogintime().ToString();
+	snapshot.lastlogouttime = player.GetLastlogouttime().ToString();
+	snapshot.items.reserve(player.GetItems().size());
+	for (auto& it_item : player.GetItems()) {
+		snapshot.items.emplace_back(it_item.second.GetItemid(), it_item.second.GetParam1());
+	}
+	return snapshot;
+}
+
+// 编码一个玩家，在落地线程池中调用
+void serializePlayer(const PlayerSnapshot& player, std::string* out) {
+	*out = std::to_string(player.playerid) + "|" + player.playername + "|" + std::to_string(player.level) + "|" +
+		   player.lastlogintime + "|" + player.lastlogouttime + "|";
+	for (auto& item : player.items) {
+		out->append(std::to_string(item.first)).append(":").append(std::to_string(item.second)).append(",");
+	}
+}
+
+// 玩家落地到文件，同时记下文件中现在有哪些玩家
+// 变更日志溢出之后只能拿players和这个集合比对，才知道哪些玩家在这期间被删除了
+struct PlayerStore {
+	explicit PlayerStore(const std::string& path)
+		: sink(path)
+		, pipeline(&sink) {
+		// 回放已有的文件，最后一条是删除的玩家不在文件中
+		smd::PersistFileSink::Load(path, [this](const smd::PersistRecord& r) {
+			if (r.erased) {
+				saved.erase(r.key);
+			} else {
+				saved.insert(r.key);
+			}
+		});
+	}
+
+	smd::PersistFileSink sink;
+	smd::PersistPipeline pipeline;
+	std::set<int64_t> saved;
+};
+
+// 提交一个玩家，不在players中的就是被删除了
+// 共享内存在这里同步读完，game之后再修改或删除这个玩家都不影响已经提交的数据
+// 读的时候和打印一样不与game加锁，game正在修改这个玩家时拷贝可能不一致，下一次变更会再提交一次
+void submitPlayer(UniqsModel::DataCenter& data_center, PlayerStore& store, int64_t player_id) {
+	auto it = data_center.players.find(player_id);
+	if (it == data_center.players.end()) {
+		store.pipeline.SubmitErase(UniqsModel::kTablePlayers, player_id);
+		store.saved.erase(player_id);
+		return;
+	}
+	store.pipeline.Submit(UniqsModel::kTablePlayers, player_id,
+						  [snapshot = snapshotPlayer(it->second)](std::string* out) { serializePlayer(snapshot, out); });
+	store.saved.insert(player_id);
+}
+
+// 按批读取变更日志，同一个玩家在一批中改了多次只提交一次，队列满时这里会被阻塞
+void syncChanges(UniqsModel::DataCenter& data_center, PlayerStore& store) {
+	auto overflow = data_center.changes.take_overflow();
+	if (overflow > 0) {
+		// 有变更丢失，退化为全量同步：现有的玩家全部重写，文件中有但players中没有的玩家写删除
+		data_center.changes.consume([](const smd::ChangeRecord*, size_t) {});
+		std::vector<int64_t> erased;
+		for (auto player_id : store.saved) {
+			if (data_center.players.find(player_id) == data_center.players.end()) {
+				erased.push_back(player_id);
+			}
+		}
+		for (auto player_id : erased) {
+			submitPlayer(data_center, store, player_id);
+		}
+		for (auto& kv : data_center.players) {
+			submitPlayer(data_center, store, kv.first);
+		}
+		cout << "change log overflowed (" << overflow << " dropped), full sync " << data_center.players.size()
+			 << " players, " << erased.size() << " erased" << endl;
+		return;
+	}
+
+	std::set<int64_t> dirty_players;
+	auto total = data_center.changes.consume([&](const smd::ChangeRecord* records, size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			dirty_players.insert(records[i].key);
+		}
+	});
+
+	for (auto player_id : dirty_players) {
+		submitPlayer(data_center, store, player_id);
+	}
+	cout << total << " changes, " << dirty_players.size() << " players submitted" << endl;
+}
+
 int main_db(UniqsModel::DataCenter& data_center) {
 	auto obj = &data_center.players;
+	// 变化过的玩家追加写到文件中，退出时写完剩下的
+	PlayerStore store("db_players.dat");
+	auto& pipeline = store.pipeline;
+	cout << store.saved.size() << " players in db_players.dat" << endl;
 	std::string input;
 	while (true) {
 		cin >> input;
@@ -27,6 +140,20 @@ int main_db(UniqsModel::DataCenter& data_center) {
 			break;
 		}
 
+		if (input == "sync") {
+			syncChanges(data_center, store);
+			continue;
+		}
+
+		// 等待提交的玩家全部写完
+		if (input == "flush") {
+			pipeline.Flush();
+			auto stats = pipeline.GetStats();
+			cout << "persist submitted:" << stats.submitted << " written:" << stats.written
+				 << " failed:" << stats.failed << " batches:" << stats.batches << endl;
+			continue;
+		}
+
 		int64_t playerId;
 
 		auto parseInput = [&](const std::string& op) {
@@ -47,16 +174,16 @@ int main_db(UniqsModel::DataCenter& data_center) {
 					break;
 				}
 				auto& player = it->second;
-				cout << "playerid:" << player.playerid << "\tplayername：" << player.playername.ToString()
-					 << "\tlevel:" << player.level << "\t";
+				cout << "playerid:" << player.GetPlayerid() << "\tplayername：" << player.GetPlayername().ToString()
+					 << "\tlevel:" << player.GetLevel() << "\t";
 				cout << endl;
-				cout << "lastlogintime:" << player.lastlogintime.ToString()
-					 << "\tlastlogouttime:" << player.lastlogouttime.ToString() << "\t";
+				cout << "lastlogintime:" << player.GetLastlogintime().ToString()
+					 << "\tlastlogouttime:" << player.GetLastlogouttime().ToString() << "\t";
 				cout << endl;
 				cout << "items:=============================" << endl;
-				for (auto it_item : player.items) {
-					cout << "itemid:" << it_item.second.itemid << "\t";
-					cout << "param1:" << it_item.second.param1 << " | ";
+				for (auto& it_item : player.GetItems()) {
+					cout << "itemid:" << it_item.second.GetItemid() << "\t";
+					cout << "param1:" << it_item.second.GetParam1() << " | ";
 				}
 				cout << endl;
 				cout << " ******************************************************************************** " << endl;
@@ -17,8 +17,30 @@ std::string getTime() {
 	return sztmp;
 }
 
+// 落地所有脏玩家：新建的整行写，修改过的只写脏字段和脏key，写完清除脏标记
+void savePlayers(UniqsModel::DataCenter& data_center) {
+	size_t count = 0;
+	data_center.ForEachDirtyPlayer([&count](int64_t id, const UniqsModel::Player* player) {
+		++count;
+		if (player == nullptr) {
+			cout << "delete player " << id << endl;
+			return;
+		}
+		cout << "save player " << id << " fields:0x" << std::hex << player->GetDirtyFields() << std::dec;
+		if (player->IsDirty(UniqsModel::Player::kItems)) {
+			cout << " items:";
+			for (auto item_id : player->GetItemsDirty()) {
+				auto& items = player->GetItems();
+				cout << (items.find(item_id) != items.end() ? " +" : " -") << item_id;
+			}
+		}
+		cout << endl;
+	});
+	data_center.ClearDirty();
+	cout << count << " players saved" << endl;
+}
+
 int main_game(UniqsModel::DataCenter& data_center) {
-	auto obj = &data_center.players;
 	std::string input;
 	while (true) {
 		cin >> input;
@@ -27,6 +49,11 @@ int main_game(UniqsModel::DataCenter& data_center) {
 			break;
 		}
 
+		if (input == "save") {
+			savePlayers(data_center);
+			continue;
+		}
+
 		int64_t playerId;
 
 		auto parseInput = [&](const std::string& op) {
@@ -41,73 +68,79 @@ int main_game(UniqsModel::DataCenter& data_center) {
 		do {
 			parseInput("login.");
 			if (playerId > 0) {
-				UniqsModel::Player player;
-				player.playerid = playerId;
-				player.level = 1;
-				player.playername = "I am player [" + std::to_string(playerId) + "]";
-				player.lastlogintime = getTime();
-				obj->insert(std::make_pair(playerId, player));
+				// 直接在共享内存的节点中构造，已经存在的玩家不会多构造一份再丢掉
+				auto res = data_center.EmplacePlayer(playerId);
+				auto player = res.first;
+				if (res.second) {
+					player->SetLevel(1);
+					player->SetPlayername("I am player [" + std::to_string(playerId) + "]");
+				}
+				player->SetLastlogintime(getTime());
 				break;
 			}
 
 			parseInput("logout.");
 			if (playerId > 0) {
-				auto it = obj->find(playerId);
-				if (it == obj->end()) {
+				auto player = data_center.MutablePlayer(playerId);
+				if (player == nullptr) {
 					cout << "player not found." << endl;
 					break;
 				}
-				auto& player = it->second;
-				player.lastlogouttime = getTime();
+				player->SetLastlogouttime(getTime());
+				break;
+			}
+
+			parseInput("delplayer.");
+			if (playerId > 0) {
+				if (!data_center.ErasePlayer(playerId)) {
+					cout << "player not found." << endl;
+				}
 				break;
 			}
 
 			parseInput("levelup.");
 			if (playerId > 0) {
-				auto it = obj->find(playerId);
-				if (it == obj->end()) {
+				auto player = data_center.MutablePlayer(playerId);
+				if (player == nullptr) {
 					cout << "player not found." << endl;
 					break;
 				}
-				auto& player = it->second;
-				++player.level;
+				player->SetLevel(player->GetLevel() + 1);
 				break;
 			}
 
 			parseInput("additem.");
 			if (playerId > 0) {
-				auto it = obj->find(playerId);
-				if (it == obj->end()) {
+				auto player = data_center.MutablePlayer(playerId);
+				if (player == nullptr) {
 					cout << "player not found." << endl;
 					break;
 				}
-				auto& player = it->second;
 				UniqsModel::Item item;
-				item.itemid = 200 - player.items.size();
-				item.param1 = 1234;
-				cout << "added item " << item.itemid << endl;
-				player.items.insert(std::make_pair(item.itemid, item));
+				item.SetItemid(200 - player->GetItems().size());
+				item.SetParam1(1234);
+				cout << "added item " << item.GetItemid() << endl;
+				player->SetItems(item.GetItemid(), item);
 
 				break;
 			}
 
 			parseInput("delitem.");
 			if (playerId > 0) {
-				auto it = obj->find(playerId);
-				if (it == obj->end()) {
+				auto player = data_center.MutablePlayer(playerId);
+				if (player == nullptr) {
 					cout << "player not found." << endl;
 					break;
 				}
-				auto& player = it->second;
-				if (player.items.empty()) {
+				if (player->GetItems().empty()) {
 					cout << "no item to delete" << endl;
 					break;
 				}
 				int64_t itemId = INT_MAX;
-				for (auto it_item : player.items) {
+				for (auto& it_item : player->GetItems()) {
 					itemId = std::min(it_item.first, itemId);
 				}
-				player.items.erase(player.items.find(itemId));
+				player->EraseItems(itemId);
 				cout << "del item " << itemId << endl;
 			}
 		} while (false);
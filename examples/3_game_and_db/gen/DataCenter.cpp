@@ -3,3 +3,46 @@
 
 #include "DataCenter.h"
 #include "uniqsmodelDefines.h"
+
+namespace UniqsModel {
+std::pair<Player*, bool> DataCenter::EmplacePlayer(int64_t id) {
+	auto res = players.try_emplace(id);
+	auto& player = res.first->second;
+	if (res.second) {
+		player.SetPlayerid(id);
+		player.SetAllDirty();
+	}
+	dirty_players.insert(id);
+	changes.emit(kTablePlayers, res.second ? smd::ChangeOp::kInsert : smd::ChangeOp::kUpdate, id);
+	return std::make_pair(&player, res.second);
+}
+
+Player* DataCenter::MutablePlayer(int64_t id) {
+	auto it = players.find(id);
+	if (it == players.end())
+		return nullptr;
+
+	dirty_players.insert(id);
+	changes.emit(kTablePlayers, smd::ChangeOp::kUpdate, id);
+	return &it->second;
+}
+
+bool DataCenter::ErasePlayer(int64_t id) {
+	if (players.erase(id) == 0)
+		return false;
+
+	dirty_players.insert(id);
+	changes.emit(kTablePlayers, smd::ChangeOp::kErase, id);
+	return true;
+}
+
+void DataCenter::ClearDirty() {
+	for (auto id : dirty_players) {
+		auto it = players.find(id);
+		if (it != players.end()) {
+			it->second.ClearDirty();
+		}
+	}
+	smd::shm_flat_hash_set<int64_t>().swap(dirty_players);
+}
+} // namespace UniqsModel
@@ -7,8 +7,36 @@
 #include "Player.h"
 
 namespace UniqsModel {
+// 变更记录中的容器ID
+enum EDataCenterTable : uint32_t {
+	kTablePlayers = 1,
+};
+
 class DataCenter {
 public:
+	// 所有玩家，修改要通过下面的接口，才能记下变更和脏标记
 	smd::shm_map<int64_t, UniqsModel::Player> players;
+	// game写入，db按批读取之后只落地变化过的对象
+	smd::shm_change_log changes;
+	// 上次ClearDirty之后增删改过的玩家，不在players中的就是被删除了
+	smd::shm_flat_hash_set<int64_t> dirty_players;
+
+	// 不存在时新建，新建的玩家整行都是脏的
+	std::pair<Player*, bool> EmplacePlayer(int64_t id);
+	// 要修改的玩家，不存在时返回nullptr
+	Player* MutablePlayer(int64_t id);
+	bool ErasePlayer(int64_t id);
+
+	// f(int64_t id, const Player* player)，被删除的玩家player为nullptr
+	template <class F>
+	void ForEachDirtyPlayer(F&& f) const {
+		for (auto id : dirty_players) {
+			auto it = players.find(id);
+			f(id, it != players.end() ? &it->second : nullptr);
+		}
+	}
+
+	// 落地之后清除所有脏标记，只能由修改数据的进程调用
+	void ClearDirty();
 };
 } // namespace UniqsModel
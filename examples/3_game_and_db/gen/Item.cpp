@@ -10,5 +10,11 @@ namespace UniqsModel
 	{
 		itemid = 0;
 		param1 = 0;
+		dirty_fields = 0;
+	}
+
+	void Item::ClearDirty()
+	{
+		dirty_fields = 0;
 	}
 }
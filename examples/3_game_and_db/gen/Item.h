@@ -11,14 +11,44 @@ namespace UniqsModel
 	class Item
 	{
 	public:
-		// 物品ID
-		int64_t itemid;
-		// 参数1
-		int param1;
+		// 字段编号，也是脏标记中的位
+		enum EField
+		{
+			kItemid = 0,
+			kParam1 = 1,
+			kFieldCount = 2,
+		};
 
 	public:
 		Item(){ Clear(true); }
 
 		void Clear(bool bDestruct);
+
+		// 物品ID
+		int64_t GetItemid() const { return itemid; }
+		void SetItemid(int64_t value) { itemid = value; SetDirty(kItemid); }
+
+		// 参数1
+		int GetParam1() const { return param1; }
+		void SetParam1(int value) { param1 = value; SetDirty(kParam1); }
+
+		// 脏标记，记录上次ClearDirty之后修改过哪些字段
+		bool IsDirty() const { return dirty_fields != 0; }
+		bool IsDirty(EField field) const { return (dirty_fields >> field) & 1; }
+		uint32_t GetDirtyFields() const { return dirty_fields; }
+		void SetAllDirty() { dirty_fields = (1u << kFieldCount) - 1; }
+		void ClearDirty();
+
+	private:
+		void SetDirty(EField field) { dirty_fields |= 1u << field; }
+
+	private:
+		// 物品ID
+		int64_t itemid;
+		// 参数1
+		int param1;
+
+		// 修改过的字段
+		uint32_t dirty_fields;
 	};
 }
@@ -17,5 +17,138 @@ namespace UniqsModel
 		items.clear();
 		equips1.clear();
 		equips2.clear();
+		ClearDirty();
+	}
+
+	Item* Player::MutableItems(int64_t key)
+	{
+		auto it = items.find(key);
+		if (it == items.end())
+			return nullptr;
+
+		SetDirty(kItems);
+		items_dirty.insert(key);
+		return &it->second;
+	}
+
+	void Player::SetItems(int64_t key, const Item& value)
+	{
+		items.insert_or_assign(key, value);
+		SetDirty(kItems);
+		items_dirty.insert(key);
+	}
+
+	bool Player::EraseItems(int64_t key)
+	{
+		if (items.erase(key) == 0)
+			return false;
+
+		SetDirty(kItems);
+		items_dirty.insert(key);
+		return true;
+	}
+
+	void Player::ClearItems()
+	{
+		for (auto& kv : items)
+		{
+			items_dirty.insert(kv.first);
+		}
+		items.clear();
+		SetDirty(kItems);
+	}
+
+	int* Player::MutableEquips1(int key)
+	{
+		auto it = equips1.find(key);
+		if (it == equips1.end())
+			return nullptr;
+
+		SetDirty(kEquips1);
+		equips1_dirty.insert(key);
+		return &it->second;
+	}
+
+	void Player::SetEquips1(int key, int value)
+	{
+		equips1.insert_or_assign(key, value);
+		SetDirty(kEquips1);
+		equips1_dirty.insert(key);
+	}
+
+	bool Player::EraseEquips1(int key)
+	{
+		if (equips1.erase(key) == 0)
+			return false;
+
+		SetDirty(kEquips1);
+		equips1_dirty.insert(key);
+		return true;
+	}
+
+	void Player::ClearEquips1()
+	{
+		for (auto& kv : equips1)
+		{
+			equips1_dirty.insert(kv.first);
+		}
+		equips1.clear();
+		SetDirty(kEquips1);
+	}
+
+	int* Player::MutableEquips2(uint64_t key)
+	{
+		auto it = equips2.find(key);
+		if (it == equips2.end())
+			return nullptr;
+
+		SetDirty(kEquips2);
+		equips2_dirty.insert(key);
+		return &it->second;
+	}
+
+	void Player::SetEquips2(uint64_t key, int value)
+	{
+		equips2.insert_or_assign(key, value);
+		SetDirty(kEquips2);
+		equips2_dirty.insert(key);
+	}
+
+	bool Player::EraseEquips2(uint64_t key)
+	{
+		if (equips2.erase(key) == 0)
+			return false;
+
+		SetDirty(kEquips2);
+		equips2_dirty.insert(key);
+		return true;
+	}
+
+	void Player::ClearEquips2()
+	{
+		for (auto& kv : equips2)
+		{
+			equips2_dirty.insert(kv.first);
+		}
+		equips2.clear();
+		SetDirty(kEquips2);
+	}
+
+	void Player::ClearDirty()
+	{
+		dirty_fields = 0;
+		item.ClearDirty();
+		// map中的对象只有脏key对应的可能被修改过，被删除的key已经不在map中了
+		for (auto key : items_dirty)
+		{
+			auto it = items.find(key);
+			if (it != items.end())
+			{
+				it->second.ClearDirty();
+			}
+		}
+		smd::shm_flat_hash_set<int64_t>().swap(items_dirty);
+		smd::shm_flat_hash_set<int>().swap(equips1_dirty);
+		smd::shm_flat_hash_set<uint64_t>().swap(equips2_dirty);
 	}
 }
@@ -12,6 +12,88 @@ namespace UniqsModel
 	class Player
 	{
 	public:
+		// 字段编号，也是脏标记中的位
+		enum EField
+		{
+			kPlayerid = 0,
+			kLevel = 1,
+			kPlayername = 2,
+			kLastlogintime = 3,
+			kLastlogouttime = 4,
+			kItem = 5,
+			kItems = 6,
+			kEquips1 = 7,
+			kEquips2 = 8,
+			kFieldCount = 9,
+		};
+
+	public:
+		Player(){ Clear(true); }
+
+		void Clear(bool bDestruct);
+
+		// 玩家ID
+		uint64_t GetPlayerid() const { return playerid; }
+		void SetPlayerid(uint64_t value) { playerid = value; SetDirty(kPlayerid); }
+
+		// 玩家等级
+		int GetLevel() const { return level; }
+		void SetLevel(int value) { level = value; SetDirty(kLevel); }
+
+		// 玩家名
+		const smd::shm_string& GetPlayername() const { return playername; }
+		void SetPlayername(const smd::Slice& value) { playername = value; SetDirty(kPlayername); }
+
+		// 最后登录时间
+		const smd::shm_string& GetLastlogintime() const { return lastlogintime; }
+		void SetLastlogintime(const smd::Slice& value) { lastlogintime = value; SetDirty(kLastlogintime); }
+
+		// 最后登出时间
+		const smd::shm_string& GetLastlogouttime() const { return lastlogouttime; }
+		void SetLastlogouttime(const smd::Slice& value) { lastlogouttime = value; SetDirty(kLastlogouttime); }
+
+		// 某任务道具
+		const Item& GetItem() const { return item; }
+		Item& MutableItem() { SetDirty(kItem); return item; }
+
+		// 玩家的所有物品
+		// 修改和删除过的key记录在GetItemsDirty()中，落地时只需要写这些key
+		const smd::shm_map<int64_t, Item>& GetItems() const { return items; }
+		Item* MutableItems(int64_t key);
+		void SetItems(int64_t key, const Item& value);
+		bool EraseItems(int64_t key);
+		void ClearItems();
+		const smd::shm_flat_hash_set<int64_t>& GetItemsDirty() const { return items_dirty; }
+
+		// 身上装备1
+		const smd::shm_map<int, int>& GetEquips1() const { return equips1; }
+		int* MutableEquips1(int key);
+		void SetEquips1(int key, int value);
+		bool EraseEquips1(int key);
+		void ClearEquips1();
+		const smd::shm_flat_hash_set<int>& GetEquips1Dirty() const { return equips1_dirty; }
+
+		// 身上装备2
+		const smd::shm_map<uint64_t, int>& GetEquips2() const { return equips2; }
+		int* MutableEquips2(uint64_t key);
+		void SetEquips2(uint64_t key, int value);
+		bool EraseEquips2(uint64_t key);
+		void ClearEquips2();
+		const smd::shm_flat_hash_set<uint64_t>& GetEquips2Dirty() const { return equips2_dirty; }
+
+		// 脏标记，记录上次ClearDirty之后修改过哪些字段
+		bool IsDirty() const { return dirty_fields != 0; }
+		bool IsDirty(EField field) const { return (dirty_fields >> field) & 1; }
+		uint32_t GetDirtyFields() const { return dirty_fields; }
+		// 新建的对象要整行写入
+		void SetAllDirty() { dirty_fields = (1u << kFieldCount) - 1; }
+		// 清除自己、嵌套字段和map中对象的脏标记，记录脏key的空间也一起释放
+		void ClearDirty();
+
+	private:
+		void SetDirty(EField field) { dirty_fields |= 1u << field; }
+
+	private:
 		// 玩家ID
 		uint64_t playerid;
 		// 玩家等级
@@ -31,9 +113,11 @@ namespace UniqsModel
 		// 身上装备2
 		smd::shm_map<uint64_t, int> equips2;
 
-	public:
-		Player(){ Clear(true); }
-
-		void Clear(bool bDestruct);
+		// 修改过的字段
+		uint32_t dirty_fields;
+		// 各个map中修改或删除过的key，不在map中的就是被删除了
+		smd::shm_flat_hash_set<int64_t> items_dirty;
+		smd::shm_flat_hash_set<int> equips1_dirty;
+		smd::shm_flat_hash_set<uint64_t> equips2_dirty;
 	};
 }
@@ -0,0 +1,128 @@
+﻿#pragma once
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <smd.h>
+#include "bench_util.h"
+
+class BenchHash {
+public:
+	BenchHash(size_t count) {
+		std::vector<uint64_t> keys;
+		for (size_t i = 0; i < count; i++) {
+			keys.push_back(i * 2654435761ULL);
+		}
+		std::shuffle(keys.begin(), keys.end(), std::default_random_engine(12345));
+		m_lookups = keys;
+		std::shuffle(m_lookups.begin(), m_lookups.end(), std::default_random_engine(54321));
+
+		BenchSet<smd::shm_hash<uint64_t>>("shm_hash<uint64_t>", keys);
+		BenchSet<smd::shm_flat_hash_set<uint64_t>>("shm_flat_hash_set<uint64_t>", keys);
+		BenchSet<std::unordered_set<uint64_t>>("std::unordered_set<uint64_t>", keys);
+
+		BenchMap<smd::shm_flat_hash_map<uint64_t, uint64_t>>("shm_flat_hash_map<uint64_t, uint64_t>", keys);
+		BenchMap<std::unordered_map<uint64_t, uint64_t>>("std::unordered_map<uint64_t, uint64_t>", keys);
+
+		BenchInsertLatency<smd::shm_hash<uint64_t>>("shm_hash<uint64_t>", keys);
+		BenchInsertLatency<std::unordered_set<uint64_t>>("std::unordered_set<uint64_t>", keys);
+	}
+
+private:
+	template <class Set>
+	void BenchSet(const std::string& name, const std::vector<uint64_t>& keys) {
+		BenchSet<Set>(name, keys, m_lookups);
+	}
+
+	// 查找的顺序和插入的顺序不同，避免节点式容器因为按分配顺序访问而占便宜
+	template <class Set>
+	static void BenchSet(const std::string& name, const std::vector<uint64_t>& keys,
+		const std::vector<uint64_t>& lookups) {
+		auto obj = new (smd::g_alloc->Malloc<Set>().Ptr()) Set();
+		do {
+			BenchTimer timer;
+			for (auto key : keys) {
+				obj->insert(key);
+			}
+			timer.Report((name + "::insert").c_str(), keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t found = 0;
+			for (auto key : lookups) {
+				found += obj->find(key) != obj->end();
+			}
+			DoNotOptimize(found);
+			timer.Report((name + "::find hit").c_str(), keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t found = 0;
+			for (auto key : lookups) {
+				found += obj->find(key + 1) != obj->end();
+			}
+			DoNotOptimize(found);
+			timer.Report((name + "::find miss").c_str(), keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			for (auto key : keys) {
+				obj->erase(key);
+			}
+			timer.Report((name + "::erase").c_str(), keys.size());
+		} while (false);
+
+		obj->~Set();
+		auto p = smd::g_alloc->ToShmPointer<Set>(obj);
+		smd::g_alloc->Free(p);
+	}
+
+	// 单次插入的最大耗时，衡量扩容造成的卡顿
+	template <class Set>
+	static void BenchInsertLatency(const std::string& name, const std::vector<uint64_t>& keys) {
+		auto obj = new (smd::g_alloc->Malloc<Set>().Ptr()) Set();
+		double max_us = 0;
+		for (auto key : keys) {
+			BenchTimer timer;
+			obj->insert(key);
+			max_us = std::max(max_us, timer.ElapsedMs() * 1000);
+		}
+		SMD_LOG_INFO("%-56s %10zu ops %10.1f us max", (name + "::insert latency").c_str(), keys.size(), max_us);
+
+		obj->~Set();
+		auto p = smd::g_alloc->ToShmPointer<Set>(obj);
+		smd::g_alloc->Free(p);
+	}
+
+	template <class Map>
+	void BenchMap(const std::string& name, const std::vector<uint64_t>& keys) {
+		auto obj = new (smd::g_alloc->Malloc<Map>().Ptr()) Map();
+		do {
+			BenchTimer timer;
+			for (auto key : keys) {
+				(*obj)[key] = key;
+			}
+			timer.Report((name + "::operator[]").c_str(), keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (auto key : m_lookups) {
+				sum += obj->find(key)->second;
+			}
+			DoNotOptimize(sum);
+			timer.Report((name + "::find hit").c_str(), keys.size());
+		} while (false);
+
+		obj->~Map();
+		auto p = smd::g_alloc->ToShmPointer<Map>(obj);
+		smd::g_alloc->Free(p);
+	}
+
+private:
+	std::vector<uint64_t> m_lookups;
+};
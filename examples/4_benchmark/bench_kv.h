@@ -0,0 +1,96 @@
+﻿#pragma once
+#include <vector>
+#include <algorithm>
+#include <smd.h>
+#include "bench_util.h"
+
+// SmdEnv的字符串操作分别用shm_map和shm_unordered_map存放时的性能
+class BenchKv {
+public:
+	BenchKv(size_t count) {
+		// 短key直接存放在shm_string对象内部
+		MakeKeys(count, "Key%010zu");
+		Bench<smd::shm_map<smd::shm_string, smd::shm_string>>("shm_map<shm_string, shm_string>");
+		Bench<smd::shm_unordered_map<smd::shm_string, smd::shm_string>>("shm_unordered_map<shm_string, shm_string>");
+
+		// 超过22个字符的长key存放在单独分配的空间中，shm_map查找时每层都要比较
+		MakeKeys(count, "%010zu:player:profile:data");
+		Bench<smd::shm_map<smd::shm_string, smd::shm_string>>("shm_map<shm_string, shm_string> long key");
+		Bench<smd::shm_unordered_map<smd::shm_string, smd::shm_string>>(
+			"shm_unordered_map<shm_string, shm_string> long key");
+	}
+
+private:
+	void MakeKeys(size_t count, const char* format) {
+		m_keys.clear();
+		for (size_t i = 0; i < count; i++) {
+			m_keys.push_back(smd::util::Text::Format(format, i * 2654435761ULL % 10000000000ULL));
+		}
+		std::shuffle(m_keys.begin(), m_keys.end(), std::default_random_engine(12345));
+	}
+
+	// 和SmdEnv::SSet一样直接用Slice查找
+	template <class Container>
+	static void SSet(Container& all_strings, const smd::Slice& key, const smd::Slice& value) {
+		auto it = all_strings.find(key);
+		if (it == all_strings.end()) {
+			all_strings.insert(std::make_pair(smd::shm_string(key.data(), key.size()), smd::shm_string(value.data(), value.size())));
+		} else {
+			it->second.assign(value);
+		}
+	}
+
+	// 和SmdEnv::SGet的实现相同
+	template <class Container>
+	static bool SGet(Container& all_strings, const smd::Slice& key, smd::Slice* value) {
+		auto it = all_strings.find(key);
+		if (it == all_strings.end())
+			return false;
+
+		*value = smd::Slice(it->second.data(), it->second.size());
+		return true;
+	}
+
+	template <class Container>
+	void Bench(const std::string& name) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = new (smd::g_alloc->Malloc<Container>().Ptr()) Container();
+		do {
+			BenchTimer timer;
+			for (const auto& key : m_keys) {
+				SSet(*obj, key, "value");
+			}
+			timer.Report((name + "::SSet insert").c_str(), m_keys.size());
+		} while (false);
+
+		// 每个key平均占用的共享内存，包括节点和bucket
+		SMD_LOG_INFO("%-56s %10zu keys %10.1f bytes/key", (name + "::memory").c_str(), m_keys.size(),
+			double(smd::g_alloc->GetUsed() - mem_usage) / double(m_keys.size()));
+
+		do {
+			BenchTimer timer;
+			for (const auto& key : m_keys) {
+				SSet(*obj, key, "value2");
+			}
+			timer.Report((name + "::SSet update").c_str(), m_keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t total = 0;
+			smd::Slice value;
+			for (const auto& key : m_keys) {
+				total += SGet(*obj, key, &value) ? value.size() : 0;
+			}
+			DoNotOptimize(total);
+			timer.Report((name + "::SGet").c_str(), m_keys.size());
+		} while (false);
+
+		obj->~Container();
+		auto p = smd::g_alloc->ToShmPointer<Container>(obj);
+		smd::g_alloc->Free(p);
+	}
+
+private:
+	std::vector<std::string> m_keys;
+};
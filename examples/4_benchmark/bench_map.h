@@ -0,0 +1,197 @@
+﻿#pragma once
+#include <vector>
+#include <algorithm>
+#include <smd.h>
+#include "bench_util.h"
+
+// 有序map：红黑树shm_map和B+树shm_btree_map对比
+class BenchOrderedMap {
+public:
+	BenchOrderedMap(size_t count) {
+		std::default_random_engine generator(12345);
+		for (size_t i = 0; i < count; i++) {
+			m_keys.push_back(uint64_t(generator()) * 2654435761ULL);
+		}
+		m_lookups = m_keys;
+		std::shuffle(m_lookups.begin(), m_lookups.end(), generator);
+
+		BenchBuild();
+		BenchPlayerItems(count);
+		Bench<smd::shm_map<uint64_t, uint64_t>>("shm_map<uint64_t, uint64_t>");
+		Bench<smd::shm_btree_map<uint64_t, uint64_t>>("shm_btree_map<uint64_t, uint64_t>");
+		Bench<smd::shm_btree_map<uint64_t, uint64_t, 4096>>("shm_btree_map<uint64_t, uint64_t, 4096>");
+	}
+
+private:
+	// 冷启动加载：逐个插入和批量构建对比
+	void BenchBuild() {
+		std::vector<std::pair<uint64_t, uint64_t>> rows;
+		for (auto key : m_keys) {
+			rows.push_back(std::make_pair(key, key));
+		}
+
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_map<uint64_t, uint64_t>>();
+		do {
+			BenchTimer timer;
+			for (const auto& row : rows) {
+				obj->insert(row);
+			}
+			timer.Report("shm_map<uint64_t, uint64_t>::insert unsorted rows", rows.size());
+		} while (false);
+		obj->clear();
+
+		do {
+			BenchTimer timer;
+			obj->build(rows.begin(), rows.end());
+			timer.Report("shm_map<uint64_t, uint64_t>::build unsorted rows", rows.size());
+		} while (false);
+		obj->clear();
+
+		std::sort(rows.begin(), rows.end());
+		do {
+			BenchTimer timer;
+			for (const auto& row : rows) {
+				obj->insert(row);
+			}
+			timer.Report("shm_map<uint64_t, uint64_t>::insert sorted rows", rows.size());
+		} while (false);
+		obj->clear();
+
+		do {
+			BenchTimer timer;
+			obj->build_sorted(rows.begin(), rows.end());
+			timer.Report("shm_map<uint64_t, uint64_t>::build_sorted", rows.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t total = 0;
+			for (auto it = obj->begin(); it != obj->end(); ++it) {
+				total += it->second;
+			}
+			DoNotOptimize(total);
+			timer.Report("shm_map<uint64_t, uint64_t>::scan after build_sorted", obj->size());
+		} while (false);
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+	}
+
+	// 大量玩家各自的道具map，道具是轮流加给每个玩家的，遍历单个玩家的所有道具
+	void BenchPlayerItems(size_t count) {
+		struct Item {
+			int64_t itemid;
+			int64_t params[5];
+		};
+		typedef smd::shm_map<int64_t, Item> Items;
+
+		const size_t items_per_player = 64;
+		const size_t player_count = std::max<size_t>(count / items_per_player, 1);
+		auto mem_usage = smd::g_alloc->GetUsed();
+		std::vector<smd::shm_pointer<Items>> players;
+		for (size_t i = 0; i < player_count; i++) {
+			players.push_back(smd::g_alloc->New<Items>());
+		}
+
+		std::default_random_engine generator(12345);
+		do {
+			BenchTimer timer;
+			for (size_t j = 0; j < items_per_player; j++) {
+				for (auto& items : players) {
+					Item item = { int64_t(generator()), {} };
+					items->insert(std::make_pair(item.itemid, item));
+				}
+			}
+			timer.Report("shm_map<int64_t, Item>::insert items round robin", player_count * items_per_player);
+		} while (false);
+
+		std::vector<size_t> order(player_count);
+		for (size_t i = 0; i < player_count; i++) {
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), generator);
+		do {
+			BenchTimer timer;
+			int64_t total = 0;
+			for (auto i : order) {
+				for (auto& kv : *players[i]) {
+					total += kv.second.params[0] + kv.first;
+				}
+			}
+			DoNotOptimize(total);
+			timer.Report("shm_map<int64_t, Item>::scan items of random players", player_count * items_per_player);
+		} while (false);
+
+		for (auto& items : players) {
+			smd::g_alloc->Delete(items);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+	}
+
+	template <class Container>
+	void Bench(const std::string& name) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<Container>();
+		do {
+			BenchTimer timer;
+			for (auto key : m_keys) {
+				obj->insert(std::make_pair(key, key));
+			}
+			timer.Report((name + "::insert").c_str(), m_keys.size());
+		} while (false);
+
+		SMD_LOG_INFO("%-56s %10zu keys %10.1f bytes/key", (name + "::memory").c_str(), m_keys.size(),
+			double(smd::g_alloc->GetUsed() - mem_usage) / double(m_keys.size()));
+
+		do {
+			BenchTimer timer;
+			int64_t total = 0;
+			for (auto key : m_lookups) {
+				total += obj->find(key)->second;
+			}
+			DoNotOptimize(total);
+			timer.Report((name + "::find").c_str(), m_lookups.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t total = 0;
+			for (auto it = obj->begin(); it != obj->end(); ++it) {
+				total += it->second;
+			}
+			DoNotOptimize(total);
+			timer.Report((name + "::scan").c_str(), obj->size());
+		} while (false);
+
+		// 从随机位置开始扫描100个元素
+		do {
+			const size_t queries = m_lookups.size() / 100;
+			BenchTimer timer;
+			int64_t total = 0;
+			for (size_t i = 0; i < queries; i++) {
+				auto it = obj->lower_bound(m_lookups[i]);
+				for (size_t j = 0; j < 100 && it != obj->end(); j++, ++it) {
+					total += it->second;
+				}
+			}
+			DoNotOptimize(total);
+			timer.Report((name + "::lower_bound + scan 100").c_str(), queries);
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			for (auto key : m_lookups) {
+				obj->erase(obj->find(key));
+			}
+			timer.Report((name + "::erase").c_str(), m_lookups.size());
+		} while (false);
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+	}
+
+private:
+	std::vector<uint64_t> m_keys;
+	std::vector<uint64_t> m_lookups;
+};
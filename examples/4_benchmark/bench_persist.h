@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <smd.h>
+#include <common/persist_pipeline.h>
+#include "bench_util.h"
+
+// 异步落地：提交到写完的吞吐，以及每条记录从提交到写完的延迟
+// 同样的数据分别用单条写、攒批写、多个序列化线程，写到本地文件，sync时每批fsync
+class BenchPersist {
+public:
+	BenchPersist(size_t count) {
+		Run(count, "batch 1, 1 serialize thread", 1, 1, false);
+		Run(count, "batch 256, 1 serialize thread", 256, 1, false);
+		Run(count, "batch 256, 4 serialize threads", 256, 4, false);
+		// fsync很慢，少写一些
+		Run(count / 100, "batch 1, fsync", 1, 2, true);
+		Run(count / 100, "batch 256, fsync", 256, 2, true);
+	}
+
+private:
+	// 写完之后记下每条记录的延迟
+	class LatencySink : public smd::PersistSink {
+	public:
+		LatencySink(const std::string& path, bool sync)
+			: m_file(path, sync) {}
+
+		bool Write(const std::vector<smd::PersistRecord>& batch) override {
+			if (!m_file.Write(batch))
+				return false;
+
+			auto now = std::chrono::steady_clock::now();
+			for (auto& r : batch) {
+				latency_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(now - r.submit_time).count());
+			}
+			return true;
+		}
+
+		std::vector<int64_t> latency_us;
+
+	private:
+		smd::PersistFileSink m_file;
+	};
+
+	// 模拟一个玩家的序列化，大约100字节
+	static void SerializePlayer(int64_t id, std::string* out) {
+		char buf[128];
+		int n = snprintf(buf, sizeof(buf), "%lld|I am player [%lld]|%d|2024-01-01 00:00:00|2024-01-01 01:00:00|",
+						 (long long)id, (long long)id, int(id % 100));
+		out->assign(buf, n);
+		for (int i = 0; i < 4; i++) {
+			out->append(std::to_string(id * 10 + i)).append(",");
+		}
+	}
+
+	void Run(size_t count, const char* name, size_t max_batch, int threads, bool sync) {
+		const std::string path = "bench_persist.dat";
+		remove(path.c_str());
+
+		smd::PersistOptions options;
+		options.max_batch = max_batch;
+		options.serialize_threads = threads;
+		options.max_pending = 4096;
+		options.batch_delay_ms = 2;
+
+		smd::PersistStats stats;
+		std::vector<int64_t> lat;
+		do {
+			LatencySink sink(path, sync);
+			smd::PersistPipeline pipeline(&sink, options);
+			BenchTimer timer;
+			for (size_t i = 0; i < count; i++) {
+				const int64_t id = int64_t(i % 10000);
+				pipeline.Submit(1, id, [id](std::string* out) { SerializePlayer(id, out); });
+			}
+			pipeline.Flush();
+			timer.Report((std::string("PersistPipeline ") + name).c_str(), count);
+			stats = pipeline.GetStats();
+			pipeline.Stop();
+			lat.swap(sink.latency_us);
+		} while (false);
+
+		std::sort(lat.begin(), lat.end());
+		auto percentile = [&lat](double p) {
+			return lat.empty() ? 0 : lat[std::min(lat.size() - 1, size_t(lat.size() * p))];
+		};
+		SMD_LOG_INFO("%-56s %10llu batches, latency p50 %lld us, p99 %lld us, max %lld us", name,
+					 (unsigned long long)stats.batches, (long long)percentile(0.5), (long long)percentile(0.99),
+					 (long long)(lat.empty() ? 0 : lat.back()));
+		remove(path.c_str());
+	}
+};
@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <vector>
+#include <algorithm>
+#include <smd.h>
+#include "bench_util.h"
+
+// 排行榜：用shm_map按分数排序，查询名次、第k名和分数区间内的人数
+class BenchRank {
+public:
+	BenchRank(size_t count) {
+		std::default_random_engine generator(12345);
+		for (size_t i = 0; i < count; i++) {
+			// 分数放在高位，玩家id放在低位，分数相同时也不会冲突
+			m_keys.push_back((uint64_t(generator() % 1000000) << 32) | i);
+		}
+
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_map<uint64_t, uint64_t>>();
+		do {
+			BenchTimer timer;
+			for (auto key : m_keys) {
+				obj->insert(std::make_pair(key, key & 0xffffffff));
+			}
+			timer.Report("shm_map<uint64_t, uint64_t>::insert", m_keys.size());
+		} while (false);
+
+		// 从头遍历计算名次，O(n)，只测少量查询
+		do {
+			const size_t queries = std::min<size_t>(m_keys.size(), 100);
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (size_t i = 0; i < queries; i++) {
+				size_t rank = 0;
+				for (auto it = obj->begin(); it != obj->end() && it->first < m_keys[i]; ++it) {
+					rank++;
+				}
+				sum += rank;
+			}
+			DoNotOptimize(sum);
+			timer.Report("shm_map<uint64_t, uint64_t>::rank by iteration", queries);
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (auto key : m_keys) {
+				sum += obj->rank(key);
+			}
+			DoNotOptimize(sum);
+			timer.Report("shm_map<uint64_t, uint64_t>::rank", m_keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (auto key : m_keys) {
+				sum += obj->index_of(obj->find(key));
+			}
+			DoNotOptimize(sum);
+			timer.Report("shm_map<uint64_t, uint64_t>::find + index_of", m_keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (size_t i = 0; i < m_keys.size(); i++) {
+				sum += obj->select(m_keys[i] % obj->size())->second;
+			}
+			DoNotOptimize(sum);
+			timer.Report("shm_map<uint64_t, uint64_t>::select", m_keys.size());
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (size_t i = 0; i + 1 < m_keys.size(); i += 2) {
+				sum += obj->count_range(std::min(m_keys[i], m_keys[i + 1]), std::max(m_keys[i], m_keys[i + 1]));
+			}
+			DoNotOptimize(sum);
+			timer.Report("shm_map<uint64_t, uint64_t>::count_range", m_keys.size() / 2);
+		} while (false);
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+	}
+
+private:
+	std::vector<uint64_t> m_keys;
+};
@@ -0,0 +1,138 @@
+﻿#pragma once
+#include <thread>
+#include <vector>
+#include <string>
+#include <smd.h>
+#include "bench_util.h"
+
+// 共享内存环形队列：单线程读写开销、跨线程吞吐和一来一回的交接延迟
+// 进程之间和线程之间走的是同一套原子变量和futex，用线程测更方便
+class BenchRing {
+public:
+	BenchRing(size_t count) {
+		BenchSpscLocal(count);
+		BenchSpscThroughput(count);
+		BenchMpmcThroughput(count);
+		BenchRecordThroughput(count);
+		BenchPingPong(count / 10);
+	}
+
+private:
+	struct Event {
+		uint64_t seq;
+		int64_t player_id;
+		int64_t op;
+	};
+
+	void BenchSpscLocal(size_t count) {
+		auto ring = smd::g_alloc->New<smd::shm_spsc_ring<Event>>(4096);
+		Event e{0, 0, 0};
+		int64_t sum = 0;
+		do {
+			BenchTimer timer;
+			for (size_t i = 0; i < count; i++) {
+				e.seq = i;
+				ring->try_push(e);
+				ring->try_pop(e);
+				sum += int64_t(e.seq);
+			}
+			timer.Report("shm_spsc_ring try_push + try_pop", count);
+		} while (false);
+
+		Event batch[64];
+		do {
+			BenchTimer timer;
+			for (size_t i = 0; i < count; i += 64) {
+				ring->push_batch(batch, 64);
+				ring->pop_batch(batch, 64);
+			}
+			timer.Report("shm_spsc_ring push_batch + pop_batch(64)", count);
+		} while (false);
+		DoNotOptimize(sum);
+		smd::g_alloc->Delete(ring);
+	}
+
+	template <class Ring>
+	void RunThroughput(Ring& ring, const char* name, size_t count, int producers) {
+		BenchTimer timer;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < producers; t++) {
+			threads.emplace_back([&ring, count, producers] {
+				for (size_t i = 0; i < count / producers; i++) {
+					ring.push(Event{i, 0, 0});
+				}
+			});
+		}
+		Event out[64];
+		size_t popped = 0;
+		int64_t sum = 0;
+		while (popped < count / producers * producers) {
+			size_t n = ring.pop_batch_wait(out, 64);
+			for (size_t i = 0; i < n; i++) {
+				sum += int64_t(out[i].seq);
+			}
+			popped += n;
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+		DoNotOptimize(sum);
+		timer.Report(name, popped);
+	}
+
+	void BenchSpscThroughput(size_t count) {
+		auto ring = smd::g_alloc->New<smd::shm_spsc_ring<Event>>(4096);
+		RunThroughput(*ring, "shm_spsc_ring 1 producer -> 1 consumer", count, 1);
+		smd::g_alloc->Delete(ring);
+	}
+
+	void BenchMpmcThroughput(size_t count) {
+		auto ring = smd::g_alloc->New<smd::shm_mpmc_ring<Event>>(4096);
+		RunThroughput(*ring, "shm_mpmc_ring 1 producer -> 1 consumer", count, 1);
+		RunThroughput(*ring, "shm_mpmc_ring 4 producers -> 1 consumer", count, 4);
+		smd::g_alloc->Delete(ring);
+	}
+
+	void BenchRecordThroughput(size_t count) {
+		auto ring = smd::g_alloc->New<smd::shm_record_ring>(256 * 1024);
+		const std::string record(40, 'r');
+		BenchTimer timer;
+		std::thread producer([&ring, &record, count] {
+			for (size_t i = 0; i < count; i++) {
+				ring->push(record);
+			}
+		});
+		size_t popped = 0;
+		int64_t bytes = 0;
+		while (popped < count) {
+			popped += ring->pop_batch_wait([&bytes](const smd::Slice& r) { bytes += int64_t(r.size()); }, 256);
+		}
+		producer.join();
+		DoNotOptimize(bytes);
+		timer.Report("shm_record_ring 40 byte records", count);
+	}
+
+	// 两个队列来回传一个消息，每次交接都要唤醒对方
+	void BenchPingPong(size_t count) {
+		auto ping = smd::g_alloc->New<smd::shm_spsc_ring<Event>>(64);
+		auto pong = smd::g_alloc->New<smd::shm_spsc_ring<Event>>(64);
+		BenchTimer timer;
+		std::thread echo([&ping, &pong, count] {
+			Event e;
+			for (size_t i = 0; i < count; i++) {
+				ping->pop(e);
+				pong->push(e);
+			}
+		});
+		Event e{0, 0, 0};
+		for (size_t i = 0; i < count; i++) {
+			e.seq = i;
+			ping->push(e);
+			pong->pop(e);
+		}
+		echo.join();
+		timer.Report("shm_spsc_ring ping-pong round trip", count);
+		smd::g_alloc->Delete(pong);
+		smd::g_alloc->Delete(ping);
+	}
+};
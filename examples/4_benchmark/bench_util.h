@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <chrono>
+#include <string>
+#include <smd.h>
+
+// 计时工具，测试结果统一输出到日志
+class BenchTimer {
+public:
+	BenchTimer()
+		: m_start(std::chrono::steady_clock::now()) {}
+
+	double ElapsedMs() const {
+		auto elapsed = std::chrono::steady_clock::now() - m_start;
+		return std::chrono::duration<double, std::milli>(elapsed).count();
+	}
+
+	void Report(const char* name, size_t ops) const {
+		const double ms = ElapsedMs();
+		SMD_LOG_INFO("%-56s %10zu ops %10.2f ms %10.1f ns/op", name, ops, ms, ops > 0 ? ms * 1e6 / ops : 0.0);
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// 防止被测代码被编译器优化掉
+inline volatile int64_t g_bench_sink = 0;
+
+inline void DoNotOptimize(int64_t value) {
+	g_bench_sink = value;
+}
@@ -0,0 +1,123 @@
+﻿#pragma once
+#include <vector>
+#include <smd.h>
+#include "bench_util.h"
+
+class BenchVector {
+public:
+	BenchVector(size_t count) {
+		BenchPushBackInt(count);
+		BenchPushBackPod(count);
+		BenchPushBackString(count / 10);
+		BenchAppendLog<smd::shm_list<smd::shm_string>>("shm_list<shm_string>", count / 10);
+		BenchAppendLog<smd::shm_deque<smd::shm_string>>("shm_deque<shm_string>", count / 10);
+		BenchQueue<smd::shm_list<int64_t>>("shm_list<int64_t>", count);
+		BenchQueue<smd::shm_deque<int64_t>>("shm_deque<int64_t>", count);
+	}
+
+private:
+	struct StMyData {
+		uint64_t role_id_;
+		int hp_;
+
+		StMyData(uint64_t role_id = 0, int hp = 0)
+			: role_id_(role_id)
+			, hp_(hp) {}
+	};
+
+	void BenchPushBackInt(size_t count) {
+		auto v = smd::g_alloc->New<smd::shm_vector<int>>();
+		do {
+			BenchTimer timer;
+			for (size_t i = 0; i < count; i++) {
+				v->push_back(int(i));
+			}
+			timer.Report("shm_vector<int>::push_back", count);
+		} while (false);
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (size_t i = 0; i < v->size(); i++) {
+				sum += (*v)[i];
+			}
+			DoNotOptimize(sum);
+			timer.Report("shm_vector<int>::operator[] scan", count);
+		} while (false);
+		smd::g_alloc->Delete(v);
+
+		std::vector<int> ref;
+		BenchTimer timer;
+		for (size_t i = 0; i < count; i++) {
+			ref.push_back(int(i));
+		}
+		timer.Report("std::vector<int>::push_back", count);
+	}
+
+	void BenchPushBackPod(size_t count) {
+		auto v = smd::g_alloc->New<smd::shm_vector<StMyData>>();
+		BenchTimer timer;
+		for (size_t i = 0; i < count; i++) {
+			v->push_back(StMyData(i, int(i)));
+		}
+		timer.Report("shm_vector<StMyData>::push_back", count);
+		smd::g_alloc->Delete(v);
+	}
+
+	// 类似2_log，只在尾部追加短日志，然后从头到尾读一遍
+	template <class Container>
+	void BenchAppendLog(const std::string& name, size_t count) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto logs = smd::g_alloc->New<Container>();
+		do {
+			BenchTimer timer;
+			for (size_t i = 0; i < count; i++) {
+				logs->push_back(smd::shm_string("app started"));
+			}
+			timer.Report((name + "::push_back").c_str(), count);
+		} while (false);
+		SMD_LOG_INFO("%-56s %10.1f bytes/entry", (name + " memory").c_str(),
+					 double(smd::g_alloc->GetUsed() - mem_usage) / double(count));
+
+		do {
+			BenchTimer timer;
+			int64_t sum = 0;
+			for (auto it = logs->begin(); it != logs->end(); ++it) {
+				sum += int64_t(it->size());
+			}
+			DoNotOptimize(sum);
+			timer.Report((name + " scan").c_str(), count);
+		} while (false);
+		smd::g_alloc->Delete(logs);
+	}
+
+	// 长度稳定的先进先出队列
+	template <class Container>
+	void BenchQueue(const std::string& name, size_t count) {
+		auto q = smd::g_alloc->New<Container>();
+		for (int64_t i = 0; i < 1000; i++) {
+			q->push_back(i);
+		}
+
+		BenchTimer timer;
+		int64_t sum = 0;
+		for (size_t i = 0; i < count; i++) {
+			q->push_back(int64_t(i));
+			sum += q->front();
+			q->pop_front();
+		}
+		DoNotOptimize(sum);
+		timer.Report((name + " push_back + pop_front").c_str(), count);
+		smd::g_alloc->Delete(q);
+	}
+
+	void BenchPushBackString(size_t count) {
+		auto v = smd::g_alloc->New<smd::shm_vector<smd::shm_string>>();
+		BenchTimer timer;
+		for (size_t i = 0; i < count; i++) {
+			v->push_back(smd::shm_string("TestText"));
+		}
+		timer.Report("shm_vector<shm_string>::push_back", count);
+		smd::g_alloc->Delete(v);
+	}
+};
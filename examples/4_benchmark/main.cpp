@@ -0,0 +1,83 @@
+﻿#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+#include <smd.h>
+
+#include "bench_vector.h"
+#include "bench_hash.h"
+#include "bench_kv.h"
+#include "bench_rank.h"
+#include "bench_map.h"
+#include "bench_ring.h"
+#include "bench_persist.h"
+
+// 用法: Benchmark [名称过滤] [数量] [共享内存level]
+int main(int argc, char* argv[]) {
+	smd::SetLogHandler(
+		[](smd::Log::LogLevel lv, const char* msg) {
+			std::string time_now = smd::util::Time::FormatDateTime(std::chrono::system_clock::now());
+			switch (lv) {
+			case smd::Log::LogLevel::kError:
+				printf("%s Error: %s\n", time_now.c_str(), msg);
+				break;
+			case smd::Log::LogLevel::kWarning:
+				printf("%s Warning: %s\n", time_now.c_str(), msg);
+				break;
+			case smd::Log::LogLevel::kInfo:
+				printf("%s Info: %s\n", time_now.c_str(), msg);
+				break;
+			case smd::Log::LogLevel::kDebug:
+				printf("%s Debug: %s\n", time_now.c_str(), msg);
+				break;
+			default:
+				break;
+			}
+		},
+		smd::Log::LogLevel::kInfo);
+
+	const std::string filter = argc >= 2 ? argv[1] : "";
+	const size_t count = argc >= 3 ? std::stoull(argv[2]) : 1000000;
+	// 压测数据量比较大，使用更大的共享内存，千万级别的数据需要再调大
+	const int level = argc >= 4 ? std::stoi(argv[3]) : 28;
+
+	auto env = (smd::SmdEnv*)smd::SmdEnv::Create(0x001187cb, level, false);
+	if (env == nullptr) {
+		SMD_LOG_ERROR("Create env failed");
+		return 0;
+	}
+
+	auto should_run = [&filter](const char* name) {
+		return filter.empty() || filter == name;
+	};
+
+	if (should_run("vector")) {
+		BenchVector bench_vector(count);
+	}
+
+	if (should_run("hash")) {
+		BenchHash bench_hash(count);
+	}
+
+	if (should_run("kv")) {
+		BenchKv bench_kv(count);
+	}
+
+	if (should_run("rank")) {
+		BenchRank bench_rank(count);
+	}
+
+	if (should_run("map")) {
+		BenchOrderedMap bench_map(count);
+	}
+
+	if (should_run("ring")) {
+		BenchRing bench_ring(count);
+	}
+
+	if (should_run("persist")) {
+		BenchPersist bench_persist(count);
+	}
+
+	SMD_LOG_INFO("completed");
+	return 0;
+}
@@ -1,15 +1,50 @@
 ﻿#pragma once
+#include <type_traits>
 
 namespace smd {
 
+// 数值类型不能直接相减，差值超出int64_t的范围时符号会出错
 template <class T>
 int64_t compare(const T& x, const T& y) {
-	return x - y;
+	if constexpr (std::is_arithmetic_v<T>) {
+		return (x < y) ? -1 : ((y < x) ? 1 : 0);
+	} else {
+		return x - y;
+	}
 }
 
-template <>
-int64_t compare(const uint64_t& x, const uint64_t& y) {
-	return x - y;
-}
+// 有序容器可以在节点中缓存key的前缀，前缀不同的时候不用访问key的内容就能比较出大小
+// 特化的时候提供get，前缀的大小关系必须和compare一致，前缀相同时再用compare比较完整的key
+template <class Key>
+struct key_prefix {
+	static constexpr bool enabled = false;
+};
+
+// 哈希表等容器用来从元素中取出key
+template <class T>
+struct identity {
+	const T& operator()(const T& v) const {
+		return v;
+	}
+};
+
+template <class Pair>
+struct select1st {
+	const typename Pair::first_type& operator()(const Pair& v) const {
+		return v.first;
+	}
+};
+
+// Hash和KeyEqual都声明了is_transparent的时候，哈希表允许用其它类型的key直接查找
+// 比如用Slice查找shm_string，不需要先构造出一个key
+template <class T, class = void>
+struct is_transparent : std::false_type {};
+
+template <class T>
+struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+template <class Hash, class KeyEqual, class K>
+using enable_if_transparent_t =
+	typename std::enable_if<is_transparent<Hash>::value && is_transparent<KeyEqual>::value, K>::type;
 
 } // namespace smd
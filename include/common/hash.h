@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <stdint.h>
+#include <string.h>
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+#endif
+
+namespace smd {
+namespace util {
+
+// 字节串的哈希函数，算法是wyhash(final4)，直接处理原始字节，不需要任何分配
+// 共享内存中的哈希表会被多个进程使用，所以结果只和输入的字节有关，不能带随机种子
+// 长度超过48字节的时候用三路独立的乘法并行处理，充分利用流水线
+class Hash {
+public:
+	static uint64_t Bytes(const void* key, size_t len, uint64_t seed = 0) {
+		const uint8_t* p = (const uint8_t*)key;
+		seed ^= Mix(seed ^ kSecret[0], kSecret[1]);
+
+		uint64_t a = 0;
+		uint64_t b = 0;
+		if (len <= 16) {
+			if (len >= 4) {
+				a = (Read4(p) << 32) | Read4(p + ((len >> 3) << 2));
+				b = (Read4(p + len - 4) << 32) | Read4(p + len - 4 - ((len >> 3) << 2));
+			} else if (len > 0) {
+				a = Read3(p, len);
+			}
+		} else {
+			size_t i = len;
+			if (i >= 48) {
+				uint64_t see1 = seed;
+				uint64_t see2 = seed;
+				do {
+					seed = Mix(Read8(p) ^ kSecret[1], Read8(p + 8) ^ seed);
+					see1 = Mix(Read8(p + 16) ^ kSecret[2], Read8(p + 24) ^ see1);
+					see2 = Mix(Read8(p + 32) ^ kSecret[3], Read8(p + 40) ^ see2);
+					p += 48;
+					i -= 48;
+				} while (i >= 48);
+				seed ^= see1 ^ see2;
+			}
+
+			while (i > 16) {
+				seed = Mix(Read8(p) ^ kSecret[1], Read8(p + 8) ^ seed);
+				i -= 16;
+				p += 16;
+			}
+
+			a = Read8(p + i - 16);
+			b = Read8(p + i - 8);
+		}
+
+		a ^= kSecret[1];
+		b ^= seed;
+		Mum(&a, &b);
+		return Mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+	}
+
+private:
+	// 64位乘法，结果的低64位放到a，高64位放到b
+	static void Mum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+		__uint128_t r = *a;
+		r *= *b;
+		*a = (uint64_t)r;
+		*b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		*a = _umul128(*a, *b, b);
+#else
+		uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		uint64_t t = rl + (rm0 << 32), c = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		c += lo < t;
+		uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+		*a = lo;
+		*b = hi;
+#endif
+	}
+
+	static uint64_t Mix(uint64_t a, uint64_t b) {
+		Mum(&a, &b);
+		return a ^ b;
+	}
+
+	// 按小端序读取
+	static uint64_t Read8(const uint8_t* p) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		return v;
+	}
+
+	static uint64_t Read4(const uint8_t* p) {
+		uint32_t v;
+		memcpy(&v, p, 4);
+		return v;
+	}
+
+	static uint64_t Read3(const uint8_t* p, size_t k) {
+		return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+	}
+
+private:
+	static constexpr uint64_t kSecret[4] = {
+		0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+};
+
+} // namespace util
+} // namespace smd
@@ -0,0 +1,434 @@
+﻿#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <common/log.h>
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+namespace smd {
+
+// 一条要落地的数据，删除时data为空
+struct PersistRecord {
+	uint32_t table = 0;
+	int64_t key = 0;
+	bool erased = false;
+	std::string data;
+	// 提交的时间，用来统计从提交到写完的延迟
+	std::chrono::steady_clock::time_point submit_time;
+};
+
+// 落地的目标，比如文件、数据库
+// Write只在写线程中调用，一次写一批，返回false时整批重试
+class PersistSink {
+public:
+	virtual ~PersistSink() {}
+	virtual bool Write(const std::vector<PersistRecord>& batch) = 0;
+};
+
+struct PersistOptions {
+	// 序列化线程数
+	int serialize_threads = 2;
+	// 已提交但还没写完的记录数上限，超过时Submit阻塞
+	size_t max_pending = 4096;
+	// 一批最多写多少条
+	size_t max_batch = 256;
+	// 凑不满一批时最多再等多久，为0时有数据就写
+	int batch_delay_ms = 5;
+	// 写失败之后的重试次数和间隔，重试完还失败就丢弃这一批
+	int max_retries = 3;
+	int retry_interval_ms = 10;
+};
+
+struct PersistStats {
+	uint64_t submitted = 0;
+	uint64_t written = 0;
+	uint64_t failed = 0;
+	uint64_t batches = 0;
+};
+
+// 异步落地：生产者提交变化过的对象，序列化线程池把对象转成数据，写线程把数据攒成批写入sink
+// 写入顺序和提交顺序一致，同一个key先后提交的两次不会被后写覆盖掉新的
+// 积压的记录达到max_pending时Submit阻塞，生产者的速度被限制在sink能写的速度
+class PersistPipeline {
+public:
+	// 在序列化线程中调用，把对象写到out中
+	using Serializer = std::function<void(std::string* out)>;
+
+	explicit PersistPipeline(PersistSink* sink, const PersistOptions& options = PersistOptions())
+		: m_sink(sink)
+		, m_options(options) {
+		assert(m_sink != nullptr && m_options.serialize_threads > 0 && m_options.max_pending > 0 &&
+			   m_options.max_batch > 0);
+		for (int i = 0; i < m_options.serialize_threads; i++) {
+			m_workers.emplace_back([this] { SerializeLoop(); });
+		}
+		m_writer = std::thread([this] { WriteLoop(); });
+	}
+
+	PersistPipeline(const PersistPipeline&) = delete;
+	PersistPipeline& operator=(const PersistPipeline&) = delete;
+
+	~PersistPipeline() {
+		Stop();
+	}
+
+	// timeout_ms为0时不等待，大于0时最多等这么久，小于0时一直等到有空位；停止之后返回false
+	bool Submit(uint32_t table, int64_t key, Serializer serializer, int timeout_ms = -1) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!WaitRoom(lock, timeout_ms))
+			return false;
+
+		m_jobs.emplace_back();
+		auto& job = m_jobs.back();
+		job.record.table = table;
+		job.record.key = key;
+		job.record.submit_time = std::chrono::steady_clock::now();
+		job.serializer = std::move(serializer);
+		++m_stats.submitted;
+		m_serialize_cv.notify_one();
+		return true;
+	}
+
+	bool SubmitErase(uint32_t table, int64_t key, int timeout_ms = -1) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!WaitRoom(lock, timeout_ms))
+			return false;
+
+		m_jobs.emplace_back();
+		auto& job = m_jobs.back();
+		job.record.table = table;
+		job.record.key = key;
+		job.record.erased = true;
+		job.record.submit_time = std::chrono::steady_clock::now();
+		++m_stats.submitted;
+		m_serialize_cv.notify_one();
+		return true;
+	}
+
+	// 等待已经提交的记录全部写完，不凑批；超时返回false
+	bool Flush(int timeout_ms = -1) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		++m_flushing;
+		m_write_cv.notify_one();
+		auto done = [this] { return Pending() == 0; };
+		bool ok = true;
+		if (timeout_ms < 0) {
+			m_room_cv.wait(lock, done);
+		} else {
+			ok = m_room_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), done);
+		}
+		--m_flushing;
+		return ok;
+	}
+
+	// 不再接受提交，写完剩下的记录之后退出所有线程
+	void Stop() {
+		do {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stop)
+				return;
+			m_stop = true;
+		} while (false);
+
+		m_serialize_cv.notify_all();
+		m_write_cv.notify_all();
+		m_room_cv.notify_all();
+		for (auto& t : m_workers) {
+			t.join();
+		}
+		m_writer.join();
+	}
+
+	size_t pending() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return Pending();
+	}
+
+	PersistStats GetStats() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+private:
+	struct Job {
+		PersistRecord record;
+		Serializer serializer;
+		bool done = false;
+	};
+
+	size_t Pending() const {
+		return m_jobs.size() + m_writing;
+	}
+
+	bool WaitRoom(std::unique_lock<std::mutex>& lock, int timeout_ms) {
+		auto has_room = [this] { return m_stop || Pending() < m_options.max_pending; };
+		if (timeout_ms < 0) {
+			m_room_cv.wait(lock, has_room);
+		} else if (!m_room_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), has_room)) {
+			return false;
+		}
+		return !m_stop;
+	}
+
+	// m_jobs按提交顺序排列：[0, m_ready)已经序列化完，可以写；[m_ready, m_next)正在序列化；之后的还没开始
+	// 序列化完成的顺序是乱的，写线程只取前面连续完成的部分，保证按提交顺序写入
+	// deque在两端增删时不会让其它元素的引用失效，序列化线程可以不加锁访问自己的Job
+	void SerializeLoop() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_serialize_cv.wait(lock, [this] { return m_stop || m_next < m_jobs.size(); });
+			if (m_next >= m_jobs.size())
+				break;
+
+			auto& job = m_jobs[m_next++];
+			lock.unlock();
+			if (job.serializer) {
+				job.serializer(&job.record.data);
+				job.serializer = nullptr;
+			}
+			lock.lock();
+
+			job.done = true;
+			const size_t ready = m_ready;
+			while (m_ready < m_next && m_jobs[m_ready].done) {
+				++m_ready;
+			}
+			if (m_ready != ready) {
+				m_write_cv.notify_one();
+			}
+		}
+	}
+
+	void WriteLoop() {
+		std::vector<PersistRecord> batch;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_write_cv.wait(lock, [this] { return m_ready > 0 || (m_stop && m_jobs.empty()); });
+			if (m_ready == 0)
+				break;
+
+			// 凑批，停止、Flush或者生产者已经被阻塞的时候马上写
+			if (m_ready < m_options.max_batch && m_options.batch_delay_ms > 0) {
+				m_write_cv.wait_for(lock, std::chrono::milliseconds(m_options.batch_delay_ms), [this] {
+					return m_ready >= m_options.max_batch || m_stop || m_flushing > 0 ||
+						   Pending() >= m_options.max_pending;
+				});
+			}
+
+			const size_t n = std::min(m_ready, m_options.max_batch);
+			batch.clear();
+			for (size_t i = 0; i < n; i++) {
+				batch.push_back(std::move(m_jobs.front().record));
+				m_jobs.pop_front();
+			}
+			m_ready -= n;
+			m_next -= n;
+			m_writing = n;
+			lock.unlock();
+
+			const bool ok = WriteBatch(batch);
+
+			lock.lock();
+			m_writing = 0;
+			++m_stats.batches;
+			if (ok) {
+				m_stats.written += n;
+			} else {
+				m_stats.failed += n;
+			}
+			m_room_cv.notify_all();
+		}
+	}
+
+	bool WriteBatch(const std::vector<PersistRecord>& batch) {
+		for (int i = 0;; i++) {
+			if (m_sink->Write(batch))
+				return true;
+
+			if (i >= m_options.max_retries) {
+				SMD_LOG_ERROR("Persist batch dropped, %zu records, %d retries", batch.size(), i);
+				return false;
+			}
+			SMD_LOG_WARN("Persist batch failed, %zu records, retry %d", batch.size(), i + 1);
+			std::this_thread::sleep_for(std::chrono::milliseconds(m_options.retry_interval_ms));
+		}
+	}
+
+private:
+	PersistSink* m_sink;
+	const PersistOptions m_options;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_serialize_cv;
+	std::condition_variable m_write_cv;
+	// 有空位或者写完一批时通知Submit和Flush
+	std::condition_variable m_room_cv;
+
+	std::deque<Job> m_jobs;
+	size_t m_next = 0;
+	size_t m_ready = 0;
+	// 已经从m_jobs中取出、正在写的条数
+	size_t m_writing = 0;
+	int m_flushing = 0;
+	bool m_stop = false;
+	PersistStats m_stats;
+
+	std::vector<std::thread> m_workers;
+	std::thread m_writer;
+};
+
+// 追加写入的文件，每条记录：table(4) key(8) erased(1) 长度(4) 数据
+// 一批只调用一次fwrite，sync为true时每批写完再fsync
+// 写失败时把文件截回这一批之前的长度，重试的时候不会接在写了一半的数据后面
+class PersistFileSink : public PersistSink {
+public:
+	explicit PersistFileSink(const std::string& path, bool sync = false)
+		: m_sync(sync) {
+		m_file = fopen(path.c_str(), "ab");
+		if (m_file == nullptr) {
+			SMD_LOG_ERROR("Open persist file failed, %s", path.c_str());
+			return;
+		}
+		// 每批已经拼成一整块，不需要FILE的缓冲区，写失败时缓冲区中也不会残留数据
+		setvbuf(m_file, nullptr, _IONBF, 0);
+	}
+
+	PersistFileSink(const PersistFileSink&) = delete;
+	PersistFileSink& operator=(const PersistFileSink&) = delete;
+
+	~PersistFileSink() {
+		if (m_file != nullptr) {
+			fclose(m_file);
+		}
+	}
+
+	bool IsOpen() const {
+		return m_file != nullptr;
+	}
+
+	bool Write(const std::vector<PersistRecord>& batch) override {
+		if (m_file == nullptr || m_broken)
+			return false;
+
+		m_buffer.clear();
+		for (auto& r : batch) {
+			const uint32_t len = uint32_t(r.data.size());
+			const uint8_t erased = r.erased ? 1 : 0;
+			m_buffer.append((const char*)&r.table, sizeof(r.table));
+			m_buffer.append((const char*)&r.key, sizeof(r.key));
+			m_buffer.append((const char*)&erased, sizeof(erased));
+			m_buffer.append((const char*)&len, sizeof(len));
+			m_buffer.append(r.data);
+		}
+
+		if (Seek(0, SEEK_END) != 0)
+			return false;
+		const int64_t offset = Tell();
+		if (offset < 0)
+			return false;
+
+		if (WriteData(m_buffer.data(), m_buffer.size()) == m_buffer.size() && fflush(m_file) == 0 && Sync())
+			return true;
+
+		Rollback(offset);
+		return false;
+	}
+
+	// 按写入顺序回放文件中的记录，f(const PersistRecord&)，末尾不完整的记录忽略，返回回放的条数
+	template <class F>
+	static size_t Load(const std::string& path, F&& f) {
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == nullptr)
+			return 0;
+
+		size_t count = 0;
+		PersistRecord r;
+		char header[17];
+		while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+			uint32_t len;
+			memcpy(&r.table, header, 4);
+			memcpy(&r.key, header + 4, 8);
+			r.erased = header[12] != 0;
+			memcpy(&len, header + 13, 4);
+			r.data.resize(len);
+			if (len > 0 && fread(&r.data[0], 1, len, file) != len)
+				break;
+
+			f((const PersistRecord&)r);
+			++count;
+		}
+		fclose(file);
+		return count;
+	}
+
+protected:
+	// 返回写入的字节数，小于size时表示失败
+	virtual size_t WriteData(const char* data, size_t size) {
+		return fwrite(data, 1, size, m_file);
+	}
+
+private:
+	bool Sync() {
+		if (!m_sync)
+			return true;
+#ifdef _WIN32
+		return _commit(_fileno(m_file)) == 0;
+#else
+		return fsync(fileno(m_file)) == 0;
+#endif
+	}
+
+	int Seek(int64_t offset, int origin) {
+#ifdef _WIN32
+		return _fseeki64(m_file, offset, origin);
+#else
+		return fseeko(m_file, off_t(offset), origin);
+#endif
+	}
+
+	int64_t Tell() {
+#ifdef _WIN32
+		return _ftelli64(m_file);
+#else
+		return int64_t(ftello(m_file));
+#endif
+	}
+
+	// 截掉offset之后写了一半的数据
+	void Rollback(int64_t offset) {
+		clearerr(m_file);
+		Seek(offset, SEEK_SET);
+#ifdef _WIN32
+		const bool ok = _chsize_s(_fileno(m_file), offset) == 0;
+#else
+		const bool ok = ftruncate(fileno(m_file), off_t(offset)) == 0;
+#endif
+		// 截不回去的话再写就接在残缺的记录后面了，之后的写入全部失败
+		if (!ok) {
+			m_broken = true;
+			SMD_LOG_ERROR("Truncate persist file failed, offset %lld", (long long)offset);
+		}
+	}
+
+private:
+	FILE* m_file;
+	bool m_sync;
+	bool m_broken = false;
+	std::string m_buffer;
+};
+
+} // namespace smd
@@ -4,6 +4,9 @@
 #include <cstddef>
 #include <cstring>
 #include <string>
+#include <string_view>
+#include <functional>
+#include <common/hash.h>
 
 namespace smd {
 
@@ -24,6 +27,11 @@ public:
 		: data_(s.data())
 		, size_(s.size()) {}
 
+	// Create a slice that refers to the contents of "sv"
+	Slice(std::string_view sv)
+		: data_(sv.data())
+		, size_(sv.size()) {}
+
 	// Create a slice that refers to s[0,strlen(s)-1]
 	Slice(const char* s)
 		: data_(s)
@@ -100,3 +108,16 @@ inline int Slice::compare(const Slice& b) const {
 }
 
 } // namespace smd
+
+namespace std {
+template <>
+struct hash<smd::Slice> {
+	typedef smd::Slice argument_type;
+	typedef std::size_t result_type;
+
+	result_type operator()(argument_type const& s) const {
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+};
+
+} // namespace std
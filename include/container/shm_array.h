@@ -0,0 +1,115 @@
+﻿#pragma once
+#include <assert.h>
+#include <utility>
+
+namespace smd {
+
+// 定长数组，元素直接存放在对象内部，不需要额外分配共享内存
+// 适合作为成员嵌套在其它结构中，比如身上的装备栏
+template <class T, size_t N>
+class shm_array {
+public:
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	typedef T& reference;
+	typedef const T& const_reference;
+
+	shm_array()
+		: m_elems() {}
+
+	shm_array(const shm_array& r) = default;
+	shm_array& operator=(const shm_array& r) = default;
+
+	constexpr size_t size() const {
+		return N;
+	}
+
+	constexpr size_t max_size() const {
+		return N;
+	}
+
+	constexpr bool empty() const {
+		return N == 0;
+	}
+
+	//访问元素相关
+	reference operator[](size_t i) {
+		assert(i < N);
+		return m_elems[i];
+	}
+
+	const_reference operator[](size_t i) const {
+		assert(i < N);
+		return m_elems[i];
+	}
+
+	reference front() {
+		return m_elems[0];
+	}
+
+	const_reference front() const {
+		return m_elems[0];
+	}
+
+	reference back() {
+		return m_elems[N - 1];
+	}
+
+	const_reference back() const {
+		return m_elems[N - 1];
+	}
+
+	value_type* data() {
+		return m_elems;
+	}
+
+	const value_type* data() const {
+		return m_elems;
+	}
+
+	iterator begin() {
+		return m_elems;
+	}
+
+	const_iterator begin() const {
+		return m_elems;
+	}
+
+	iterator end() {
+		return m_elems + N;
+	}
+
+	const_iterator end() const {
+		return m_elems + N;
+	}
+
+	void fill(const value_type& value) {
+		for (size_t i = 0; i < N; i++) {
+			m_elems[i] = value;
+		}
+	}
+
+	void swap(shm_array& r) {
+		for (size_t i = 0; i < N; i++) {
+			std::swap(m_elems[i], r.m_elems[i]);
+		}
+	}
+
+	bool operator==(const shm_array& r) const {
+		for (size_t i = 0; i < N; i++) {
+			if (!(m_elems[i] == r.m_elems[i]))
+				return false;
+		}
+		return true;
+	}
+
+	bool operator!=(const shm_array& r) const {
+		return !(*this == r);
+	}
+
+private:
+	value_type m_elems[N > 0 ? N : 1];
+};
+
+} // namespace smd
@@ -0,0 +1,883 @@
+﻿#pragma once
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+#include <string.h>
+#include <assert.h>
+#include <common/functional.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+struct BTreeNodeBase {
+	// 叶子节点是元素个数，内部节点是key的个数
+	uint16_t count;
+	bool leaf;
+};
+
+// 叶子节点，元素连续存放，相邻的叶子节点串成双向链表，范围扫描不用回到上层
+template <typename Value, size_t N>
+struct BTreeLeaf : BTreeNodeBase {
+	shm_pointer<BTreeLeaf> prev;
+	shm_pointer<BTreeLeaf> next;
+	alignas(Value) char slots[sizeof(Value) * N];
+
+	Value* values() const {
+		return (Value*)slots;
+	}
+};
+
+// 内部节点，key连续存放，children[i]中的key都小于keys[i]，children[i + 1]中的key都不小于keys[i]
+template <typename Key, size_t N>
+struct BTreeInternal : BTreeNodeBase {
+	shm_pointer<BTreeNodeBase> children[N + 1];
+	alignas(Key) char slots[sizeof(Key) * N];
+
+	Key* keys() const {
+		return (Key*)slots;
+	}
+};
+
+template <typename Leaf, typename Pointer, typename Reference, bool Reverse = false>
+struct btree_iterator {
+	typedef btree_iterator<Leaf, Pointer, Reference, Reverse> this_type;
+
+	shm_pointer<Leaf> _leaf;
+	size_t _index;
+
+	btree_iterator()
+		: _leaf(shm_nullptr)
+		, _index(0) {}
+	btree_iterator(shm_pointer<Leaf> leaf, size_t index)
+		: _leaf(leaf)
+		, _index(index) {}
+	btree_iterator(const std::pair<shm_pointer<Leaf>, size_t>& pos)
+		: _leaf(pos.first)
+		, _index(pos.second) {}
+	btree_iterator(const this_type& x) = default;
+
+	Reference operator*() const {
+		return _leaf->values()[_index];
+	}
+
+	Pointer operator->() const {
+		return &_leaf->values()[_index];
+	}
+
+	btree_iterator& operator++() {
+		Reverse ? backward() : forward();
+		return *this;
+	}
+
+	btree_iterator operator++(int) {
+		this_type tmp(*this);
+		++*this;
+		return tmp;
+	}
+
+	btree_iterator& operator--() {
+		Reverse ? forward() : backward();
+		return *this;
+	}
+
+	btree_iterator operator--(int) {
+		this_type tmp(*this);
+		--*this;
+		return tmp;
+	}
+
+	bool operator==(const this_type& x) const {
+		return _leaf == x._leaf && _index == x._index;
+	}
+
+	bool operator!=(const this_type& x) const {
+		return !(*this == x);
+	}
+
+private:
+	void forward() {
+		if (++_index >= _leaf->count) {
+			_leaf = _leaf->next;
+			_index = 0;
+		}
+	}
+
+	void backward() {
+		if (_index > 0) {
+			--_index;
+			return;
+		}
+
+		_leaf = _leaf->prev;
+		_index = _leaf != shm_nullptr ? _leaf->count - 1 : 0;
+	}
+};
+
+// B+树实现的有序map，接口和shm_map相同
+// 一个节点大约NodeBytes字节，一次查找只访问log_B(n)个节点，比红黑树少很多次缓存缺失，节点数也少得多
+// 和shm_map不同，插入删除会在节点内挪动元素，所有迭代器和引用都会失效
+template <typename Key, typename Value, size_t NodeBytes = 256>
+class shm_btree_map {
+public:
+	typedef shm_btree_map<Key, Value, NodeBytes> this_type;
+	typedef std::pair<Key, Value> value_type;
+
+private:
+	// 每个节点多留一个位置，先插入再分裂，逻辑简单很多
+	static constexpr size_t kLeafSlots = std::max<size_t>(3, (NodeBytes - 24) / sizeof(value_type));
+	static constexpr size_t kInternalSlots = std::max<size_t>(3, (NodeBytes - 16) / (sizeof(Key) + 8));
+	static constexpr size_t kMaxLeaf = kLeafSlots - 1;
+	static constexpr size_t kMinLeaf = kMaxLeaf / 2;
+	static constexpr size_t kMaxInternal = kInternalSlots - 1;
+	static constexpr size_t kMinInternal = kMaxInternal / 2;
+	// 每个内部节点至少两个孩子，这个深度足够放下任意多的元素
+	static constexpr size_t kMaxDepth = 64;
+
+	typedef BTreeLeaf<value_type, kLeafSlots> leaf_type;
+	typedef BTreeInternal<Key, kInternalSlots> internal_type;
+	typedef shm_pointer<BTreeNodeBase> node_ptr;
+	typedef shm_pointer<leaf_type> leaf_ptr;
+	typedef shm_pointer<internal_type> internal_ptr;
+
+	// 从根节点到叶子节点经过的内部节点，以及在每个节点中走的是第几个孩子
+	struct Path {
+		internal_ptr nodes[kMaxDepth];
+		size_t index[kMaxDepth];
+		size_t depth = 0;
+	};
+
+public:
+	typedef btree_iterator<leaf_type, value_type*, value_type&> iterator;
+	typedef btree_iterator<leaf_type, const value_type*, const value_type&> const_iterator;
+	typedef btree_iterator<leaf_type, value_type*, value_type&, true> reverse_iterator;
+	typedef btree_iterator<leaf_type, const value_type*, const value_type&, true> const_reverse_iterator;
+
+	shm_btree_map() {}
+
+	shm_btree_map(const this_type& r) {
+		for (auto it = r.begin(); it != r.end(); ++it) {
+			insert(*it);
+		}
+	}
+
+	// 移动时只交换根节点和首尾叶子的偏移，对方变成空树
+	shm_btree_map(this_type&& r) noexcept {
+		swap(r);
+	}
+
+	this_type& operator=(const this_type& r) {
+		if (this != &r) {
+			this_type(r).swap(*this);
+		}
+		return *this;
+	}
+
+	this_type& operator=(this_type&& r) noexcept {
+		if (this != &r) {
+			this_type(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
+	void swap(this_type& r) {
+		std::swap(m_root, r.m_root);
+		std::swap(m_first, r.m_first);
+		std::swap(m_last, r.m_last);
+		std::swap(m_size, r.m_size);
+	}
+
+	~shm_btree_map() {
+		clear();
+	}
+
+	iterator begin() {
+		return iterator(m_first, 0);
+	}
+
+	const_iterator begin() const {
+		return const_iterator(m_first, 0);
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+	const_iterator end() const {
+		return const_iterator();
+	}
+
+	reverse_iterator rbegin() {
+		return m_last == shm_nullptr ? reverse_iterator() : reverse_iterator(m_last, m_last->count - 1);
+	}
+
+	const_reverse_iterator rbegin() const {
+		return m_last == shm_nullptr ? const_reverse_iterator() : const_reverse_iterator(m_last, m_last->count - 1);
+	}
+
+	reverse_iterator rend() {
+		return reverse_iterator();
+	}
+
+	const_reverse_iterator rend() const {
+		return const_reverse_iterator();
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	// 先查找，key不存在的时候才构造元素
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return emplace_unique(value.first, value);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return emplace_unique(value.first, std::move(value));
+	}
+
+	// key不存在的时候才用参数在叶子节点中直接构造value
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& key, P&&... params) {
+		return emplace_unique(key, std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<P>(params)...));
+	}
+
+	template <class V>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+		auto res = try_emplace(key, std::forward<V>(value));
+		if (!res.second) {
+			res.first->second = std::forward<V>(value);
+		}
+		return res;
+	}
+
+	// 参数中不能直接取出key，先构造一个临时的元素，能用try_emplace的尽量用try_emplace
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		value_type value(std::forward<P>(params)...);
+		return emplace_unique(value.first, std::move(value));
+	}
+
+	Value& operator[](const Key& key) {
+		return try_emplace(key).first->second;
+	}
+
+	Value& at(const Key& key) {
+		auto it = find(key);
+		assert(it != end());
+		return it->second;
+	}
+
+	const Value& at(const Key& key) const {
+		auto it = find(key);
+		assert(it != end());
+		return it->second;
+	}
+
+	iterator find(const Key& key) {
+		return iterator(find_impl(key));
+	}
+
+	const_iterator find(const Key& key) const {
+		return const_iterator(find_impl(key));
+	}
+
+	// 只要能和Key比较大小就可以直接查找，比如用Slice查找shm_string，不用构造key
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	iterator find(const K& key) {
+		return iterator(find_impl(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	const_iterator find(const K& key) const {
+		return const_iterator(find_impl(key));
+	}
+
+	// 第一个不小于key的元素
+	iterator lower_bound(const Key& key) {
+		return iterator(lower_bound_impl(key));
+	}
+
+	const_iterator lower_bound(const Key& key) const {
+		return const_iterator(lower_bound_impl(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	iterator lower_bound(const K& key) {
+		return iterator(lower_bound_impl(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	const_iterator lower_bound(const K& key) const {
+		return const_iterator(lower_bound_impl(key));
+	}
+
+	// 第一个大于key的元素
+	iterator upper_bound(const Key& key) {
+		return iterator(upper_bound_impl(key));
+	}
+
+	const_iterator upper_bound(const Key& key) const {
+		return const_iterator(upper_bound_impl(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	iterator upper_bound(const K& key) {
+		return iterator(upper_bound_impl(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	const_iterator upper_bound(const K& key) const {
+		return const_iterator(upper_bound_impl(key));
+	}
+
+	// key唯一，范围内最多只有一个元素
+	std::pair<iterator, iterator> equal_range(const Key& key) {
+		return equal_range_impl<iterator>(key);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+		return equal_range_impl<const_iterator>(key);
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	std::pair<iterator, iterator> equal_range(const K& key) {
+		return equal_range_impl<iterator>(key);
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+		return equal_range_impl<const_iterator>(key);
+	}
+
+	// 返回被删除元素的下一个元素
+	iterator erase(iterator it) {
+		assert(it != end());
+		Path path;
+		auto leaf = descend(it->first, &path);
+		assert(leaf == it._leaf);
+
+		size_t i = it._index;
+		auto values = leaf->values();
+		values[i].~value_type();
+		shift_left(values + i, leaf->count - i - 1);
+		leaf->count--;
+		m_size--;
+
+		if (path.depth == 0) {
+			// 只剩根节点这一个叶子
+			if (leaf->count == 0) {
+				free_node(node_ptr(leaf.Raw()));
+				m_root = shm_nullptr;
+				m_first = m_last = shm_nullptr;
+				return end();
+			}
+		} else if (leaf->count < kMinLeaf) {
+			rebalance_leaf(path, leaf, i);
+		}
+
+		if (i >= leaf->count) {
+			return iterator(leaf->next, 0);
+		}
+		return iterator(leaf, i);
+	}
+
+	iterator erase(iterator first, iterator last) {
+		// 删除会挪动元素，last会失效，所以先数出要删除的个数
+		size_t n = 0;
+		for (auto it = first; it != last; ++it) {
+			n++;
+		}
+
+		while (n-- > 0) {
+			first = erase(first);
+		}
+		return first;
+	}
+
+	size_t erase(const Key& key) {
+		auto it = find(key);
+		if (it == end())
+			return 0;
+
+		erase(it);
+		return 1;
+	}
+
+	void clear() {
+		if (m_root != shm_nullptr) {
+			free_node(m_root);
+		}
+
+		m_root = shm_nullptr;
+		m_first = m_last = shm_nullptr;
+		m_size = 0;
+	}
+
+private:
+	template <class K>
+	static int64_t compare(const K& x, const Key& y) {
+		return smd::compare(x, y);
+	}
+
+	template <typename... P>
+	std::pair<iterator, bool> emplace_unique(const Key& key, P&&... params) {
+		if (m_root == shm_nullptr) {
+			auto leaf = create_leaf();
+			m_root = node_ptr(leaf.Raw());
+			m_first = m_last = leaf;
+		}
+
+		Path path;
+		auto leaf = descend(key, &path);
+		auto values = leaf->values();
+		size_t i = lower_index(values, leaf->count, key);
+		if (i < leaf->count && compare(key, values[i].first) == 0) {
+			return std::make_pair(iterator(leaf, i), false);
+		}
+
+		shift_right(values + i, leaf->count - i);
+		::new (values + i) value_type(std::forward<P>(params)...);
+		leaf->count++;
+		m_size++;
+
+		if (leaf->count <= kMaxLeaf) {
+			return std::make_pair(iterator(leaf, i), true);
+		}
+
+		// 叶子节点满了，分裂成两个，右边的第一个key复制到父节点
+		auto right = split_leaf(leaf);
+		insert_into_parent(path, path.depth, node_ptr(leaf.Raw()), right->values()[0].first, node_ptr(right.Raw()));
+		if (i < leaf->count) {
+			return std::make_pair(iterator(leaf, i), true);
+		}
+		return std::make_pair(iterator(right, i - leaf->count), true);
+	}
+
+	static leaf_ptr as_leaf(node_ptr p) {
+		return leaf_ptr(p.Raw());
+	}
+
+	static internal_ptr as_internal(node_ptr p) {
+		return internal_ptr(p.Raw());
+	}
+
+	// 内部节点中第一个大于key的位置，也就是要往下走的孩子
+	// 数值类型的key逐个比较并累加，没有分支，编译器可以向量化
+	template <class K>
+	static size_t upper_index(const Key* keys, size_t n, const K& key) {
+		if constexpr (std::is_arithmetic_v<Key> && std::is_same_v<K, Key>) {
+			size_t r = 0;
+			for (size_t i = 0; i < n; i++) {
+				r += keys[i] <= key;
+			}
+			return r;
+		} else {
+			size_t lo = 0, hi = n;
+			while (lo < hi) {
+				size_t mid = (lo + hi) / 2;
+				if (compare(key, keys[mid]) < 0) {
+					hi = mid;
+				} else {
+					lo = mid + 1;
+				}
+			}
+			return lo;
+		}
+	}
+
+	// 叶子节点中第一个不小于key的位置
+	template <class K>
+	static size_t lower_index(const value_type* values, size_t n, const K& key) {
+		if constexpr (std::is_arithmetic_v<Key> && std::is_same_v<K, Key>) {
+			size_t r = 0;
+			for (size_t i = 0; i < n; i++) {
+				r += values[i].first < key;
+			}
+			return r;
+		} else {
+			size_t lo = 0, hi = n;
+			while (lo < hi) {
+				size_t mid = (lo + hi) / 2;
+				if (compare(key, values[mid].first) > 0) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+			return lo;
+		}
+	}
+
+	// 叶子节点中第一个大于key的位置
+	template <class K>
+	static size_t upper_index(const value_type* values, size_t n, const K& key) {
+		size_t i = lower_index(values, n, key);
+		if (i < n && compare(key, values[i].first) == 0) {
+			i++;
+		}
+		return i;
+	}
+
+	// 找到key所在的叶子节点，path不为空时记录经过的路径
+	template <class K>
+	leaf_ptr descend(const K& key, Path* path) const {
+		auto n = m_root;
+		if (n == shm_nullptr)
+			return shm_nullptr;
+
+		while (!n->leaf) {
+			auto in = as_internal(n);
+			size_t i = upper_index(in->keys(), in->count, key);
+			if (path != nullptr) {
+				assert(path->depth < kMaxDepth);
+				path->nodes[path->depth] = in;
+				path->index[path->depth] = i;
+				path->depth++;
+			}
+			n = in->children[i];
+		}
+		return as_leaf(n);
+	}
+
+	// 位置超过叶子节点末尾的时候换到下一个叶子节点
+	static std::pair<leaf_ptr, size_t> normalize(leaf_ptr leaf, size_t i) {
+		if (leaf != shm_nullptr && i >= leaf->count) {
+			return std::make_pair(leaf->next, size_t(0));
+		}
+		return std::make_pair(leaf, i);
+	}
+
+	template <class K>
+	std::pair<leaf_ptr, size_t> lower_bound_impl(const K& key) const {
+		auto leaf = descend(key, nullptr);
+		if (leaf == shm_nullptr)
+			return std::make_pair(leaf, size_t(0));
+
+		return normalize(leaf, lower_index(leaf->values(), leaf->count, key));
+	}
+
+	template <class K>
+	std::pair<leaf_ptr, size_t> upper_bound_impl(const K& key) const {
+		auto leaf = descend(key, nullptr);
+		if (leaf == shm_nullptr)
+			return std::make_pair(leaf, size_t(0));
+
+		return normalize(leaf, upper_index(leaf->values(), leaf->count, key));
+	}
+
+	template <class K>
+	std::pair<leaf_ptr, size_t> find_impl(const K& key) const {
+		auto leaf = descend(key, nullptr);
+		if (leaf == shm_nullptr)
+			return std::make_pair(leaf, size_t(0));
+
+		auto values = leaf->values();
+		size_t i = lower_index(values, leaf->count, key);
+		if (i < leaf->count && compare(key, values[i].first) == 0) {
+			return std::make_pair(leaf, i);
+		}
+		return std::make_pair(leaf_ptr(), size_t(0));
+	}
+
+	template <class It, class K>
+	std::pair<It, It> equal_range_impl(const K& key) const {
+		auto lb = lower_bound_impl(key);
+		if (lb.first != shm_nullptr && compare(key, lb.first->values()[lb.second].first) == 0) {
+			It first(lb.first, lb.second);
+			It second(first);
+			return std::make_pair(first, ++second);
+		}
+		return std::make_pair(It(lb.first, lb.second), It(lb.first, lb.second));
+	}
+
+	// 把[first, first + n)往后挪一个位置，first处变成未初始化的空间
+	template <class T>
+	static void shift_right(T* first, size_t n) {
+		if (std::is_trivially_copyable<T>::value) {
+			memmove((void*)(first + 1), (const void*)first, sizeof(T) * n);
+		} else {
+			for (size_t i = n; i > 0; i--) {
+				::new (first + i) T(std::move(first[i - 1]));
+				first[i - 1].~T();
+			}
+		}
+	}
+
+	// 把[first + 1, first + 1 + n)往前挪一个位置，first处必须是未初始化的空间
+	template <class T>
+	static void shift_left(T* first, size_t n) {
+		if (std::is_trivially_copyable<T>::value) {
+			memmove((void*)first, (const void*)(first + 1), sizeof(T) * n);
+		} else {
+			for (size_t i = 0; i < n; i++) {
+				::new (first + i) T(std::move(first[i + 1]));
+				first[i + 1].~T();
+			}
+		}
+	}
+
+	// 把src处的n个元素搬到未初始化的dst处
+	template <class T>
+	static void move_n(T* src, size_t n, T* dst) {
+		if (std::is_trivially_copyable<T>::value) {
+			memcpy((void*)dst, (const void*)src, sizeof(T) * n);
+		} else {
+			for (size_t i = 0; i < n; i++) {
+				::new (dst + i) T(std::move(src[i]));
+				src[i].~T();
+			}
+		}
+	}
+
+	leaf_ptr create_leaf() {
+		auto leaf = g_alloc->Malloc<leaf_type>();
+		leaf->count = 0;
+		leaf->leaf = true;
+		leaf->prev = shm_nullptr;
+		leaf->next = shm_nullptr;
+		return leaf;
+	}
+
+	internal_ptr create_internal() {
+		auto node = g_alloc->Malloc<internal_type>();
+		node->count = 0;
+		node->leaf = false;
+		return node;
+	}
+
+	// 析构节点中的元素并释放，内部节点递归释放所有孩子
+	void free_node(node_ptr n) {
+		if (n->leaf) {
+			auto leaf = as_leaf(n);
+			for (size_t i = 0; i < leaf->count; i++) {
+				leaf->values()[i].~value_type();
+			}
+			g_alloc->Free(leaf);
+		} else {
+			auto in = as_internal(n);
+			for (size_t i = 0; i <= in->count; i++) {
+				free_node(in->children[i]);
+			}
+			for (size_t i = 0; i < in->count; i++) {
+				in->keys()[i].~Key();
+			}
+			g_alloc->Free(in);
+		}
+	}
+
+	// 叶子节点从链表中摘下来，元素已经搬走了
+	void unlink_leaf(leaf_ptr leaf) {
+		if (leaf->prev != shm_nullptr) {
+			leaf->prev->next = leaf->next;
+		} else {
+			m_first = leaf->next;
+		}
+
+		if (leaf->next != shm_nullptr) {
+			leaf->next->prev = leaf->prev;
+		} else {
+			m_last = leaf->prev;
+		}
+
+		leaf->count = 0;
+		free_node(node_ptr(leaf.Raw()));
+	}
+
+	// 后一半元素搬到新的叶子节点
+	leaf_ptr split_leaf(leaf_ptr leaf) {
+		auto right = create_leaf();
+		size_t half = leaf->count / 2;
+		move_n(leaf->values() + half, leaf->count - half, right->values());
+		right->count = uint16_t(leaf->count - half);
+		leaf->count = uint16_t(half);
+
+		right->next = leaf->next;
+		right->prev = leaf;
+		if (leaf->next != shm_nullptr) {
+			leaf->next->prev = right;
+		} else {
+			m_last = right;
+		}
+		leaf->next = right;
+		return right;
+	}
+
+	// 在path[depth - 1]中left的右边插入key和right，满了继续向上分裂
+	void insert_into_parent(Path& path, size_t depth, node_ptr left, const Key& key, node_ptr right) {
+		if (depth == 0) {
+			// 根节点分裂，树长高一层
+			auto root = create_internal();
+			::new (root->keys()) Key(key);
+			root->children[0] = left;
+			root->children[1] = right;
+			root->count = 1;
+			m_root = node_ptr(root.Raw());
+			return;
+		}
+
+		auto parent = path.nodes[depth - 1];
+		size_t i = path.index[depth - 1];
+		shift_right(parent->keys() + i, parent->count - i);
+		shift_right(parent->children + i + 1, parent->count - i);
+		::new (parent->keys() + i) Key(key);
+		parent->children[i + 1] = right;
+		parent->count++;
+
+		if (parent->count <= kMaxInternal)
+			return;
+
+		// 中间的key提到上一层，右半边搬到新节点
+		auto sibling = create_internal();
+		size_t mid = parent->count / 2;
+		size_t right_count = parent->count - mid - 1;
+		move_n(parent->keys() + mid + 1, right_count, sibling->keys());
+		move_n(parent->children + mid + 1, right_count + 1, sibling->children);
+		sibling->count = uint16_t(right_count);
+		parent->count = uint16_t(mid);
+
+		Key* promoted = parent->keys() + mid;
+		insert_into_parent(path, depth - 1, node_ptr(parent.Raw()), *promoted, node_ptr(sibling.Raw()));
+		promoted->~Key();
+	}
+
+	// 从parent中删除第i个key和它右边的孩子
+	static void remove_from_internal(internal_ptr parent, size_t i) {
+		parent->keys()[i].~Key();
+		shift_left(parent->keys() + i, parent->count - i - 1);
+		shift_left(parent->children + i + 1, parent->count - i - 1);
+		parent->count--;
+	}
+
+	// 叶子节点元素太少，先找兄弟借，借不到就合并，index跟着调整，删除之后返回下一个元素要用
+	void rebalance_leaf(Path& path, leaf_ptr& leaf, size_t& index) {
+		auto parent = path.nodes[path.depth - 1];
+		size_t c = path.index[path.depth - 1];
+
+		if (c > 0) {
+			auto left = as_leaf(parent->children[c - 1]);
+			if (left->count > kMinLeaf) {
+				shift_right(leaf->values(), leaf->count);
+				move_n(left->values() + left->count - 1, 1, leaf->values());
+				left->count--;
+				leaf->count++;
+				parent->keys()[c - 1] = leaf->values()[0].first;
+				index++;
+				return;
+			}
+		}
+
+		if (c < parent->count) {
+			auto right = as_leaf(parent->children[c + 1]);
+			if (right->count > kMinLeaf) {
+				move_n(right->values(), 1, leaf->values() + leaf->count);
+				shift_left(right->values(), right->count - 1);
+				right->count--;
+				leaf->count++;
+				parent->keys()[c] = right->values()[0].first;
+				return;
+			}
+		}
+
+		if (c > 0) {
+			// 并到左边的兄弟中
+			auto left = as_leaf(parent->children[c - 1]);
+			move_n(leaf->values(), leaf->count, left->values() + left->count);
+			index += left->count;
+			left->count += leaf->count;
+			unlink_leaf(leaf);
+			leaf = left;
+			remove_from_internal(parent, c - 1);
+		} else {
+			// 右边的兄弟并进来
+			auto right = as_leaf(parent->children[c + 1]);
+			move_n(right->values(), right->count, leaf->values() + leaf->count);
+			leaf->count += right->count;
+			unlink_leaf(right);
+			remove_from_internal(parent, c);
+		}
+
+		rebalance_internal(path, path.depth - 1);
+	}
+
+	// 内部节点key太少，和叶子节点一样先借后合并，借的时候要经过父节点中的key
+	void rebalance_internal(Path& path, size_t depth) {
+		auto node = path.nodes[depth];
+		if (depth == 0) {
+			// 根节点只剩一个孩子，树变矮一层
+			if (node->count == 0) {
+				m_root = node->children[0];
+				g_alloc->Free(node);
+			}
+			return;
+		}
+
+		if (node->count >= kMinInternal)
+			return;
+
+		auto parent = path.nodes[depth - 1];
+		size_t c = path.index[depth - 1];
+
+		if (c > 0) {
+			auto left = as_internal(parent->children[c - 1]);
+			if (left->count > kMinInternal) {
+				shift_right(node->keys(), node->count);
+				shift_right(node->children, node->count + 1);
+				::new (node->keys()) Key(std::move(parent->keys()[c - 1]));
+				node->children[0] = left->children[left->count];
+				node->count++;
+				parent->keys()[c - 1] = std::move(left->keys()[left->count - 1]);
+				left->keys()[left->count - 1].~Key();
+				left->count--;
+				return;
+			}
+		}
+
+		if (c < parent->count) {
+			auto right = as_internal(parent->children[c + 1]);
+			if (right->count > kMinInternal) {
+				::new (node->keys() + node->count) Key(std::move(parent->keys()[c]));
+				node->children[node->count + 1] = right->children[0];
+				node->count++;
+				parent->keys()[c] = std::move(right->keys()[0]);
+				right->keys()[0].~Key();
+				shift_left(right->keys(), right->count - 1);
+				shift_left(right->children, right->count);
+				right->count--;
+				return;
+			}
+		}
+
+		if (c > 0) {
+			merge_internal(as_internal(parent->children[c - 1]), parent->keys()[c - 1], node);
+			remove_from_internal(parent, c - 1);
+		} else {
+			merge_internal(node, parent->keys()[c], as_internal(parent->children[c + 1]));
+			remove_from_internal(parent, c);
+		}
+
+		rebalance_internal(path, depth - 1);
+	}
+
+	// right连同父节点中的分隔key一起并到left中，释放right
+	void merge_internal(internal_ptr left, Key& separator, internal_ptr right) {
+		::new (left->keys() + left->count) Key(std::move(separator));
+		move_n(right->keys(), right->count, left->keys() + left->count + 1);
+		move_n(right->children, right->count + 1, left->children + left->count + 1);
+		left->count += right->count + 1;
+		g_alloc->Free(right);
+	}
+
+private:
+	node_ptr m_root = shm_nullptr;
+	leaf_ptr m_first = shm_nullptr;
+	leaf_ptr m_last = shm_nullptr;
+	size_t m_size = 0;
+};
+
+} // namespace smd
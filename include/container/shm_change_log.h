@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <atomic>
+#include <algorithm>
+#include <container/shm_ring.h>
+
+namespace smd {
+
+enum class ChangeOp : uint8_t {
+	kInsert = 1,
+	kUpdate = 2,
+	kErase = 3,
+};
+
+// 一条变更记录：哪个容器(table)中的哪个key发生了什么变化
+// sub_key用于嵌套容器，比如玩家的物品表，key是玩家ID，sub_key是物品ID
+struct ChangeRecord {
+	uint32_t table;
+	ChangeOp op;
+	uint8_t reserved[3];
+	int64_t key;
+	int64_t sub_key;
+
+	bool same_object(const ChangeRecord& r) const {
+		return table == r.table && key == r.key && sub_key == r.sub_key;
+	}
+};
+
+// 数据修改方(game)写、落地方(db)读的变更日志，db只需要处理变化过的对象，不用全表扫描
+// 写入永远不会阻塞：队列满了就丢弃并记下溢出次数，消费者发现溢出之后做一次全量同步
+// 内部是shm_spsc_ring，只能有一个写入方和一个消费方
+class shm_change_log {
+public:
+	explicit shm_change_log(size_t capacity = 64 * 1024)
+		: m_ring(capacity) {}
+
+	shm_change_log(const shm_change_log&) = delete;
+	shm_change_log& operator=(const shm_change_log&) = delete;
+
+	void emit(uint32_t table, ChangeOp op, int64_t key, int64_t sub_key = 0) {
+		ChangeRecord r;
+		r.table = table;
+		r.op = op;
+		r.reserved[0] = r.reserved[1] = r.reserved[2] = 0;
+		r.key = key;
+		r.sub_key = sub_key;
+		if (!m_ring.try_push(r)) {
+			m_overflow.fetch_add(1, std::memory_order_release);
+		}
+	}
+
+	// 取出并清零溢出次数，返回值大于0时说明有变更丢失，需要全量同步
+	uint64_t take_overflow() {
+		return m_overflow.exchange(0, std::memory_order_acquire);
+	}
+
+	size_t size() const {
+		return m_ring.size();
+	}
+
+	size_t capacity() const {
+		return m_ring.capacity();
+	}
+
+	// 取出最多max_count条记录，f(const ChangeRecord*, size_t)每次处理一批
+	// timeout_ms为0时不等待，大于0时最多等这么久，小于0时一直等到有记录
+	template <class F>
+	size_t consume(F&& f, size_t max_count = SIZE_MAX, int timeout_ms = 0) {
+		ChangeRecord batch[kBatch];
+		size_t total = 0;
+		while (total < max_count) {
+			size_t want = std::min(kBatch, max_count - total);
+			size_t n = total == 0 && timeout_ms != 0 ? m_ring.pop_batch_wait(batch, want, timeout_ms)
+													 : m_ring.pop_batch(batch, want);
+			if (n == 0)
+				break;
+			f((const ChangeRecord*)batch, n);
+			total += n;
+		}
+		return total;
+	}
+
+private:
+	static constexpr size_t kBatch = 256;
+
+	shm_spsc_ring<ChangeRecord> m_ring;
+	std::atomic<uint64_t> m_overflow{0};
+};
+
+} // namespace smd
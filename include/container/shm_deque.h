@@ -0,0 +1,368 @@
+﻿#pragma once
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+// 分段连续的双端队列，元素放在固定大小的块中，块的偏移记录在一个环形的中控数组里
+// 两端push/pop都是均摊O(1)，已有元素不会被搬迁；同一块内的元素是连续的，遍历比链表快得多
+// 每块大约BlockBytes字节，至少8个元素；空队列不占用共享内存
+// 尾部最多保留一个空块，pop_front腾空的块直接挪到尾部复用，先进先出的队列稳定之后不再分配
+template <class T, size_t BlockBytes = 4096>
+class shm_deque {
+public:
+	typedef T value_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+
+	static constexpr size_t kBlockSize = BlockBytes / sizeof(T) >= 8 ? BlockBytes / sizeof(T) : 8;
+
+	// 迭代器记录的是容器的地址，只能临时使用，不能存放到共享内存中
+	class iterator {
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+
+		iterator() {}
+
+		iterator(const shm_deque* d, size_t index)
+			: m_deque(d)
+			, m_index(index) {
+			seek();
+		}
+
+		T& operator*() const {
+			return *m_cur;
+		}
+
+		T* operator->() const {
+			return m_cur;
+		}
+
+		T& operator[](std::ptrdiff_t n) const {
+			return *(*this + n);
+		}
+
+		iterator& operator++() {
+			++m_index;
+			if (++m_cur == m_block_end) {
+				seek();
+			}
+			return *this;
+		}
+
+		iterator operator++(int) {
+			auto res = *this;
+			++*this;
+			return res;
+		}
+
+		iterator& operator--() {
+			--m_index;
+			seek();
+			return *this;
+		}
+
+		iterator operator--(int) {
+			auto res = *this;
+			--*this;
+			return res;
+		}
+
+		iterator& operator+=(std::ptrdiff_t n) {
+			m_index += n;
+			seek();
+			return *this;
+		}
+
+		iterator& operator-=(std::ptrdiff_t n) {
+			return *this += -n;
+		}
+
+		friend iterator operator+(iterator it, std::ptrdiff_t n) {
+			return it += n;
+		}
+
+		friend iterator operator-(iterator it, std::ptrdiff_t n) {
+			return it -= n;
+		}
+
+		friend std::ptrdiff_t operator-(const iterator& x, const iterator& y) {
+			return std::ptrdiff_t(x.m_index - y.m_index);
+		}
+
+		friend bool operator==(const iterator& x, const iterator& y) {
+			return x.m_index == y.m_index;
+		}
+
+		friend bool operator!=(const iterator& x, const iterator& y) {
+			return x.m_index != y.m_index;
+		}
+
+		friend bool operator<(const iterator& x, const iterator& y) {
+			return x.m_index < y.m_index;
+		}
+
+	private:
+		// 定位到m_index所在的块，块内移动时只需要移动指针
+		void seek() {
+			size_t p = m_deque->m_head + m_index;
+			if (p < m_deque->m_blocks * kBlockSize) {
+				T* b = m_deque->block(p / kBlockSize).Ptr();
+				m_cur = b + p % kBlockSize;
+				m_block_end = b + kBlockSize;
+			} else {
+				m_cur = m_block_end = nullptr;
+			}
+		}
+
+	private:
+		const shm_deque* m_deque = nullptr;
+		size_t m_index = 0;
+		T* m_cur = nullptr;
+		T* m_block_end = nullptr;
+	};
+
+	shm_deque() {}
+
+	shm_deque(const shm_deque& r) {
+		for (size_t i = 0; i < r.size(); i++) {
+			push_back(r[i]);
+		}
+	}
+
+	// 移动时只交换中控数组，不搬动元素
+	shm_deque(shm_deque&& r) noexcept {
+		swap(r);
+	}
+
+	shm_deque& operator=(const shm_deque& r) {
+		if (this != &r) {
+			shm_deque(r).swap(*this);
+		}
+		return *this;
+	}
+
+	shm_deque& operator=(shm_deque&& r) noexcept {
+		if (this != &r) {
+			clear();
+			swap(r);
+		}
+		return *this;
+	}
+
+	~shm_deque() {
+		clear();
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	T& operator[](size_t i) {
+		return *address(i);
+	}
+
+	const T& operator[](size_t i) const {
+		return *address(i);
+	}
+
+	T& front() {
+		return *address(0);
+	}
+
+	T& back() {
+		return *address(m_size - 1);
+	}
+
+	iterator begin() const {
+		return iterator(this, 0);
+	}
+
+	iterator end() const {
+		return iterator(this, m_size);
+	}
+
+	void push_back(const T& val) {
+		emplace_back(val);
+	}
+
+	void push_back(T&& val) {
+		emplace_back(std::move(val));
+	}
+
+	template <typename... P>
+	T& emplace_back(P&&... params) {
+		if (m_head + m_size == m_blocks * kBlockSize) {
+			add_block_back();
+		}
+		T* p = address(m_size);
+		::new (p) T(std::forward<P>(params)...);
+		++m_size;
+		return *p;
+	}
+
+	void push_front(const T& val) {
+		emplace_front(val);
+	}
+
+	void push_front(T&& val) {
+		emplace_front(std::move(val));
+	}
+
+	template <typename... P>
+	T& emplace_front(P&&... params) {
+		if (m_head == 0) {
+			add_block_front();
+		}
+		T* p = block(0).Ptr() + m_head - 1;
+		::new (p) T(std::forward<P>(params)...);
+		--m_head;
+		++m_size;
+		return *p;
+	}
+
+	void pop_back() {
+		assert(m_size > 0);
+		address(m_size - 1)->~T();
+		--m_size;
+		trim_back();
+	}
+
+	void pop_front() {
+		assert(m_size > 0);
+		address(0)->~T();
+		--m_size;
+		if (++m_head == kBlockSize) {
+			// 腾空的块挪到尾部，不释放
+			auto b = block(0);
+			m_first = (m_first + 1) & (m_map_size - 1);
+			m_head = 0;
+			block(m_blocks - 1) = b;
+		}
+		trim_back();
+	}
+
+	// 析构所有元素，块和中控数组都还给g_alloc
+	void clear() {
+		if (!std::is_trivially_destructible<T>::value) {
+			for (size_t i = 0; i < m_size; i++) {
+				address(i)->~T();
+			}
+		}
+		for (size_t i = 0; i < m_blocks; i++) {
+			g_alloc->Free(block(i), kBlockSize);
+		}
+		if (m_map != shm_nullptr) {
+			g_alloc->Free(m_map, m_map_size);
+		}
+		m_map = shm_nullptr;
+		m_map_size = 0;
+		m_first = 0;
+		m_blocks = 0;
+		m_head = 0;
+		m_size = 0;
+	}
+
+	void swap(shm_deque& r) {
+		std::swap(m_map, r.m_map);
+		std::swap(m_map_size, r.m_map_size);
+		std::swap(m_first, r.m_first);
+		std::swap(m_blocks, r.m_blocks);
+		std::swap(m_head, r.m_head);
+		std::swap(m_size, r.m_size);
+	}
+
+private:
+	// 第n个块，按中控数组中的环形位置计算
+	shm_pointer<T>& block(size_t n) const {
+		return m_map.Ptr()[(m_first + n) & (m_map_size - 1)];
+	}
+
+	T* address(size_t i) const {
+		size_t p = m_head + i;
+		return block(p / kBlockSize).Ptr() + p % kBlockSize;
+	}
+
+	// 存放了元素的块数，多出来的就是尾部的空块
+	size_t used_blocks() const {
+		return (m_head + m_size + kBlockSize - 1) / kBlockSize;
+	}
+
+	void add_block_back() {
+		if (m_blocks == m_map_size) {
+			grow_map();
+		}
+		block(m_blocks) = g_alloc->Malloc<T>(kBlockSize);
+		++m_blocks;
+	}
+
+	// 尾部有空块时挪到头部使用，否则分配新块
+	void add_block_front() {
+		shm_pointer<T> b;
+		if (m_blocks > used_blocks()) {
+			b = block(m_blocks - 1);
+			--m_blocks;
+		} else {
+			if (m_blocks == m_map_size) {
+				grow_map();
+			}
+			b = g_alloc->Malloc<T>(kBlockSize);
+		}
+		m_first = (m_first + m_map_size - 1) & (m_map_size - 1);
+		block(0) = b;
+		++m_blocks;
+		m_head = kBlockSize;
+	}
+
+	// 尾部最多保留一个空块，避免在块边界上来回push/pop时反复分配
+	void trim_back() {
+		if (m_size == 0) {
+			m_head = 0;
+		}
+		size_t needed = used_blocks();
+		while (m_blocks > needed + 1) {
+			--m_blocks;
+			g_alloc->Free(block(m_blocks), kBlockSize);
+		}
+	}
+
+	// 中控数组翻倍，块按顺序搬到新数组的开头
+	void grow_map() {
+		uint32_t new_size = m_map_size == 0 ? 4 : m_map_size * 2;
+		auto new_map = g_alloc->Malloc<shm_pointer<T>>(new_size);
+		for (size_t i = 0; i < m_blocks; i++) {
+			new_map[i] = block(i);
+		}
+		if (m_map != shm_nullptr) {
+			g_alloc->Free(m_map, m_map_size);
+		}
+		m_map = new_map;
+		m_map_size = new_size;
+		m_first = 0;
+	}
+
+private:
+	shm_pointer<shm_pointer<T>> m_map = shm_nullptr;
+	// 中控数组的大小，总是2的幂
+	uint32_t m_map_size = 0;
+	// 第一个块在中控数组中的位置
+	uint32_t m_first = 0;
+	size_t m_blocks = 0;
+	// 第一个元素在第一个块中的位置
+	size_t m_head = 0;
+	size_t m_size = 0;
+};
+
+} // namespace smd
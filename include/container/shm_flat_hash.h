@@ -0,0 +1,629 @@
+﻿#pragma once
+#include <stdint.h>
+#include <functional>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SMD_FLAT_HASH_SSE2 1
+#endif
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+#include <common/functional.h>
+#include <container/shm_pointer.h>
+#include <container/shm_vector.h>
+
+namespace smd {
+
+//
+// 开放寻址的哈希表（参考Swiss Table）
+// 所有的控制字节和槽位都放在同一块共享内存里，查找的时候一次比较16个控制字节
+//
+// 控制字节：空(kEmpty)、已删除(kDeleted)、或者哈希值的低7位(H2)
+// 控制字节之后还多存了16个字节，是前16个控制字节的镜像，这样从任何位置开始都能完整地读取一组
+//
+// 组的宽度固定为16，和编译选项无关，这样不同指令集编译出来的进程访问同一片共享内存也能得到相同的结果
+//
+namespace flat_hash {
+
+enum : int8_t {
+	kEmpty = -128,
+	kDeleted = -2,
+};
+
+enum : size_t {
+	kGroupWidth = 16,
+};
+
+// 以murmur3的fmix64打散一下，std::hash对整数是恒等映射，不打散的话高位和低位都不够随机
+inline uint64_t Mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+inline size_t H1(uint64_t hash) {
+	return size_t(hash >> 7);
+}
+
+inline int8_t H2(uint64_t hash) {
+	return int8_t(hash & 0x7f);
+}
+
+inline uint32_t CountTrailingZeros(uint32_t x) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return index;
+#else
+	return __builtin_ctz(x);
+#endif
+}
+
+// 一组控制字节的匹配结果，第i位为1表示第i个字节匹配
+class BitMask {
+public:
+	explicit BitMask(uint32_t mask)
+		: m_mask(mask) {}
+
+	explicit operator bool() const {
+		return m_mask != 0;
+	}
+
+	uint32_t LowestBitSet() const {
+		return CountTrailingZeros(m_mask);
+	}
+
+	BitMask& operator++() {
+		m_mask &= m_mask - 1;
+		return *this;
+	}
+
+	uint32_t operator*() const {
+		return LowestBitSet();
+	}
+
+	BitMask begin() const {
+		return *this;
+	}
+
+	BitMask end() const {
+		return BitMask(0);
+	}
+
+	bool operator!=(const BitMask& r) const {
+		return m_mask != r.m_mask;
+	}
+
+private:
+	uint32_t m_mask;
+};
+
+#ifdef SMD_FLAT_HASH_SSE2
+class Group {
+public:
+	explicit Group(const int8_t* pos)
+		: m_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+	BitMask Match(int8_t h2) const {
+		return BitMask(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl))));
+	}
+
+	BitMask MatchEmpty() const {
+		return BitMask(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(kEmpty), m_ctrl))));
+	}
+
+	// 空和已删除的控制字节最高位都是1
+	BitMask MatchEmptyOrDeleted() const {
+		return BitMask(uint32_t(_mm_movemask_epi8(m_ctrl)));
+	}
+
+private:
+	__m128i m_ctrl;
+};
+#else
+// 没有SSE2的时候用两个64位整数模拟，结果和SSE2完全一致
+class Group {
+public:
+	explicit Group(const int8_t* pos) {
+		memcpy(&m_lo, pos, sizeof(m_lo));
+		memcpy(&m_hi, pos + sizeof(m_lo), sizeof(m_hi));
+	}
+
+	BitMask Match(int8_t h2) const {
+		return BitMask(Gather(MatchWord(m_lo, h2)) | (Gather(MatchWord(m_hi, h2)) << 8));
+	}
+
+	BitMask MatchEmpty() const {
+		return BitMask(Gather(EmptyWord(m_lo)) | (Gather(EmptyWord(m_hi)) << 8));
+	}
+
+	BitMask MatchEmptyOrDeleted() const {
+		return BitMask(Gather(m_lo & kMsbs) | (Gather(m_hi & kMsbs) << 8));
+	}
+
+private:
+	static constexpr uint64_t kLsbs = 0x0101010101010101ULL;
+	static constexpr uint64_t kMsbs = 0x8080808080808080ULL;
+
+	// 逐字节精确比较，避免借位带来的误判
+	static uint64_t MatchWord(uint64_t word, int8_t h2) {
+		uint64_t x = word ^ (kLsbs * uint8_t(h2));
+		return ~(((x & ~kMsbs) + ~kMsbs) | x) & kMsbs;
+	}
+
+	static uint64_t EmptyWord(uint64_t word) {
+		return (word & ~(word << 6)) & kMsbs;
+	}
+
+	// 把每个字节的最高位收集成8位的掩码
+	static uint32_t Gather(uint64_t msbs) {
+		return uint32_t(((msbs >> 7) * 0x0102040810204080ULL) >> 56);
+	}
+
+	uint64_t m_lo;
+	uint64_t m_hi;
+};
+#endif
+
+} // namespace flat_hash
+
+template <class Table, class Value>
+class FlatHashIterator {
+public:
+	FlatHashIterator(const int8_t* ctrl = nullptr, const int8_t* ctrl_end = nullptr, Value* slot = nullptr)
+		: m_ctrl(ctrl)
+		, m_ctrl_end(ctrl_end)
+		, m_slot(slot) {
+		skip_empty_or_deleted();
+	}
+
+	FlatHashIterator& operator++() {
+		++m_ctrl;
+		++m_slot;
+		skip_empty_or_deleted();
+		return *this;
+	}
+
+	FlatHashIterator operator++(int) {
+		auto res = *this;
+		++*this;
+		return res;
+	}
+
+	Value& operator*() const {
+		return *m_slot;
+	}
+
+	Value* operator->() const {
+		return m_slot;
+	}
+
+	bool operator==(const FlatHashIterator& r) const {
+		return m_ctrl == r.m_ctrl;
+	}
+
+	bool operator!=(const FlatHashIterator& r) const {
+		return m_ctrl != r.m_ctrl;
+	}
+
+private:
+	friend Table;
+
+	void skip_empty_or_deleted() {
+		while (m_ctrl != m_ctrl_end && *m_ctrl < 0) {
+			++m_ctrl;
+			++m_slot;
+		}
+
+		if (m_ctrl == m_ctrl_end) {
+			m_ctrl = nullptr;
+			m_slot = nullptr;
+		}
+	}
+
+	const int8_t* m_ctrl;
+	const int8_t* m_ctrl_end;
+	Value* m_slot;
+};
+
+template <class Key, class Value, class KeyOfValue, class Hash, class KeyEqual>
+class shm_flat_hash_table {
+public:
+	typedef shm_flat_hash_table<Key, Value, KeyOfValue, Hash, KeyEqual> this_type;
+	typedef Key key_type;
+	typedef Value value_type;
+	typedef FlatHashIterator<this_type, value_type> iterator;
+
+	shm_flat_hash_table() {}
+
+	shm_flat_hash_table(const this_type& r) {
+		reserve(r.size());
+		for (auto it = r.begin(); it != r.end(); ++it) {
+			insert_unique(*it);
+		}
+	}
+
+	// 移动时只交换控制字节和槽位的偏移，对方变成没有分配空间的空表
+	shm_flat_hash_table(this_type&& r) noexcept {
+		swap(r);
+	}
+
+	this_type& operator=(const this_type& r) {
+		if (this != &r) {
+			this_type(r).swap(*this);
+		}
+		return *this;
+	}
+
+	this_type& operator=(this_type&& r) noexcept {
+		if (this != &r) {
+			this_type(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
+	~shm_flat_hash_table() {
+		destroy();
+	}
+
+	iterator begin() const {
+		if (m_size == 0)
+			return end();
+		return iterator(ctrl(), ctrl() + m_capacity, slots());
+	}
+
+	iterator end() const {
+		return iterator();
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	float load_factor() const {
+		return m_capacity == 0 ? 0.0f : (float)m_size / (float)m_capacity;
+	}
+
+	iterator find(const key_type& key) const {
+		return find_impl(key);
+	}
+
+	// Hash和KeyEqual都是透明的时候，可以直接用Slice之类的类型查找，不会构造key
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	iterator find(const K& key) const {
+		return find_impl(key);
+	}
+
+	size_t count(const key_type& key) const {
+		return find(key) == end() ? 0 : 1;
+	}
+
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	size_t count(const K& key) const {
+		return find(key) == end() ? 0 : 1;
+	}
+
+	bool contains(const key_type& key) const {
+		return find(key) != end();
+	}
+
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	bool contains(const K& key) const {
+		return find(key) != end();
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return emplace(value);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return emplace(std::move(value));
+	}
+
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		// 先构造出来才能拿到key
+		value_type value(std::forward<P>(params)...);
+		auto res = find_or_prepare_insert(KeyOfValue()(value));
+		if (!res.second)
+			return std::make_pair(iterator_at(res.first), false);
+
+		::new (slots() + res.first) value_type(std::move(value));
+		return std::make_pair(iterator_at(res.first), true);
+	}
+
+	size_t erase(const key_type& key) {
+		return erase_impl(key);
+	}
+
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	size_t erase(const K& key) {
+		return erase_impl(key);
+	}
+
+	iterator erase(iterator it) {
+		auto next = it;
+		++next;
+		erase_at(size_t(it.m_ctrl - ctrl()));
+		return next;
+	}
+
+	void clear() {
+		if (m_capacity == 0)
+			return;
+
+		for (size_t i = 0; i < m_capacity; i++) {
+			if (ctrl()[i] >= 0) {
+				slots()[i].~value_type();
+			}
+		}
+
+		memset(ctrl(), flat_hash::kEmpty, m_capacity + flat_hash::kGroupWidth);
+		m_size = 0;
+		m_growth_left = growth_of(m_capacity);
+	}
+
+	// 预留至少能容纳n个元素的空间，之后插入n个元素都不会再扩容
+	void reserve(size_t n) {
+		size_t new_capacity = flat_hash::kGroupWidth;
+		while (growth_of(new_capacity) < n) {
+			new_capacity *= 2;
+		}
+
+		if (new_capacity > m_capacity) {
+			resize(new_capacity);
+		}
+	}
+
+	void swap(this_type& r) {
+		std::swap(m_ctrl, r.m_ctrl);
+		std::swap(m_capacity, r.m_capacity);
+		std::swap(m_size, r.m_size);
+		std::swap(m_growth_left, r.m_growth_left);
+	}
+
+protected:
+	// 查找key，找不到的话预留一个槽位，返回槽位的下标和是否需要在该槽位构造新元素
+	std::pair<size_t, bool> find_or_prepare_insert(const key_type& key) {
+		auto it = find(key);
+		if (it != end())
+			return std::make_pair(size_t(it.m_ctrl - ctrl()), false);
+
+		if (m_capacity == 0) {
+			rehash_and_grow();
+		}
+
+		auto hash = hash_of(key);
+		auto pos = find_first_non_full(hash);
+		if (m_growth_left == 0 && ctrl()[pos] != flat_hash::kDeleted) {
+			rehash_and_grow();
+			pos = find_first_non_full(hash);
+		}
+
+		if (ctrl()[pos] == flat_hash::kEmpty) {
+			--m_growth_left;
+		}
+
+		set_ctrl(pos, flat_hash::H2(hash));
+		++m_size;
+		return std::make_pair(pos, true);
+	}
+
+	template <class V>
+	void insert_unique(V&& value) {
+		auto res = find_or_prepare_insert(KeyOfValue()(value));
+		if (res.second) {
+			::new (slots() + res.first) value_type(std::forward<V>(value));
+		}
+	}
+
+	iterator iterator_at(size_t pos) const {
+		return iterator(ctrl() + pos, ctrl() + m_capacity, slots() + pos);
+	}
+
+	value_type* slots() const {
+		return (value_type*)((char*)m_ctrl.Ptr() + slot_offset(m_capacity));
+	}
+
+private:
+	template <class K>
+	iterator find_impl(const K& key) const {
+		if (m_size == 0)
+			return end();
+
+		auto hash = hash_of(key);
+		auto h2 = flat_hash::H2(hash);
+		const int8_t* c = ctrl();
+		value_type* s = slots();
+		size_t offset = flat_hash::H1(hash) & mask();
+		for (size_t index = 0;;) {
+			flat_hash::Group g(c + offset);
+			for (uint32_t i : g.Match(h2)) {
+				size_t pos = (offset + i) & mask();
+				if (KeyEqual()(KeyOfValue()(s[pos]), key))
+					return iterator_at(pos);
+			}
+
+			if (g.MatchEmpty())
+				return end();
+
+			index += flat_hash::kGroupWidth;
+			offset = (offset + index) & mask();
+			assert(index <= m_capacity);
+		}
+	}
+
+	template <class K>
+	size_t erase_impl(const K& key) {
+		auto it = find_impl(key);
+		if (it == end())
+			return 0;
+
+		erase(it);
+		return 1;
+	}
+
+	int8_t* ctrl() const {
+		return m_ctrl.Ptr();
+	}
+
+	size_t mask() const {
+		return m_capacity - 1;
+	}
+
+	template <class K>
+	static uint64_t hash_of(const K& key) {
+		return flat_hash::Mix(uint64_t(Hash()(key)));
+	}
+
+	// 最大负载因子是7/8
+	static size_t growth_of(size_t capacity) {
+		return capacity - capacity / 8;
+	}
+
+	static size_t slot_offset(size_t capacity) {
+		const size_t align = alignof(value_type);
+		return (capacity + flat_hash::kGroupWidth + align - 1) & ~(align - 1);
+	}
+
+	static size_t alloc_size(size_t capacity) {
+		return slot_offset(capacity) + capacity * sizeof(value_type);
+	}
+
+	void set_ctrl(size_t pos, int8_t h) {
+		int8_t* c = ctrl();
+		c[pos] = h;
+		// 前16个控制字节在末尾有镜像
+		if (pos < flat_hash::kGroupWidth) {
+			c[m_capacity + pos] = h;
+		}
+	}
+
+	size_t find_first_non_full(uint64_t hash) const {
+		const int8_t* c = ctrl();
+		size_t offset = flat_hash::H1(hash) & mask();
+		for (size_t index = 0;;) {
+			flat_hash::Group g(c + offset);
+			auto m = g.MatchEmptyOrDeleted();
+			if (m)
+				return (offset + m.LowestBitSet()) & mask();
+
+			index += flat_hash::kGroupWidth;
+			offset = (offset + index) & mask();
+			assert(index <= m_capacity);
+		}
+	}
+
+	void erase_at(size_t pos) {
+		slots()[pos].~value_type();
+		set_ctrl(pos, flat_hash::kDeleted);
+		--m_size;
+	}
+
+	// 已删除的槽位太多的时候原地整理，否则容量翻倍
+	void rehash_and_grow() {
+		if (m_capacity == 0) {
+			resize(flat_hash::kGroupWidth);
+		} else if (m_size <= growth_of(m_capacity) / 2) {
+			resize(m_capacity);
+		} else {
+			resize(m_capacity * 2);
+		}
+	}
+
+	void resize(size_t new_capacity) {
+		auto old_ctrl = m_ctrl;
+		auto old_capacity = m_capacity;
+		value_type* old_slots = old_capacity > 0 ? slots() : nullptr;
+
+		m_ctrl = g_alloc->Malloc<int8_t>(alloc_size(new_capacity));
+		m_capacity = new_capacity;
+		m_growth_left = growth_of(new_capacity) - m_size;
+		memset(ctrl(), flat_hash::kEmpty, new_capacity + flat_hash::kGroupWidth);
+
+		if (old_capacity == 0)
+			return;
+
+		const int8_t* old_c = old_ctrl.Ptr();
+		value_type* new_slots = slots();
+		for (size_t i = 0; i < old_capacity; i++) {
+			if (old_c[i] >= 0) {
+				auto hash = hash_of(KeyOfValue()(old_slots[i]));
+				auto pos = find_first_non_full(hash);
+				set_ctrl(pos, flat_hash::H2(hash));
+				relocate_n(old_slots + i, 1, new_slots + pos);
+			}
+		}
+
+		g_alloc->Free(old_ctrl, alloc_size(old_capacity));
+	}
+
+	void destroy() {
+		if (m_capacity == 0)
+			return;
+
+		clear();
+		g_alloc->Free(m_ctrl, alloc_size(m_capacity));
+		m_capacity = 0;
+		m_growth_left = 0;
+	}
+
+private:
+	shm_pointer<int8_t> m_ctrl = shm_nullptr;
+	size_t m_capacity = 0;
+	size_t m_size = 0;
+	size_t m_growth_left = 0;
+};
+
+template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+class shm_flat_hash_set : public shm_flat_hash_table<Key, Key, identity<Key>, Hash, KeyEqual> {};
+
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+class shm_flat_hash_map
+	: public shm_flat_hash_table<Key, std::pair<Key, Value>, select1st<std::pair<Key, Value>>, Hash,
+		  KeyEqual> {
+	typedef shm_flat_hash_table<Key, std::pair<Key, Value>, select1st<std::pair<Key, Value>>, Hash, KeyEqual>
+		base_type;
+
+public:
+	typedef typename base_type::iterator iterator;
+	typedef Value mapped_type;
+
+	// key不存在的时候才用参数构造value
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& key, P&&... params) {
+		auto res = this->find_or_prepare_insert(key);
+		if (res.second) {
+			::new (this->slots() + res.first) std::pair<Key, Value>(
+				std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<P>(params)...));
+		}
+		return std::make_pair(this->iterator_at(res.first), res.second);
+	}
+
+	template <class V>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+		auto res = try_emplace(key, std::forward<V>(value));
+		if (!res.second) {
+			res.first->second = std::forward<V>(value);
+		}
+		return res;
+	}
+
+	mapped_type& operator[](const Key& key) {
+		return try_emplace(key).first->second;
+	}
+};
+
+} // namespace smd
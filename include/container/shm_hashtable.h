@@ -0,0 +1,539 @@
+﻿#pragma once
+#include <functional>
+#include <utility>
+#include <tuple>
+#include <type_traits>
+#include <common/functional.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+// CacheHash为true的时候在节点中保存key的哈希值，rehash的时候不用重新计算，查找的时候先比较哈希值
+template <class Value, bool CacheHash>
+struct HashNode {
+	typedef Value value_type;
+
+	shm_pointer<HashNode> next;
+	size_t hash;
+	Value value;
+
+	template <typename... P>
+	HashNode(shm_pointer<HashNode> n, size_t h, P&&... params)
+		: next(n)
+		, hash(h)
+		, value(std::forward<P>(params)...) {}
+};
+
+// 整数之类的key计算哈希值很快，不保存，节点更小
+template <class Value>
+struct HashNode<Value, false> {
+	typedef Value value_type;
+
+	shm_pointer<HashNode> next;
+	Value value;
+
+	template <typename... P>
+	HashNode(shm_pointer<HashNode> n, size_t, P&&... params)
+		: next(n)
+		, value(std::forward<P>(params)...) {}
+};
+
+template <class Table, class Node>
+class HashIterator {
+	typedef typename Node::value_type Value;
+	typedef shm_pointer<Node> node_pointer;
+
+public:
+	HashIterator(shm_pointer<Table> c, int table, size_t bucket, node_pointer node)
+		: container_(c)
+		, table_(table)
+		, bucket_index_(bucket)
+		, node_(node) {}
+
+	HashIterator& operator++() {
+		node_ = node_->next;
+		//如果到达了链表的末尾，则需要跳转到下一个有item的bucket，rehash的时候还要继续遍历新表
+		if (node_ == shm_nullptr) {
+			*this = container_->first_from(table_, bucket_index_ + 1);
+		}
+		return *this;
+	}
+
+	HashIterator operator++(int) {
+		auto res = *this;
+		++*this;
+		return res;
+	}
+
+	Value& operator*() {
+		return node_->value;
+	}
+	Value* operator->() {
+		return &(operator*());
+	}
+
+	bool operator==(const HashIterator& rhs) const {
+		return node_ == rhs.node_ && container_ == rhs.container_;
+	}
+
+	bool operator!=(const HashIterator& rhs) const {
+		return !(*this == rhs);
+	}
+
+public:
+	shm_pointer<Table> container_;
+	int table_;
+	size_t bucket_index_;
+	node_pointer node_;
+};
+
+// 拉链法的哈希表，shm_hash和shm_unordered_map的公共实现，KeyOfValue从元素中取出key
+// 扩容参考redis的渐进式rehash：
+// 扩容的时候新旧两张表同时存在，之后每次insert/find/erase(key)顺带迁移一个bucket，
+// 也可以在空闲的时候调用rehash_step主动迁移，这样就不会因为一次搬迁整张表而卡顿
+// rehash期间insert/find/erase(key)会移动元素，迭代器可能失效；erase(iterator)不迁移，可以边遍历边删除
+// 元素存放在独立的节点中，rehash不会移动元素本身，元素的引用一直有效
+template <class Key, class Value, class KeyOfValue, class Hash, class KeyEqual>
+class shm_hashtable {
+	typedef shm_hashtable<Key, Value, KeyOfValue, Hash, KeyEqual> this_type;
+	static constexpr bool kCacheHash = !std::is_arithmetic<Key>::value;
+
+protected:
+	typedef HashNode<Value, kCacheHash> node_type;
+	typedef shm_pointer<node_type> node_pointer;
+
+	struct HashTable {
+		shm_pointer<node_pointer> buckets = shm_nullptr;
+		size_t size = 0;
+		size_t used = 0;
+	};
+
+public:
+	typedef size_t size_type;
+	typedef Key key_type;
+	typedef Value value_type;
+	typedef HashIterator<this_type, node_type> iterator;
+	friend iterator;
+
+	shm_hashtable(size_t bucket_count = 1) {
+		init_table(m_tables[0], next_prime(bucket_count));
+	}
+
+	shm_hashtable(const shm_hashtable& r) {
+		init_table(m_tables[0], next_prime(r.size()));
+		m_max_load_factor = r.m_max_load_factor;
+		r.for_each([this](const value_type& value) {
+			insert(value);
+		});
+	}
+
+	// 移动时只交换两张表，对方变成没有bucket的空表，下次插入时再分配
+	shm_hashtable(shm_hashtable&& r) noexcept {
+		swap(r);
+	}
+
+	shm_hashtable& operator=(const shm_hashtable& r) {
+		if (this != &r) {
+			shm_hashtable temp(r);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	shm_hashtable& operator=(shm_hashtable&& r) noexcept {
+		if (this != &r) {
+			shm_hashtable temp(std::move(r));
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~shm_hashtable() {
+		clear();
+		free_table(m_tables[0]);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	size_t size() const {
+		return m_tables[0].used + m_tables[1].used;
+	}
+
+	size_type bucket_count() const {
+		return m_tables[0].size + m_tables[1].size;
+	}
+
+	size_type bucket_size(size_type i) const {
+		const auto& t = i < m_tables[0].size ? m_tables[0] : m_tables[1];
+		i = i < m_tables[0].size ? i : i - m_tables[0].size;
+
+		size_type n = 0;
+		for (auto node = t.buckets[i]; node != shm_nullptr; node = node->next) {
+			++n;
+		}
+		return n;
+	}
+
+	size_type bucket(const key_type& key) const {
+		return m_tables[0].size == 0 ? 0 : Hash()(key) % m_tables[0].size;
+	}
+
+	float load_factor() const {
+		return (float)size() / (float)bucket_count();
+	}
+
+	float max_load_factor() const {
+		return m_max_load_factor;
+	}
+
+	void max_load_factor(float z) {
+		m_max_load_factor = z;
+	}
+
+	// 是否正在渐进式rehash
+	bool is_rehashing() const {
+		return m_rehash_index >= 0;
+	}
+
+	// 迁移最多n个非空的bucket，返回之后是否还在rehash
+	// 为了控制单次耗时，最多只跳过n*10个空的bucket
+	bool rehash_step(size_t n) {
+		if (!is_rehashing())
+			return false;
+
+		auto& from = m_tables[0];
+		auto& to = m_tables[1];
+		size_t empty_visits = n * 10;
+		while (n-- > 0 && from.used > 0) {
+			while (from.buckets[m_rehash_index] == shm_nullptr) {
+				++m_rehash_index;
+				if (--empty_visits == 0)
+					return true;
+			}
+
+			auto node = from.buckets[m_rehash_index];
+			while (node != shm_nullptr) {
+				auto next = node->next;
+				auto& head = to.buckets[node_hash(node) % to.size];
+				node->next = head;
+				head = node;
+				--from.used;
+				++to.used;
+				node = next;
+			}
+			from.buckets[m_rehash_index] = shm_nullptr;
+			++m_rehash_index;
+		}
+
+		if (from.used == 0) {
+			free_table(from);
+			from = to;
+			to = HashTable();
+			m_rehash_index = -1;
+			return false;
+		}
+		return true;
+	}
+
+	// 立即把容量调整到至少n个bucket，会一次性完成搬迁
+	void rehash(size_type n) {
+		while (rehash_step(100)) {
+		}
+
+		if (n <= m_tables[0].size)
+			return;
+
+		start_rehash(next_prime(n));
+		while (rehash_step(100)) {
+		}
+	}
+
+	iterator begin() {
+		return first_from(0, 0);
+	}
+
+	iterator end() {
+		return iterator(self(), 0, 0, shm_nullptr);
+	}
+
+	iterator find(const key_type& key) {
+		return find_impl(key);
+	}
+
+	// Hash和KeyEqual都是透明的时候，可以直接用Slice之类的类型查找，不会构造key
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	iterator find(const K& key) {
+		return find_impl(key);
+	}
+
+	size_type count(const key_type& key) {
+		return find(key) == end() ? 0 : 1;
+	}
+
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	size_type count(const K& key) {
+		return find(key) == end() ? 0 : 1;
+	}
+
+	bool contains(const key_type& key) {
+		return find(key) != end();
+	}
+
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	bool contains(const K& key) {
+		return find(key) != end();
+	}
+
+	std::pair<iterator, bool> insert(const value_type& val) {
+		return emplace_unique(KeyOfValue()(val), val);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& val) {
+		return emplace_unique(KeyOfValue()(val), std::move(val));
+	}
+
+	// 先构造节点才能拿到key，key已经存在的时候会释放掉这个节点
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		rehash_step(1);
+
+		auto node = g_alloc->New<node_type>(node_pointer(shm_nullptr), 0, std::forward<P>(params)...);
+		const auto& key = KeyOfValue()(node->value);
+		const size_t hash = Hash()(key);
+		int table = 0;
+		size_t index = 0;
+		auto exist = find_node(key, hash, table, index);
+		if (exist != shm_nullptr) {
+			g_alloc->Delete(node);
+			return std::pair<iterator, bool>(iterator(self(), table, index, exist), false);
+		}
+
+		if constexpr (kCacheHash) {
+			node->hash = hash;
+		}
+		expand_if_needed();
+		return std::pair<iterator, bool>(link(node, hash), true);
+	}
+
+	iterator erase(iterator position) {
+		auto t = position++;
+		unlink(t.table_, t.bucket_index_, t.node_);
+		return position;
+	}
+
+	size_type erase(const key_type& key) {
+		return erase_impl(key);
+	}
+
+	template <class K, class = enable_if_transparent_t<Hash, KeyEqual, K>>
+	size_type erase(const K& key) {
+		return erase_impl(key);
+	}
+
+	void clear() {
+		for (int i = 0; i < 2; i++) {
+			auto& t = m_tables[i];
+			for (size_t index = 0; index < t.size; index++) {
+				auto node = t.buckets[index];
+				while (node != shm_nullptr) {
+					auto next = node->next;
+					g_alloc->Delete(node);
+					node = next;
+				}
+				t.buckets[index] = shm_nullptr;
+			}
+			t.used = 0;
+		}
+
+		free_table(m_tables[1]);
+		m_rehash_index = -1;
+	}
+
+	void swap(shm_hashtable& x) {
+		std::swap(m_tables[0], x.m_tables[0]);
+		std::swap(m_tables[1], x.m_tables[1]);
+		std::swap(m_rehash_index, x.m_rehash_index);
+		std::swap(m_max_load_factor, x.m_max_load_factor);
+	}
+
+protected:
+	// key不存在的时候才用参数构造元素，不会有多余的分配
+	template <typename... P>
+	std::pair<iterator, bool> emplace_unique(const key_type& key, P&&... params) {
+		rehash_step(1);
+
+		const size_t hash = Hash()(key);
+		int table = 0;
+		size_t index = 0;
+		auto node = find_node(key, hash, table, index);
+		if (node != shm_nullptr) {
+			return std::pair<iterator, bool>(iterator(self(), table, index, node), false);
+		}
+
+		expand_if_needed();
+		node = g_alloc->New<node_type>(node_pointer(shm_nullptr), hash, std::forward<P>(params)...);
+		return std::pair<iterator, bool>(link(node, hash), true);
+	}
+
+private:
+	template <class K>
+	iterator find_impl(const K& key) {
+		rehash_step(1);
+
+		int table = 0;
+		size_t index = 0;
+		auto node = find_node(key, Hash()(key), table, index);
+		if (node == shm_nullptr)
+			return end();
+		return iterator(self(), table, index, node);
+	}
+
+	template <class K>
+	size_type erase_impl(const K& key) {
+		rehash_step(1);
+
+		int table = 0;
+		size_t index = 0;
+		auto node = find_node(key, Hash()(key), table, index);
+		if (node == shm_nullptr)
+			return 0;
+
+		unlink(table, index, node);
+		return 1;
+	}
+
+	shm_pointer<this_type> self() {
+		return g_alloc->ToShmPointer<this_type>(this);
+	}
+
+	size_type next_prime(size_type n) const {
+		return m_prime_util.NextPrime(n);
+	}
+
+	static size_t node_hash(node_pointer node) {
+		if constexpr (kCacheHash) {
+			return node->hash;
+		} else {
+			return Hash()(KeyOfValue()(node->value));
+		}
+	}
+
+	static void init_table(HashTable& t, size_t n) {
+		// shm_nullptr是-1，所有字节都是0xff
+		t.buckets = g_alloc->Malloc<node_pointer>(n);
+		memset((void*)t.buckets.Ptr(), 0xff, sizeof(node_pointer) * n);
+		t.size = n;
+		t.used = 0;
+	}
+
+	static void free_table(HashTable& t) {
+		if (t.buckets != shm_nullptr) {
+			g_alloc->Free(t.buckets, t.size);
+		}
+		t = HashTable();
+	}
+
+	// 元素个数超过负载上限的时候开始渐进式rehash，新表的大小约为元素个数的两倍
+	void expand_if_needed() {
+		if (is_rehashing())
+			return;
+
+		if ((float)(size() + 1) > (float)m_tables[0].size * m_max_load_factor) {
+			start_rehash(next_prime((size() + 1) * 2));
+		}
+	}
+
+	void start_rehash(size_t n) {
+		if (n <= m_tables[0].size)
+			return;
+
+		init_table(m_tables[1], n);
+		m_rehash_index = 0;
+	}
+
+	// rehash期间两张表都要查
+	template <class K>
+	node_pointer find_node(const K& key, size_t hash, int& table, size_t& index) const {
+		for (table = 0; table <= (is_rehashing() ? 1 : 0); table++) {
+			const auto& t = m_tables[table];
+			if (t.used == 0)
+				continue;
+
+			index = hash % t.size;
+			for (auto node = t.buckets[index]; node != shm_nullptr; node = node->next) {
+				if constexpr (kCacheHash) {
+					if (node->hash != hash)
+						continue;
+				}
+				if (KeyEqual()(KeyOfValue()(node->value), key))
+					return node;
+			}
+		}
+		return shm_nullptr;
+	}
+
+	// 把新节点挂到bucket的链表头，rehash期间新元素只插入新表
+	iterator link(node_pointer node, size_t hash) {
+		const int table = is_rehashing() ? 1 : 0;
+		auto& t = m_tables[table];
+		const size_t index = hash % t.size;
+		node->next = t.buckets[index];
+		t.buckets[index] = node;
+		++t.used;
+		return iterator(self(), table, index, node);
+	}
+
+	void unlink(int table, size_t index, node_pointer node) {
+		auto& t = m_tables[table];
+		auto* link = &t.buckets[index];
+		while (*link != node) {
+			link = &(*link)->next;
+		}
+		*link = node->next;
+		--t.used;
+		g_alloc->Delete(node);
+	}
+
+	// 从指定位置开始找第一个元素，找不到返回end
+	iterator first_from(int table, size_t index) {
+		// 旧表中rehash_index之前的bucket都已经迁移走了
+		if (table == 0 && is_rehashing() && index < size_t(m_rehash_index)) {
+			index = size_t(m_rehash_index);
+		}
+
+		for (; table <= (is_rehashing() ? 1 : 0); table++, index = 0) {
+			const auto& t = m_tables[table];
+			for (; index < t.size; index++) {
+				if (t.buckets[index] != shm_nullptr)
+					return iterator(self(), table, index, t.buckets[index]);
+			}
+		}
+		return end();
+	}
+
+	template <class F>
+	void for_each(F f) const {
+		for (int i = 0; i < 2; i++) {
+			const auto& t = m_tables[i];
+			for (size_t index = 0; index < t.size; index++) {
+				for (auto node = t.buckets[index]; node != shm_nullptr; node = node->next) {
+					f(node->value);
+				}
+			}
+		}
+	}
+
+private:
+	HashTable m_tables[2];
+	int64_t m_rehash_index = -1;
+	float m_max_load_factor = 1.0f;
+
+	static util::PrimeUtil m_prime_util;
+};
+
+template <class Key, class Value, class KeyOfValue, class Hash, class KeyEqual>
+util::PrimeUtil shm_hashtable<Key, Value, KeyOfValue, Hash, KeyEqual>::m_prime_util;
+
+} // namespace smd
@@ -0,0 +1,210 @@
+﻿#pragma once
+#include <string>
+#include <assert.h>
+
+#include <common/hash.h>
+#include <common/slice.h>
+#include <common/functional.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+#include <container/shm_string.h>
+#include <container/shm_unordered_map.h>
+
+namespace smd {
+
+// 驻留字符串池，内容相同的字符串只保存一份，用引用计数管理生命周期
+// 池本身放在共享内存中，由Env创建，重新attach之后依然有效
+class shm_string_pool {
+public:
+	typedef shm_unordered_map<shm_string, uint32_t> table_type;
+	typedef table_type::value_type entry_type;
+
+	// 取得内容为s的条目，没有的话新建一个，引用计数加1
+	shm_pointer<entry_type> Acquire(const Slice& s) {
+		auto it = m_table.find(s);
+		if (it == m_table.end()) {
+			it = m_table.emplace(std::piecewise_construct, std::forward_as_tuple(s.data(), s.size()),
+				std::forward_as_tuple(uint32_t(1))).first;
+		} else {
+			AddRef(*it);
+		}
+
+		return g_alloc->ToShmPointer<entry_type>(&*it);
+	}
+
+	void AddRef(entry_type& entry) {
+		assert(entry.second < UINT32_MAX);
+		entry.second++;
+	}
+
+	// 引用计数减到0的时候从池中删除
+	void Release(entry_type& entry) {
+		assert(entry.second > 0);
+		if (--entry.second == 0) {
+			m_table.erase(Slice(entry.first.data(), entry.first.size()));
+		}
+	}
+
+	// 不同内容的字符串个数
+	size_t size() const {
+		return m_table.size();
+	}
+
+	// 预留bucket，避免插入时rehash
+	void reserve(size_t n) {
+		m_table.rehash(n);
+	}
+
+private:
+	table_type m_table;
+};
+
+// 指向当前Env中的字符串池
+static shm_string_pool* g_string_pool = nullptr;
+
+// 驻留字符串，对象内部只有一个偏移，内容相同的字符串共享同一块内存
+// 相等比较只需要比较偏移；空字符串不占用池中的条目
+// 适合大量重复的内容，比如道具类型名、帮派名；需要频繁修改的字符串还是用shm_string
+class shm_intern_string {
+public:
+	typedef shm_string_pool::entry_type entry_type;
+
+	shm_intern_string() {}
+
+	explicit shm_intern_string(const Slice& s) {
+		if (!s.empty()) {
+			m_entry = g_string_pool->Acquire(s);
+		}
+	}
+
+	explicit shm_intern_string(const std::string& s)
+		: shm_intern_string(Slice(s)) {}
+
+	explicit shm_intern_string(const char* s)
+		: shm_intern_string(Slice(s)) {}
+
+	shm_intern_string(const shm_intern_string& r)
+		: m_entry(r.m_entry) {
+		if (m_entry != shm_nullptr) {
+			g_string_pool->AddRef(*m_entry);
+		}
+	}
+
+	// 移动时直接拿走对方的条目，不用改引用计数
+	shm_intern_string(shm_intern_string&& r) noexcept
+		: m_entry(r.m_entry) {
+		r.m_entry = shm_nullptr;
+	}
+
+	shm_intern_string& operator=(const shm_intern_string& r) {
+		if (m_entry != r.m_entry) {
+			shm_intern_string(r).swap(*this);
+		}
+		return *this;
+	}
+
+	shm_intern_string& operator=(shm_intern_string&& r) noexcept {
+		if (this != &r) {
+			shm_intern_string(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
+	shm_intern_string& operator=(const Slice& s) {
+		// 先取得新条目再释放旧条目，内容相同的时候不会从池中删除再加回来
+		shm_intern_string(s).swap(*this);
+		return *this;
+	}
+
+	shm_intern_string& operator=(const std::string& s) { return *this = Slice(s); }
+	shm_intern_string& operator=(const char* s) { return *this = Slice(s); }
+
+	~shm_intern_string() {
+		if (m_entry != shm_nullptr) {
+			g_string_pool->Release(*m_entry);
+		}
+	}
+
+	const char* data() const { return m_entry == shm_nullptr ? "" : m_entry->first.data(); }
+	size_t size() const { return m_entry == shm_nullptr ? 0 : m_entry->first.size(); }
+	bool empty() const { return m_entry == shm_nullptr; }
+
+	// 有多少个对象共享这份内容
+	uint32_t ref_count() const { return m_entry == shm_nullptr ? 0 : m_entry->second; }
+
+	Slice ToSlice() const { return Slice(data(), size()); }
+	std::string ToString() const { return std::string(data(), size()); }
+
+	int compare(const shm_intern_string& b) const {
+		return m_entry == b.m_entry ? 0 : int(ToSlice().compare(b.ToSlice()));
+	}
+
+	// 池中内容唯一，偏移相同就是内容相同
+	bool operator==(const shm_intern_string& rhs) const {
+		return m_entry == rhs.m_entry;
+	}
+
+	void swap(shm_intern_string& r) {
+		std::swap(m_entry, r.m_entry);
+	}
+
+private:
+	shm_pointer<entry_type> m_entry;
+};
+
+static_assert(sizeof(shm_intern_string) == 8, "shm_intern_string should be 8 bytes");
+
+inline bool operator!=(const shm_intern_string& x, const shm_intern_string& y) { return !(x == y); }
+inline bool operator<(const shm_intern_string& x, const shm_intern_string& y) { return x.compare(y) < 0; }
+inline bool operator>(const shm_intern_string& x, const shm_intern_string& y) { return x.compare(y) > 0; }
+
+template <>
+inline int64_t compare(const shm_intern_string& x, const shm_intern_string& y) {
+	return x.compare(y);
+}
+
+inline bool operator==(const shm_intern_string& x, const Slice& y) { return x.ToSlice() == y; }
+inline bool operator==(const Slice& x, const shm_intern_string& y) { return y == x; }
+inline bool operator==(const shm_intern_string& x, const std::string& y) { return x == Slice(y); }
+inline bool operator==(const shm_intern_string& x, const char* y) { return x == Slice(y); }
+inline bool operator!=(const shm_intern_string& x, const Slice& y) { return !(x == y); }
+inline bool operator!=(const Slice& x, const shm_intern_string& y) { return !(x == y); }
+inline bool operator!=(const shm_intern_string& x, const std::string& y) { return !(x == y); }
+inline bool operator!=(const shm_intern_string& x, const char* y) { return !(x == y); }
+
+inline int64_t compare(const shm_intern_string& x, const Slice& y) {
+	return x.ToSlice().compare(y);
+}
+
+inline int64_t compare(const Slice& x, const shm_intern_string& y) {
+	return x.compare(y.ToSlice());
+}
+
+} // namespace smd
+
+namespace std {
+template <>
+struct hash<smd::shm_intern_string> {
+	typedef smd::shm_intern_string argument_type;
+	typedef std::size_t result_type;
+	typedef void is_transparent;
+
+	// 按内容哈希，这样也可以直接用Slice查找
+	result_type operator()(argument_type const& s) const {
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+
+	result_type operator()(const smd::Slice& s) const {
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+
+	result_type operator()(const std::string& s) const {
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+
+	result_type operator()(const char* s) const {
+		return smd::util::Hash::Bytes(s, strlen(s));
+	}
+};
+
+} // namespace std
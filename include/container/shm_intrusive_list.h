@@ -0,0 +1,274 @@
+﻿#pragma once
+#include <utility>
+#include <assert.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+// 侵入式链表的链接字段，元素继承它之后就可以挂到shm_intrusive_list上
+// 同一个元素要同时挂在多个链表上时，用不同的Tag各继承一次
+template <class Tag = void>
+struct shm_list_hook {
+	shm_pointer<shm_list_hook> hook_prev;
+	shm_pointer<shm_list_hook> hook_next;
+
+	shm_list_hook() {}
+
+	// 拷贝元素的时候不拷贝链接，新元素不在任何链表中
+	shm_list_hook(const shm_list_hook&) {}
+
+	shm_list_hook& operator=(const shm_list_hook&) {
+		return *this;
+	}
+};
+
+template <class T, class Tag>
+class IntrusiveListIterator {
+public:
+	typedef shm_list_hook<Tag> hook_type;
+
+	shm_pointer<hook_type> p;
+
+public:
+	explicit IntrusiveListIterator(shm_pointer<hook_type> ptr = shm_nullptr)
+		: p(ptr) {}
+
+	IntrusiveListIterator& operator++() {
+		p = p->hook_next;
+		return *this;
+	}
+
+	IntrusiveListIterator operator++(int) {
+		auto res = *this;
+		++*this;
+		return res;
+	}
+
+	IntrusiveListIterator& operator--() {
+		p = p->hook_prev;
+		return *this;
+	}
+
+	IntrusiveListIterator operator--(int) {
+		auto res = *this;
+		--*this;
+		return res;
+	}
+
+	T& operator*() const {
+		return static_cast<T&>(*p.Ptr());
+	}
+
+	T* operator->() const {
+		return static_cast<T*>(p.Ptr());
+	}
+
+	friend bool operator!=(const IntrusiveListIterator& x, const IntrusiveListIterator& y) {
+		return x.p != y.p;
+	}
+
+	friend bool operator==(const IntrusiveListIterator& x, const IntrusiveListIterator& y) {
+		return x.p == y.p;
+	}
+};
+
+// 侵入式双向链表，链接字段在元素自己身上，链表不分配也不释放任何内存
+// 元素必须放在共享内存中并且地址固定，比如g_alloc->New出来的对象、shm_unordered_map中的value
+// shm_map删除时会交换节点中的value，shm_vector等会搬迁元素，这些容器中的元素不能挂在侵入式链表上
+// 链表不拥有元素：析构或者clear只是把元素摘下来，元素要在链表之前一直有效
+// 元素在链表之间移动（比如在线/离线玩家列表）只改几个偏移，size()是O(1)
+template <class T, class Tag = void>
+class shm_intrusive_list {
+public:
+	typedef shm_list_hook<Tag> hook_type;
+	typedef shm_pointer<hook_type> hook_ptr;
+	typedef IntrusiveListIterator<T, Tag> iterator;
+
+	shm_intrusive_list() {}
+
+	// 一个元素通过同一个hook只能在一个链表中，所以不能拷贝
+	shm_intrusive_list(const shm_intrusive_list&) = delete;
+	shm_intrusive_list& operator=(const shm_intrusive_list&) = delete;
+
+	shm_intrusive_list(shm_intrusive_list&& r) noexcept {
+		swap(r);
+	}
+
+	shm_intrusive_list& operator=(shm_intrusive_list&& r) noexcept {
+		if (this != &r) {
+			clear();
+			swap(r);
+		}
+		return *this;
+	}
+
+	~shm_intrusive_list() {
+		clear();
+	}
+
+	T& front() {
+		return *begin();
+	}
+
+	T& back() {
+		return *iterator(m_tail);
+	}
+
+	iterator begin() {
+		return iterator(m_head);
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	// 元素对应的迭代器，元素必须在本链表中
+	static iterator iterator_to(T& value) {
+		return iterator(hook_of(value));
+	}
+
+	void push_front(T& value) {
+		insert(begin(), value);
+	}
+
+	void push_back(T& value) {
+		insert(end(), value);
+	}
+
+	// 把value挂到pos之前，value不能已经在某个链表中
+	iterator insert(iterator pos, T& value) {
+		auto h = hook_of(value);
+		link_before(pos.p, h);
+		++m_size;
+		return iterator(h);
+	}
+
+	void pop_front() {
+		erase(begin());
+	}
+
+	void pop_back() {
+		erase(iterator(m_tail));
+	}
+
+	// 只是摘下元素，返回下一个元素
+	iterator erase(iterator pos) {
+		auto next = pos.p->hook_next;
+		unlink(pos.p);
+		--m_size;
+		return iterator(next);
+	}
+
+	void remove(T& value) {
+		erase(iterator_to(value));
+	}
+
+	void clear() {
+		for (auto h = m_head; h != shm_nullptr;) {
+			auto next = h->hook_next;
+			h->hook_prev = h->hook_next = shm_nullptr;
+			h = next;
+		}
+		m_head = m_tail = shm_nullptr;
+		m_size = 0;
+	}
+
+	// 把x中的value移到本链表的pos之前，x可以就是本链表
+	void splice(iterator pos, shm_intrusive_list& x, T& value) {
+		auto h = hook_of(value);
+		if (h == pos.p)
+			return;
+
+		x.unlink(h);
+		--x.m_size;
+		link_before(pos.p, h);
+		++m_size;
+	}
+
+	// 把x的所有元素接到pos之前
+	void splice(iterator pos, shm_intrusive_list& x) {
+		if (&x == this || x.empty())
+			return;
+
+		auto first = x.m_head;
+		auto last = x.m_tail;
+		auto prev = pos.p != shm_nullptr ? pos.p->hook_prev : m_tail;
+		first->hook_prev = prev;
+		last->hook_next = pos.p;
+		if (prev != shm_nullptr) {
+			prev->hook_next = first;
+		} else {
+			m_head = first;
+		}
+		if (pos.p != shm_nullptr) {
+			pos.p->hook_prev = last;
+		} else {
+			m_tail = last;
+		}
+
+		m_size += x.m_size;
+		x.m_head = x.m_tail = shm_nullptr;
+		x.m_size = 0;
+	}
+
+	void swap(shm_intrusive_list& r) {
+		std::swap(m_head, r.m_head);
+		std::swap(m_tail, r.m_tail);
+		std::swap(m_size, r.m_size);
+	}
+
+private:
+	static hook_ptr hook_of(T& value) {
+		return g_alloc->ToShmPointer<hook_type>(static_cast<hook_type*>(&value));
+	}
+
+	// pos为空时挂到末尾
+	void link_before(hook_ptr pos, hook_ptr h) {
+		assert(h->hook_prev == shm_nullptr && h->hook_next == shm_nullptr && h != m_head);
+		auto prev = pos != shm_nullptr ? pos->hook_prev : m_tail;
+		h->hook_prev = prev;
+		h->hook_next = pos;
+		if (prev != shm_nullptr) {
+			prev->hook_next = h;
+		} else {
+			m_head = h;
+		}
+		if (pos != shm_nullptr) {
+			pos->hook_prev = h;
+		} else {
+			m_tail = h;
+		}
+	}
+
+	void unlink(hook_ptr h) {
+		auto prev = h->hook_prev;
+		auto next = h->hook_next;
+		if (prev != shm_nullptr) {
+			prev->hook_next = next;
+		} else {
+			m_head = next;
+		}
+		if (next != shm_nullptr) {
+			next->hook_prev = prev;
+		} else {
+			m_tail = prev;
+		}
+		h->hook_prev = h->hook_next = shm_nullptr;
+	}
+
+private:
+	hook_ptr m_head = shm_nullptr;
+	hook_ptr m_tail = shm_nullptr;
+	size_t m_size = 0;
+};
+
+} // namespace smd
@@ -1,30 +1,26 @@
 ﻿#pragma once
 #include <container/shm_pointer.h>
+#include <container/shm_node_pool.h>
 
 namespace smd {
 
-template <class T>
-class shm_list;
-
 template <class T>
 struct ListNode {
-	shm_pointer<shm_list<T>> container;
 	T data;
 	shm_pointer<ListNode> prev;
 	shm_pointer<ListNode> next;
 
-	ListNode(shm_pointer<shm_list<T>> c, const T& d, shm_pointer<ListNode> p, shm_pointer<ListNode> n)
-		: container(c)
-		, data(d)
-		, prev(p)
-		, next(n) {}
+	template <typename... P>
+	ListNode(P&&... params)
+		: data(std::forward<P>(params)...) {}
 
 	bool operator==(const ListNode& n) {
-		return data == n.data && prev == n.prev && next == n.next && &container == &n.container;
+		return data == n.data && prev == n.prev && next == n.next;
 	}
 };
 
 // the class of list iterator
+// 链表两端都是空指针，end()就是空指针，不能从end()往前走
 template <class T>
 class ListIterator {
 public:
@@ -84,26 +80,29 @@ public:
 	}
 };
 
+// 双向链表，节点从链表自己的节点池中分配
+// 没有哨兵节点，空链表不占用共享内存；元素个数单独记录，size()是O(1)
+// 节点属于各自链表的节点池，只能把另一个链表整个接过来，单个元素的splice只能在同一个链表内调整位置
+// 需要让元素在多个链表之间来回移动的，用shm_intrusive_list
 template <class T>
 class shm_list {
 public:
 	typedef shm_pointer<ListNode<T>> nodePtr;
 	typedef ListIterator<T> iterator;
 
-	shm_list()
-		: m_head(NewNode(T()))
-		, m_tail(m_head) {}
-
-	shm_list(const shm_list<T>& r)
-		: m_head(NewNode(*((shm_list<T>&)r).end()))
-		, m_tail(m_head) {
-		shm_list<T>* r1 = (shm_list<T>*)&r;
-		for (iterator it = r1->begin(); it != r1->end(); ++it) {
-			auto& element = *it;
-			push_back(element);
+	shm_list() {}
+
+	shm_list(const shm_list<T>& r) {
+		for (auto node = r.m_head; node != shm_nullptr; node = node->next) {
+			push_back(node->data);
 		}
 	}
 
+	// 移动时交换头尾节点和节点池，不分配也不拷贝元素
+	shm_list(shm_list<T>&& r) noexcept {
+		swap(r);
+	}
+
 	shm_list& operator=(const shm_list& l) {
 		if (this != &l) {
 			shm_list(l).swap(*this);
@@ -111,136 +110,210 @@ public:
 		return *this;
 	}
 
+	shm_list& operator=(shm_list&& l) noexcept {
+		if (this != &l) {
+			clear();
+			swap(l);
+		}
+		return *this;
+	}
+
 	~shm_list() {
 		clear();
-		g_alloc->Delete(m_tail.p);
-
-		m_head = shm_nullptr;
-		m_tail = shm_nullptr;
 	}
 
 	T& front() {
-		return (m_head.p->data);
+		return m_head->data;
 	}
 
 	T& back() {
-		return (m_tail.p->prev->data);
+		return m_tail->data;
 	}
 
 	void push_front(const T& val) {
-		auto node = NewNode(val);
-		m_head.p->prev = node;
-		node->next = m_head.p;
-		m_head.p = node;
+		emplace_front(val);
+	}
+
+	void push_front(T&& val) {
+		emplace_front(std::move(val));
+	}
+
+	template <typename... P>
+	T& emplace_front(P&&... params) {
+		return *emplace(begin(), std::forward<P>(params)...);
 	}
 
 	void pop_front() {
-		auto node = m_head.p;
-		m_head.p = node->next;
-		m_head.p->prev = shm_nullptr;
-		DeleteNode(node);
+		erase(begin());
 	}
 
 	void push_back(const T& val) {
-		auto node = NewNode(val);
-		if (m_tail.p->prev != shm_nullptr) {
-			// 已有元素
-			auto prev = m_tail.p->prev;
-			prev->next = node;
-			node->next = m_tail.p;
-
-			m_tail.p->prev = node;
-			node->prev = prev;
-		} else {
-			// 空链表
-			node->next = m_tail.p;
-			node->prev = shm_nullptr;
+		emplace_back(val);
+	}
 
-			m_tail.p->prev = node;
-			m_head.p = node;
-		}
+	void push_back(T&& val) {
+		emplace_back(std::move(val));
+	}
+
+	template <typename... P>
+	T& emplace_back(P&&... params) {
+		return *emplace(end(), std::forward<P>(params)...);
 	}
 
 	void pop_back() {
-		auto node = m_tail.p->prev;
-		if (node->prev != shm_nullptr) {
-			auto& prev = node->prev;
-			prev->next = node->next;
+		erase(iterator(m_tail));
+	}
 
-			m_tail.p->prev = node->prev;
-		} else {
-			m_head.p = m_tail.p;
-			m_head.p->next = shm_nullptr;
-			m_head.p->prev = shm_nullptr;
-		}
+	// 在pos之前插入，返回指向新元素的迭代器
+	template <typename... P>
+	iterator emplace(iterator pos, P&&... params) {
+		auto node = NewNode(std::forward<P>(params)...);
+		link_before(pos.p, node, node);
+		++m_size;
+		return iterator(node);
+	}
 
-		DeleteNode(node);
+	iterator insert(iterator pos, const T& val) {
+		return emplace(pos, val);
+	}
+
+	iterator insert(iterator pos, T&& val) {
+		return emplace(pos, std::move(val));
 	}
 
 	iterator begin() {
-		return m_head;
+		return iterator(m_head);
 	}
 
 	iterator end() {
-		return m_tail;
+		return iterator();
 	}
 
 	bool empty() const {
-		return m_head == m_tail;
+		return m_size == 0;
 	}
 
 	size_t size() const {
-		size_t length = 0;
-		for (auto h = m_head; h != m_tail; ++h)
-			++length;
-		return length;
+		return m_size;
 	}
 
+	// 逐个析构之后整块归还节点池
 	void clear() {
-		erase(begin(), end());
+		for (auto node = m_head; node != shm_nullptr;) {
+			auto next = node->next;
+			m_pool.Destroy(node);
+			node = next;
+		}
+		m_pool.release();
+		m_head = m_tail = shm_nullptr;
+		m_size = 0;
 	}
 
+	// 返回被删除元素的下一个
 	iterator erase(iterator position) {
-		if (position == m_head) {
-			pop_front();
-			return m_head;
-		} else {
-			auto prev = position.p->prev;
-			prev->next = position.p->next;
-			position.p->next->prev = prev;
-			DeleteNode(position.p);
-			return iterator(prev->next);
-		}
+		auto node = position.p;
+		auto next = node->next;
+		unlink(node, node);
+		--m_size;
+		DeleteNode(node);
+		return iterator(next);
 	}
 
 	iterator erase(iterator first, iterator last) {
-		iterator res;
-		for (; first != last;) {
-			auto temp = first++;
-			res = erase(temp);
+		while (first != last) {
+			first = erase(first);
 		}
-		return res;
+		return last;
+	}
+
+	// 把x的所有元素接到pos之前，x的节点池也一起合并过来，不分配也不拷贝元素
+	void splice(iterator pos, shm_list& x) {
+		if (&x == this || x.empty())
+			return;
+
+		link_before(pos.p, x.m_head, x.m_tail);
+		m_size += x.m_size;
+		m_pool.merge(x.m_pool);
+		x.m_head = x.m_tail = shm_nullptr;
+		x.m_size = 0;
+	}
+
+	// 把本链表中的it移到pos之前，比如LRU把刚访问的元素移到最前面
+	// pos就是it或者it的下一个时位置不变
+	void splice(iterator pos, iterator it) {
+		iterator next(it.p->next);
+		if (pos == it || pos == next)
+			return;
+
+		splice(pos, it, next);
+	}
+
+	// 把本链表中的[first, last)移到pos之前，pos不能在(first, last)中，pos等于first或last时位置不变
+	void splice(iterator pos, iterator first, iterator last) {
+		if (first == last || pos == first || pos == last)
+			return;
+
+		auto tail = last.p != shm_nullptr ? last.p->prev : m_tail;
+		unlink(first.p, tail);
+		link_before(pos.p, first.p, tail);
 	}
 
 private:
-	nodePtr NewNode(const T& val) {
-		auto p = g_alloc->New<ListNode<T>>(g_alloc->ToShmPointer<shm_list<T>>(this), val, shm_nullptr, shm_nullptr);
-		return p;
+	template <typename... P>
+	nodePtr NewNode(P&&... params) {
+		return m_pool.New(std::forward<P>(params)...);
 	}
 
 	void DeleteNode(nodePtr p) {
-		p->prev = p->next = shm_nullptr;
-		g_alloc->Delete(p);
+		m_pool.Delete(p);
+	}
+
+	// 把first到last这一段挂到pos之前，pos为空时挂到末尾
+	void link_before(nodePtr pos, nodePtr first, nodePtr last) {
+		auto prev = pos != shm_nullptr ? pos->prev : m_tail;
+		first->prev = prev;
+		last->next = pos;
+		if (prev != shm_nullptr) {
+			prev->next = first;
+		} else {
+			m_head = first;
+		}
+		if (pos != shm_nullptr) {
+			pos->prev = last;
+		} else {
+			m_tail = last;
+		}
+	}
+
+	// 把first到last这一段从链表中摘下来
+	void unlink(nodePtr first, nodePtr last) {
+		auto prev = first->prev;
+		auto next = last->next;
+		if (prev != shm_nullptr) {
+			prev->next = next;
+		} else {
+			m_head = next;
+		}
+		if (next != shm_nullptr) {
+			next->prev = prev;
+		} else {
+			m_tail = prev;
+		}
+		first->prev = last->next = shm_nullptr;
 	}
 
 	void swap(shm_list<T>& x) {
 		std::swap(m_head, x.m_head);
 		std::swap(m_tail, x.m_tail);
+		std::swap(m_size, x.m_size);
+		m_pool.swap(x.m_pool);
 	}
 
 private:
-	iterator m_head;
-	iterator m_tail;
+	shm_node_pool<ListNode<T>> m_pool;
+	nodePtr m_head = shm_nullptr;
+	nodePtr m_tail = shm_nullptr;
+	size_t m_size = 0;
 };
 
 } // namespace smd
@@ -1,5 +1,10 @@
 ﻿#pragma once
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <common/functional.h>
 #include <container/shm_pointer.h>
+#include <container/shm_node_pool.h>
 
 namespace smd {
 
@@ -8,17 +13,38 @@ enum RBTreeNodeColor : bool {
 	RBTREE_NODE_BLACK = true,
 };
 
+// 支持前缀的key（比如shm_string）在节点中缓存前缀，查找时大多数节点不用访问key单独分配的空间
+template <class Key, bool = key_prefix<Key>::enabled>
+struct RBTreeKeyPrefix {
+	void set_prefix(const Key&) {}
+};
+
+template <class Key>
+struct RBTreeKeyPrefix<Key, true> {
+	uint64_t prefix;
+
+	void set_prefix(const Key& k) {
+		prefix = key_prefix<Key>::get(k);
+	}
+};
+
 template <typename Value>
-struct RBTreeNode {
+struct RBTreeNode : RBTreeKeyPrefix<typename Value::first_type> {
 	RBTreeNodeColor color;
+	// 以本节点为根的子树中的节点个数，放在color后面的填充字节里，不增加节点大小
+	uint32_t count;
 	shm_pointer<RBTreeNode> parent;
 	shm_pointer<RBTreeNode> left_child;
 	shm_pointer<RBTreeNode> right_child;
 	Value value;
 
-	RBTreeNode(const Value& val)
+	template <typename... P>
+	RBTreeNode(P&&... params)
 		: color(RBTREE_NODE_RED)
-		, value(val) {}
+		, count(1)
+		, value(std::forward<P>(params)...) {
+		this->set_prefix(value.first);
+	}
 };
 
 template <typename value_type>
@@ -69,9 +95,10 @@ static shm_pointer<RBTreeNode<value_type>> rbtree_next(shm_pointer<RBTreeNode<va
 	return n;
 }
 
-template <typename T, typename Pointer, typename Reference>
+// Reverse为true时是反向迭代器，从最大的节点开始往前走
+template <typename T, typename Pointer, typename Reference, bool Reverse = false>
 struct rbtree_iterator {
-	typedef rbtree_iterator<T, Pointer, Reference> this_type;
+	typedef rbtree_iterator<T, Pointer, Reference, Reverse> this_type;
 
 	shm_pointer<RBTreeNode<T>> _ptr;
 
@@ -90,32 +117,32 @@ struct rbtree_iterator {
 	}
 
 	rbtree_iterator& operator++() {
-		_ptr = rbtree_next<T>(_ptr);
+		_ptr = Reverse ? rbtree_prev<T>(_ptr) : rbtree_next<T>(_ptr);
 		return *this;
 	}
 
 	rbtree_iterator operator++(int) {
 		this_type tmp(*this);
-		_ptr = rbtree_next<T>(_ptr);
+		++*this;
 		return tmp;
 	}
 
 	rbtree_iterator& operator--() {
-		_ptr = rbtree_prev<T>(_ptr);
+		_ptr = Reverse ? rbtree_next<T>(_ptr) : rbtree_prev<T>(_ptr);
 		return *this;
 	}
 
 	rbtree_iterator operator--(int) {
 		this_type tmp(*this);
-		_ptr = rbtree_prev<T>(_ptr);
+		--*this;
 		return tmp;
 	}
 
-	bool operator==(const this_type& x) {
+	bool operator==(const this_type& x) const {
 		return _ptr == x._ptr;
 	}
 
-	bool operator!=(const this_type& x) {
+	bool operator!=(const this_type& x) const {
 		return _ptr != x._ptr;
 	}
 };
@@ -128,6 +155,8 @@ public:
 	typedef shm_pointer<RBTreeNode<value_type>> rbtree_node_ptr;
 	typedef rbtree_iterator<value_type, value_type*, value_type&> iterator;
 	typedef rbtree_iterator<value_type, const value_type*, const value_type&> const_iterator;
+	typedef rbtree_iterator<value_type, value_type*, value_type&, true> reverse_iterator;
+	typedef rbtree_iterator<value_type, const value_type*, const value_type&, true> const_reverse_iterator;
 
 	shm_map()
 		: root_(shm_nullptr)
@@ -141,6 +170,13 @@ public:
 		}
 	}
 
+	// 移动时只交换根节点的偏移，对方变成空树
+	shm_map(this_type&& r) noexcept
+		: root_(shm_nullptr)
+		, size_(0) {
+		swap(r);
+	}
+
 	this_type& operator=(const this_type& r) {
 		if (this != &r) {
 			shm_map(r).swap(*this);
@@ -148,9 +184,17 @@ public:
 		return *this;
 	}
 
+	this_type& operator=(this_type&& r) noexcept {
+		if (this != &r) {
+			shm_map(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
 	void swap(this_type& r) {
 		std::swap(root_, r.root_);
 		std::swap(size_, r.size_);
+		pool_.swap(r.pool_);
 	}
 
 	~shm_map() {
@@ -173,59 +217,85 @@ public:
 		return const_iterator(shm_nullptr);
 	}
 
+	// 没有头节点，end()不能往回走，反向遍历用rbegin/rend
+	reverse_iterator rbegin() {
+		return reverse_iterator(rbtree_last());
+	}
+
+	const_reverse_iterator rbegin() const {
+		return const_reverse_iterator(rbtree_last());
+	}
+
+	reverse_iterator rend() {
+		return reverse_iterator(shm_nullptr);
+	}
+
+	const_reverse_iterator rend() const {
+		return const_reverse_iterator(shm_nullptr);
+	}
+
 	size_t size() const {
 		return size_;
 	}
 
-	bool empty() {
+	bool empty() const {
 		return size_ == 0;
 	}
 
-	rbtree_node_ptr insert(const value_type& value) {
-		auto node = createNode(value);
+	// 先查找，key不存在的时候才分配节点
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return emplace_unique(value.first, value);
+	}
 
-		auto n = root_;
-		if (n != shm_nullptr) {
-			for (;;) {
-				auto cmp = compare(key(node), n);
-
-				if (cmp < 0) {
-					if (n->left_child != shm_nullptr) {
-						n = n->left_child;
-					} else {
-						n->left_child = node;
-
-						break;
-					}
-				} else if (cmp > 0) {
-					if (n->right_child != shm_nullptr) {
-						n = n->right_child;
-					} else {
-						n->right_child = node;
-
-						break;
-					}
-				} else {
-					//节点重复，插入失败
-					deleteNode(node);
-					return shm_nullptr;
-				}
-			}
-		}
+	// 查找用的是value.first，key不存在时才把value移动到节点中
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return emplace_unique(value.first, std::move(value));
+	}
 
-		node->parent = n;
-		node->left_child = shm_nullptr;
-		node->right_child = shm_nullptr;
-		node->color = RBTREE_NODE_RED;
+	// key不存在的时候才用参数在节点中直接构造value，已经存在的时候不分配也不拷贝
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& key, P&&... params) {
+		return emplace_unique(key, std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<P>(params)...));
+	}
 
-		if (n == shm_nullptr) {
-			root_ = node;
+	template <class V>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+		auto res = try_emplace(key, std::forward<V>(value));
+		if (!res.second) {
+			res.first->second = std::forward<V>(value);
 		}
+		return res;
+	}
 
-		repair_after_insert(node);
+	// 参数中不能直接取出key，只能先构造节点，key已经存在时会多一次分配，能用try_emplace的尽量用try_emplace
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		auto node = pool_.New(std::forward<P>(params)...);
+		auto pos = rbtree_insert_pos(key(node));
+		if (pos.second == 0) {
+			deleteNode(node);
+			return std::make_pair(iterator(pos.first), false);
+		}
 
-		++size_;
-		return node;
+		rbtree_link(node, pos.first, pos.second);
+		return std::make_pair(iterator(node), true);
+	}
+
+	Value& operator[](const Key& key) {
+		return try_emplace(key).first->second;
+	}
+
+	Value& at(const Key& key) {
+		auto it = find(key);
+		assert(it != end());
+		return it->second;
+	}
+
+	const Value& at(const Key& key) const {
+		auto it = find(key);
+		assert(it != end());
+		return it->second;
 	}
 
 	iterator find(const Key& key) {
@@ -236,28 +306,238 @@ public:
 		return const_iterator(rbtree_lookup_key(key));
 	}
 
+	// 只要能和Key比较大小就可以直接查找，比如用Slice查找shm_string，不用构造key
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	iterator find(const K& key) {
+		return iterator(rbtree_lookup_key(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	const_iterator find(const K& key) const {
+		return const_iterator(rbtree_lookup_key(key));
+	}
+
+	// 返回被删除元素的下一个元素
 	iterator erase(iterator it) {
 		return iterator(rbtree_remove(it._ptr));
 	}
 
+	iterator erase(iterator first, iterator last) {
+		while (first != last) {
+			first = erase(first);
+		}
+		return last;
+	}
+
+	size_t erase(const Key& key) {
+		auto n = rbtree_lookup_key(key);
+		if (n == shm_nullptr)
+			return 0;
+
+		rbtree_remove(n);
+		return 1;
+	}
+
+	// 第一个不小于key的元素
+	iterator lower_bound(const Key& key) {
+		return iterator(rbtree_lower_bound(key));
+	}
+
+	const_iterator lower_bound(const Key& key) const {
+		return const_iterator(rbtree_lower_bound(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	iterator lower_bound(const K& key) {
+		return iterator(rbtree_lower_bound(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	const_iterator lower_bound(const K& key) const {
+		return const_iterator(rbtree_lower_bound(key));
+	}
+
+	// 第一个大于key的元素
+	iterator upper_bound(const Key& key) {
+		return iterator(rbtree_upper_bound(key));
+	}
+
+	const_iterator upper_bound(const Key& key) const {
+		return const_iterator(rbtree_upper_bound(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	iterator upper_bound(const K& key) {
+		return iterator(rbtree_upper_bound(key));
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	const_iterator upper_bound(const K& key) const {
+		return const_iterator(rbtree_upper_bound(key));
+	}
+
+	// key唯一，范围内最多只有一个元素
+	std::pair<iterator, iterator> equal_range(const Key& key) {
+		return equal_range_impl<iterator>(key);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+		return equal_range_impl<const_iterator>(key);
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	std::pair<iterator, iterator> equal_range(const K& key) {
+		return equal_range_impl<iterator>(key);
+	}
+
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+		return equal_range_impl<const_iterator>(key);
+	}
+
+	// 节点逐个析构之后，整块还给g_alloc
 	void clear() {
 		recurErase(root_);
+		pool_.release();
 		root_ = shm_nullptr;
 		size_ = 0;
 	}
 
+	// 用按key严格递增的[first, last)重建整棵树，O(n)，比逐个插入少了查找和旋转
+	// 节点按顺序从节点池中连续切出来，中序遍历基本上是顺序访问内存
+	template <class InputIt>
+	void build_sorted(InputIt first, InputIt last) {
+		clear();
+
+		std::vector<rbtree_node_ptr> nodes;
+		for (; first != last; ++first) {
+			nodes.push_back(createNode(*first));
+			assert(nodes.size() == 1 || compare(key(nodes.back()), nodes[nodes.size() - 2]) > 0);
+		}
+		link_sorted(nodes);
+	}
+
+	// 无序的输入先排序再构建，key重复的只保留第一个，和逐个insert的结果相同
+	template <class InputIt>
+	void build(InputIt first, InputIt last) {
+		std::vector<const value_type*> sorted;
+		for (; first != last; ++first) {
+			sorted.push_back(&*first);
+		}
+
+		auto less = [](const value_type* x, const value_type* y) { return smd::compare(x->first, y->first) < 0; };
+		auto equal = [](const value_type* x, const value_type* y) { return smd::compare(x->first, y->first) == 0; };
+		std::stable_sort(sorted.begin(), sorted.end(), less);
+		sorted.erase(std::unique(sorted.begin(), sorted.end(), equal), sorted.end());
+
+		clear();
+
+		std::vector<rbtree_node_ptr> nodes;
+		nodes.reserve(sorted.size());
+		for (auto p : sorted) {
+			nodes.push_back(createNode(*p));
+		}
+		link_sorted(nodes);
+	}
+
+	// 比key小的元素个数，O(log n)
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	size_t rank(const K& key) const {
+		size_t r = 0;
+		const search_key<K> k(key);
+		auto n = root_;
+		while (n != shm_nullptr) {
+			if (compare(k, n) <= 0) {
+				n = n->left_child;
+			} else {
+				r += count(n->left_child) + 1;
+				n = n->right_child;
+			}
+		}
+		return r;
+	}
+
+	// 迭代器指向的元素前面有多少个元素，end()返回size()
+	size_t index_of(iterator it) const {
+		return rbtree_index(it._ptr);
+	}
+
+	size_t index_of(const_iterator it) const {
+		return rbtree_index(it._ptr);
+	}
+
+	// 第k小的元素（从0开始），超出范围返回end()，O(log n)
+	iterator select(size_t k) {
+		return iterator(rbtree_select(k));
+	}
+
+	const_iterator select(size_t k) const {
+		return const_iterator(rbtree_select(k));
+	}
+
+	// key在[low, high)范围内的元素个数
+	template <class K, class = decltype(smd::compare(std::declval<const K&>(), std::declval<const Key&>()))>
+	size_t count_range(const K& low, const K& high) const {
+		auto l = rank(low);
+		auto h = rank(high);
+		return h > l ? h - l : 0;
+	}
+
 protected:
 	rbtree_node_ptr root_;
 	size_t size_;
-	static int64_t compare(const Key& k, rbtree_node_ptr node) {
+	shm_node_pool<RBTreeNode<value_type>> pool_;
+	template <class K>
+	static int64_t compare(const K& k, rbtree_node_ptr node) {
 		return smd::compare(k, key(node));
 	}
 
+	static constexpr bool kKeyPrefix = key_prefix<Key>::enabled;
+
+	// 查找的时候先算好要找的key的前缀，每个节点先比较前缀，相同时才比较完整的key
+	template <class K>
+	struct search_key {
+		const K& key;
+		uint64_t prefix;
+
+		explicit search_key(const K& k)
+			: key(k)
+			, prefix(0) {
+			if constexpr (kKeyPrefix) {
+				prefix = key_prefix<Key>::get(k);
+			}
+		}
+	};
+
+	template <class K>
+	static int64_t compare(const search_key<K>& k, rbtree_node_ptr node) {
+		if constexpr (kKeyPrefix) {
+			if (k.prefix != node->prefix)
+				return k.prefix < node->prefix ? -1 : 1;
+		}
+		return smd::compare(k.key, key(node));
+	}
+
 protected:
 	static RBTreeNodeColor color(rbtree_node_ptr node) {
 		return node != shm_nullptr ? node->color : RBTREE_NODE_BLACK;
 	}
 
+	static size_t count(rbtree_node_ptr node) {
+		return node != shm_nullptr ? node->count : 0;
+	}
+
+	static void recount(rbtree_node_ptr node) {
+		node->count = uint32_t(count(node->left_child) + count(node->right_child) + 1);
+	}
+
+	// 从node开始一直到根节点，子树的计数都加上delta
+	static void update_count(rbtree_node_ptr node, int delta) {
+		for (; node != shm_nullptr; node = node->parent) {
+			node->count = uint32_t(int64_t(node->count) + delta);
+		}
+	}
+
 	static rbtree_node_ptr sibling(rbtree_node_ptr node) {
 		assert(node != shm_nullptr && node->parent != shm_nullptr);
 
@@ -281,11 +561,11 @@ protected:
 	}
 
 	rbtree_node_ptr createNode(const value_type& val) {
-		return g_alloc->New<RBTreeNode<value_type>>(val);
+		return pool_.New(val);
 	}
 
 	void deleteNode(rbtree_node_ptr& p) {
-		g_alloc->Delete(p);
+		pool_.Delete(p);
 	}
 
 	static value_type& value(rbtree_node_ptr x) {
@@ -327,6 +607,9 @@ protected:
 
 		n->left_child = node;
 		node->parent = n;
+
+		n->count = node->count;
+		recount(node);
 	}
 
 	void rotate_right(rbtree_node_ptr node) {
@@ -344,6 +627,9 @@ protected:
 
 		n->right_child = node;
 		node->parent = n;
+
+		n->count = node->count;
+		recount(node);
 	}
 
 	void repair_after_insert(rbtree_node_ptr node) {
@@ -462,18 +748,146 @@ protected:
 		}
 	}
 
+	// 把按key排好序的节点连成一棵平衡的红黑树
+	// 除了最底下一层，其它层都是满的，最底下一层染成红色，每条路径上的黑色节点数就相同了
+	void link_sorted(const std::vector<rbtree_node_ptr>& nodes) {
+		size_t full_levels = 0;
+		while ((size_t(2) << full_levels) - 1 <= nodes.size()) {
+			full_levels++;
+		}
+
+		root_ = build_subtree(nodes, 0, nodes.size(), 0, full_levels, shm_nullptr);
+		size_ = nodes.size();
+	}
+
+	// 取[lo, hi)的中点作为根，左右两边递归构建
+	static rbtree_node_ptr build_subtree(const std::vector<rbtree_node_ptr>& nodes, size_t lo, size_t hi, size_t depth,
+		size_t full_levels, rbtree_node_ptr parent) {
+		if (lo >= hi)
+			return shm_nullptr;
+
+		size_t mid = lo + (hi - lo) / 2;
+		auto node = nodes[mid];
+		node->parent = parent;
+		node->left_child = build_subtree(nodes, lo, mid, depth + 1, full_levels, node);
+		node->right_child = build_subtree(nodes, mid + 1, hi, depth + 1, full_levels, node);
+		node->color = depth >= full_levels ? RBTREE_NODE_RED : RBTREE_NODE_BLACK;
+		node->count = uint32_t(hi - lo);
+		return node;
+	}
+
 	void recurErase(rbtree_node_ptr& x) {
 		if (x != shm_nullptr) {
 			recurErase(x->left_child);
 			recurErase(x->right_child);
-			deleteNode(x);
+			pool_.Destroy(x);
 		}
 	}
 
-	rbtree_node_ptr rbtree_lookup_key(const Key& key) {
+	template <typename... P>
+	std::pair<iterator, bool> emplace_unique(const Key& k, P&&... params) {
+		auto pos = rbtree_insert_pos(k);
+		if (pos.second == 0) {
+			return std::make_pair(iterator(pos.first), false);
+		}
+
+		auto node = pool_.New(std::forward<P>(params)...);
+		rbtree_link(node, pos.first, pos.second);
+		return std::make_pair(iterator(node), true);
+	}
+
+	// 查找key的插入位置，返回父节点以及key和父节点的比较结果，比较结果为0表示key已经存在，返回的就是那个节点
+	template <class K>
+	std::pair<rbtree_node_ptr, int64_t> rbtree_insert_pos(const K& k) const {
+		rbtree_node_ptr parent = shm_nullptr;
+		int64_t cmp = -1;
+		const search_key<K> sk(k);
 		auto n = root_;
 		while (n != shm_nullptr) {
-			auto cmp = compare(key, n);
+			parent = n;
+			cmp = compare(sk, n);
+			if (cmp < 0) {
+				n = n->left_child;
+			} else if (cmp > 0) {
+				n = n->right_child;
+			} else {
+				break;
+			}
+		}
+		return std::make_pair(parent, cmp);
+	}
+
+	// 把新节点挂到parent下面，然后调整颜色
+	void rbtree_link(rbtree_node_ptr node, rbtree_node_ptr parent, int64_t cmp) {
+		node->parent = parent;
+		node->left_child = shm_nullptr;
+		node->right_child = shm_nullptr;
+		node->color = RBTREE_NODE_RED;
+		node->count = 1;
+
+		if (parent == shm_nullptr) {
+			root_ = node;
+		} else if (cmp < 0) {
+			parent->left_child = node;
+		} else {
+			parent->right_child = node;
+		}
+
+		// 旋转只会调整参与旋转的节点，所以先把路径上的计数都加上
+		update_count(parent, 1);
+
+		repair_after_insert(node);
+
+		++size_;
+	}
+
+	template <class It, class K>
+	std::pair<It, It> equal_range_impl(const K& key) const {
+		auto n = rbtree_lower_bound(key);
+		if (n != shm_nullptr && compare(key, n) == 0) {
+			return std::make_pair(It(n), It(rbtree_next<value_type>(n)));
+		}
+		return std::make_pair(It(n), It(n));
+	}
+
+	template <class K>
+	rbtree_node_ptr rbtree_lower_bound(const K& key) const {
+		rbtree_node_ptr result = shm_nullptr;
+		const search_key<K> k(key);
+		auto n = root_;
+		while (n != shm_nullptr) {
+			if (compare(k, n) <= 0) {
+				result = n;
+				n = n->left_child;
+			} else {
+				n = n->right_child;
+			}
+		}
+		return result;
+	}
+
+	template <class K>
+	rbtree_node_ptr rbtree_upper_bound(const K& key) const {
+		rbtree_node_ptr result = shm_nullptr;
+		const search_key<K> k(key);
+		auto n = root_;
+		while (n != shm_nullptr) {
+			if (compare(k, n) < 0) {
+				result = n;
+				n = n->left_child;
+			} else {
+				n = n->right_child;
+			}
+		}
+		return result;
+	}
+
+	template <class K>
+	rbtree_node_ptr rbtree_lookup_key(const K& key) const {
+		const search_key<K> k(key);
+		auto n = root_;
+		while (n != shm_nullptr) {
+			auto cmp = compare(k, n);
 
 			if (cmp < 0) {
 				n = n->left_child;
@@ -493,6 +907,9 @@ protected:
 			return shm_nullptr;
 		}
 
+		// 有两个孩子时node会换成前驱的值，next依然是下一个节点
+		auto next = rbtree_next<value_type>(node);
+
 		// 如果待删除的节点有两个孩子需要转换成只有一个孩子，方法是找一个相邻的替换
 		if (node->left_child != shm_nullptr && node->right_child != shm_nullptr) {
 			auto k = node->left_child;
@@ -509,6 +926,8 @@ protected:
 			// 此处还可以优化一下性能，其实修改几个指针就可以了
 			//
 			std::swap(node->value, k->value);
+			node->set_prefix(node->value.first);
+			k->set_prefix(k->value.first);
 			std::swap(node, k);
 		}
 
@@ -519,9 +938,15 @@ protected:
 			// 待删除节点只有一个孩子
 			// 把node用replacement替换掉
 			transplant(node, replacement);
+			update_count(replacement->parent, -1);
 
+			// 黑节点只有一个孩子时，孩子一定是红色的，染黑就能补上少掉的黑色
 			if (color(node) == RBTREE_NODE_BLACK) {
-				repair_after_remove(replacement);
+				if (color(replacement) == RBTREE_NODE_RED) {
+					replacement->color = RBTREE_NODE_BLACK;
+				} else {
+					repair_after_remove(replacement);
+				}
 			}
 		} else if (node->parent == shm_nullptr) {
 			// 根节点
@@ -537,14 +962,15 @@ protected:
 					node->parent->left_child = shm_nullptr;
 				else if (node == node->parent->right_child)
 					node->parent->right_child = shm_nullptr;
+				// 调整颜色时node还在树中，摘下来之后再更新计数
+				update_count(node->parent, -1);
 				node->parent = shm_nullptr;
 			}
 		}
 
-		// auto tmp = node.Ptr();
 		deleteNode(node);
 		--size_;
-		return replacement;
+		return next;
 	}
 
 	rbtree_node_ptr rbtree_first() const {
@@ -560,7 +986,37 @@ protected:
 		return n;
 	}
 
-	rbtree_node_ptr rbtree_last() {
+	rbtree_node_ptr rbtree_select(size_t k) const {
+		auto n = root_;
+		while (n != shm_nullptr) {
+			auto left = count(n->left_child);
+			if (k < left) {
+				n = n->left_child;
+			} else if (k == left) {
+				break;
+			} else {
+				k -= left + 1;
+				n = n->right_child;
+			}
+		}
+		return n;
+	}
+
+	size_t rbtree_index(rbtree_node_ptr n) const {
+		if (n == shm_nullptr) {
+			return size_;
+		}
+
+		size_t r = count(n->left_child);
+		for (; n->parent != shm_nullptr; n = n->parent) {
+			if (n == n->parent->right_child) {
+				r += count(n->parent->left_child) + 1;
+			}
+		}
+		return r;
+	}
+
+	rbtree_node_ptr rbtree_last() const {
 		auto n = root_;
 		if (n == shm_nullptr) {
 			return shm_nullptr;
@@ -0,0 +1,161 @@
+﻿#pragma once
+#include <utility>
+#include <algorithm>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+// 容器自带的节点池，shm_map和shm_list的节点都从这里分配
+// 节点按块批量向g_alloc申请，同一个容器的节点集中在少数几块连续的空间里，遍历时访问的内存更集中
+// 释放的节点挂在空闲链表上，下次分配优先复用；节点全部释放之后整块还给g_alloc
+// 新块的大小是上一块的两倍，最大kMaxChunkBytes，只有几个节点的小容器不会多占空间
+template <class T>
+class shm_node_pool {
+	static_assert(sizeof(T) >= sizeof(int64_t), "node is too small to hold the free list link");
+
+	struct Chunk {
+		shm_pointer<Chunk> next;
+		uint32_t capacity;
+		uint32_t reserved;
+	};
+
+	static constexpr size_t kMaxChunkBytes = 64 * 1024;
+
+public:
+	shm_node_pool() {}
+	shm_node_pool(const shm_node_pool&) = delete;
+	shm_node_pool& operator=(const shm_node_pool&) = delete;
+
+	// 容器应该先析构所有节点
+	~shm_node_pool() {
+		release();
+	}
+
+	template <typename... P>
+	shm_pointer<T> New(P&&... params) {
+		auto p = allocate();
+		::new (p.Ptr()) T(std::forward<P>(params)...);
+		return p;
+	}
+
+	void Delete(shm_pointer<T>& p) {
+		p->~T();
+		deallocate(p);
+		p = shm_nullptr;
+	}
+
+	// 只析构不回收，整个容器清空的时候先逐个Destroy，最后再release
+	void Destroy(shm_pointer<T>& p) {
+		p->~T();
+		p = shm_nullptr;
+	}
+
+	// 把所有块还给g_alloc，调用之前所有节点都必须已经析构
+	void release() {
+		while (m_chunks != shm_nullptr) {
+			auto next = m_chunks->next;
+			g_alloc->Free(m_chunks);
+			m_chunks = next;
+		}
+		m_free = shm_nullptr;
+		m_chunk_used = 0;
+		m_live = 0;
+	}
+
+	// 正在使用的节点个数
+	size_t size() const {
+		return m_live;
+	}
+
+	// 接管r的所有块和节点，用于把整个容器的节点转移过来，r变成空池
+	// r当前块中还没切出去的部分不再使用，等整块归还的时候一起释放
+	void merge(shm_node_pool& r) {
+		if (r.m_chunks == shm_nullptr)
+			return;
+
+		if (m_chunks == shm_nullptr) {
+			swap(r);
+			return;
+		}
+
+		// r的块挂在本池当前块的后面，新节点还是从当前块切
+		auto last = r.m_chunks;
+		while (last->next != shm_nullptr) {
+			last = last->next;
+		}
+		last->next = m_chunks->next;
+		m_chunks->next = r.m_chunks;
+
+		if (r.m_free != shm_nullptr) {
+			auto tail = r.m_free;
+			while (*(int64_t*)tail.Ptr() != shm_nullptr) {
+				tail = shm_pointer<T>(*(int64_t*)tail.Ptr());
+			}
+			*(int64_t*)tail.Ptr() = m_free.Raw();
+			m_free = r.m_free;
+		}
+
+		m_live += r.m_live;
+		r.m_free = shm_nullptr;
+		r.m_chunks = shm_nullptr;
+		r.m_chunk_used = 0;
+		r.m_live = 0;
+	}
+
+	void swap(shm_node_pool& r) {
+		std::swap(m_free, r.m_free);
+		std::swap(m_chunks, r.m_chunks);
+		std::swap(m_chunk_used, r.m_chunk_used);
+		std::swap(m_live, r.m_live);
+	}
+
+private:
+	shm_pointer<T> allocate() {
+		++m_live;
+		if (m_free != shm_nullptr) {
+			auto p = m_free;
+			m_free = shm_pointer<T>(*(int64_t*)p.Ptr());
+			return p;
+		}
+
+		if (m_chunks == shm_nullptr || m_chunk_used == m_chunks->capacity) {
+			add_chunk();
+		}
+		return shm_pointer<T>(m_chunks.Raw() + int64_t(sizeof(Chunk) + sizeof(T) * m_chunk_used++));
+	}
+
+	// 空闲链表的下一个节点的偏移直接写在已经析构的节点里
+	void deallocate(shm_pointer<T> p) {
+		*(int64_t*)p.Ptr() = m_free.Raw();
+		m_free = p;
+		if (--m_live == 0) {
+			release();
+		}
+	}
+
+	void add_chunk() {
+		size_t n = m_chunks == shm_nullptr ? 1 : size_t(m_chunks->capacity) * 2;
+		size_t bytes = sizeof(Chunk) + sizeof(T) * n;
+		if (bytes > kMaxChunkBytes) {
+			bytes = std::max(kMaxChunkBytes, sizeof(Chunk) + sizeof(T));
+		}
+
+		// 伙伴算法按2的幂分配，块里剩余的空间也用来放节点
+		auto chunk = g_alloc->Malloc<char>(bytes);
+		shm_pointer<Chunk> c(chunk.Raw());
+		c->next = m_chunks;
+		c->capacity = uint32_t((g_alloc->GetCapacity(chunk) - sizeof(Chunk)) / sizeof(T));
+		m_chunks = c;
+		m_chunk_used = 0;
+	}
+
+private:
+	shm_pointer<T> m_free = shm_nullptr;
+	// 最新的块在链表头，只从这一块中切出新节点
+	shm_pointer<Chunk> m_chunks = shm_nullptr;
+	uint32_t m_chunk_used = 0;
+	uint32_t m_live = 0;
+};
+
+} // namespace smd
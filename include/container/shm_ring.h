@@ -0,0 +1,523 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+#include <common/slice.h>
+#ifdef __linux__
+	#include <unistd.h>
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+#endif
+
+namespace smd {
+
+// 环形队列的阻塞等待：等待方在seq上futex等待，通知方只有在有人等待时才发起系统调用
+// futex不带PRIVATE标志，不同进程映射同一块共享内存也能互相唤醒
+// 没有futex的平台退化为短暂休眠后重新检查
+struct shm_ring_waiter {
+	std::atomic<uint32_t> seq{0};
+	std::atomic<uint32_t> waiters{0};
+
+	void notify() {
+		seq.fetch_add(1, std::memory_order_seq_cst);
+		if (waiters.load(std::memory_order_seq_cst) > 0) {
+#ifdef __linux__
+			syscall(SYS_futex, (uint32_t*)&seq, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+		}
+	}
+
+	// 等到ready()为真或者超时，timeout_ms小于0表示一直等
+	template <class F>
+	bool wait(F&& ready, int timeout_ms) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		while (!ready()) {
+			waiters.fetch_add(1, std::memory_order_seq_cst);
+			uint32_t s = seq.load(std::memory_order_seq_cst);
+			if (ready()) {
+				waiters.fetch_sub(1, std::memory_order_seq_cst);
+				return true;
+			}
+
+			auto left = deadline - std::chrono::steady_clock::now();
+			if (timeout_ms >= 0 && left <= std::chrono::nanoseconds(0)) {
+				waiters.fetch_sub(1, std::memory_order_seq_cst);
+				return false;
+			}
+#ifdef __linux__
+			timespec ts;
+			timespec* pts = nullptr;
+			if (timeout_ms >= 0) {
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+				ts.tv_sec = time_t(ns / 1000000000);
+				ts.tv_nsec = long(ns % 1000000000);
+				pts = &ts;
+			}
+			syscall(SYS_futex, (uint32_t*)&seq, FUTEX_WAIT, s, pts, nullptr, 0);
+#else
+			if (seq.load(std::memory_order_seq_cst) == s) {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+#endif
+			waiters.fetch_sub(1, std::memory_order_seq_cst);
+		}
+		return true;
+	}
+};
+
+// 放在共享内存中的有界环形队列，用于进程之间传递消息，比如game把落地事件交给db
+// 队列对象和缓冲区在构造时由创建者一次分配好，之后的push/pop只用原子变量，不再访问g_alloc
+// 元素必须可以平凡拷贝：g_alloc不是多进程安全的，shm_string等需要分配的类型不能跨进程传递
+// 容量向上取整为2的幂；读写位置是单调递增的64位计数，不会回绕
+
+// 单生产者单消费者，两端各自缓存对方的位置，大多数操作不需要读对方的缓存行
+template <class T>
+class shm_spsc_ring {
+	static_assert(std::is_trivially_copyable<T>::value, "shm_spsc_ring element must be trivially copyable");
+
+public:
+	explicit shm_spsc_ring(size_t capacity = 1024) {
+		size_t n = 1;
+		while (n < capacity) {
+			n <<= 1;
+		}
+		m_buffer = g_alloc->Malloc<T>(n);
+		m_mask = n - 1;
+	}
+
+	shm_spsc_ring(const shm_spsc_ring&) = delete;
+	shm_spsc_ring& operator=(const shm_spsc_ring&) = delete;
+
+	~shm_spsc_ring() {
+		g_alloc->Free(m_buffer, capacity());
+	}
+
+	size_t capacity() const {
+		return size_t(m_mask + 1);
+	}
+
+	size_t size() const {
+		return size_t(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	bool try_push(const T& value) {
+		return push_batch(&value, 1) == 1;
+	}
+
+	// 尽量写入n个，返回实际写入的个数；整批只发布一次写位置，最多唤醒一次
+	size_t push_batch(const T* values, size_t n) {
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		if (capacity() - (tail - m_cached_head) < n) {
+			m_cached_head = m_head.load(std::memory_order_acquire);
+		}
+		size_t count = std::min(n, size_t(capacity() - (tail - m_cached_head)));
+		if (count == 0)
+			return 0;
+
+		copy_in(tail, values, count);
+		m_tail.store(tail + count, std::memory_order_release);
+		m_not_empty.notify();
+		return count;
+	}
+
+	bool try_pop(T& value) {
+		return pop_batch(&value, 1) == 1;
+	}
+
+	// 最多取出n个，返回实际取出的个数
+	size_t pop_batch(T* values, size_t n) {
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		if (m_cached_tail - head < n) {
+			m_cached_tail = m_tail.load(std::memory_order_acquire);
+		}
+		size_t count = std::min(n, size_t(m_cached_tail - head));
+		if (count == 0)
+			return 0;
+
+		copy_out(head, values, count);
+		m_head.store(head + count, std::memory_order_release);
+		m_not_full.notify();
+		return count;
+	}
+
+	// 队列满时阻塞，超时返回false
+	bool push(const T& value, int timeout_ms = -1) {
+		while (!try_push(value)) {
+			if (!m_not_full.wait([this] { return size() < capacity(); }, timeout_ms))
+				return false;
+		}
+		return true;
+	}
+
+	bool pop(T& value, int timeout_ms = -1) {
+		return pop_batch_wait(&value, 1, timeout_ms) == 1;
+	}
+
+	// 队列空时阻塞，有数据之后尽量多取，最多n个
+	size_t pop_batch_wait(T* values, size_t n, int timeout_ms = -1) {
+		size_t count = 0;
+		while ((count = pop_batch(values, n)) == 0) {
+			if (!m_not_empty.wait([this] { return !empty(); }, timeout_ms))
+				return 0;
+		}
+		return count;
+	}
+
+private:
+	// 跨过缓冲区末尾时分两段拷贝
+	void copy_in(uint64_t pos, const T* values, size_t count) {
+		size_t off = size_t(pos & m_mask);
+		size_t first = std::min(count, capacity() - off);
+		memcpy((void*)(m_buffer.Ptr() + off), values, sizeof(T) * first);
+		memcpy((void*)m_buffer.Ptr(), values + first, sizeof(T) * (count - first));
+	}
+
+	void copy_out(uint64_t pos, T* values, size_t count) const {
+		size_t off = size_t(pos & m_mask);
+		size_t first = std::min(count, capacity() - off);
+		memcpy((void*)values, m_buffer.Ptr() + off, sizeof(T) * first);
+		memcpy((void*)(values + first), m_buffer.Ptr(), sizeof(T) * (count - first));
+	}
+
+private:
+	// 生产者写的缓存行
+	alignas(64) std::atomic<uint64_t> m_tail{0};
+	uint64_t m_cached_head = 0;
+	// 消费者写的缓存行
+	alignas(64) std::atomic<uint64_t> m_head{0};
+	uint64_t m_cached_tail = 0;
+	alignas(64) shm_ring_waiter m_not_empty;
+	shm_ring_waiter m_not_full;
+	shm_pointer<T> m_buffer;
+	uint64_t m_mask = 0;
+};
+
+// 多生产者多消费者，每个槽位带一个序号，生产者和消费者各自用CAS抢位置
+template <class T>
+class shm_mpmc_ring {
+	static_assert(std::is_trivially_copyable<T>::value, "shm_mpmc_ring element must be trivially copyable");
+
+	struct Slot {
+		std::atomic<uint64_t> seq;
+		T data;
+	};
+
+public:
+	explicit shm_mpmc_ring(size_t capacity = 1024) {
+		size_t n = 2;
+		while (n < capacity) {
+			n <<= 1;
+		}
+		m_slots = g_alloc->Malloc<Slot>(n);
+		m_mask = n - 1;
+		for (size_t i = 0; i < n; i++) {
+			::new (&m_slots[i].seq) std::atomic<uint64_t>(i);
+		}
+	}
+
+	shm_mpmc_ring(const shm_mpmc_ring&) = delete;
+	shm_mpmc_ring& operator=(const shm_mpmc_ring&) = delete;
+
+	~shm_mpmc_ring() {
+		g_alloc->Free(m_slots, capacity());
+	}
+
+	size_t capacity() const {
+		return size_t(m_mask + 1);
+	}
+
+	// 并发修改时只是一个近似值
+	size_t size() const {
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		uint64_t tail = m_tail.load(std::memory_order_acquire);
+		return tail > head ? size_t(tail - head) : 0;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	bool try_push(const T& value) {
+		if (!push_one(value))
+			return false;
+		m_not_empty.notify();
+		return true;
+	}
+
+	size_t push_batch(const T* values, size_t n) {
+		size_t count = 0;
+		while (count < n && push_one(values[count])) {
+			++count;
+		}
+		if (count > 0) {
+			m_not_empty.notify();
+		}
+		return count;
+	}
+
+	bool try_pop(T& value) {
+		if (!pop_one(value))
+			return false;
+		m_not_full.notify();
+		return true;
+	}
+
+	size_t pop_batch(T* values, size_t n) {
+		size_t count = 0;
+		while (count < n && pop_one(values[count])) {
+			++count;
+		}
+		if (count > 0) {
+			m_not_full.notify();
+		}
+		return count;
+	}
+
+	bool push(const T& value, int timeout_ms = -1) {
+		while (!try_push(value)) {
+			if (!m_not_full.wait([this] { return size() < capacity(); }, timeout_ms))
+				return false;
+		}
+		return true;
+	}
+
+	bool pop(T& value, int timeout_ms = -1) {
+		return pop_batch_wait(&value, 1, timeout_ms) == 1;
+	}
+
+	size_t pop_batch_wait(T* values, size_t n, int timeout_ms = -1) {
+		size_t count = 0;
+		while ((count = pop_batch(values, n)) == 0) {
+			if (!m_not_empty.wait([this] { return !empty(); }, timeout_ms))
+				return 0;
+		}
+		return count;
+	}
+
+private:
+	// 槽位序号等于写位置时可写，等于写位置+1时可读
+	bool push_one(const T& value) {
+		uint64_t pos = m_tail.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true) {
+			slot = &m_slots[pos & m_mask];
+			uint64_t seq = slot->seq.load(std::memory_order_acquire);
+			int64_t diff = int64_t(seq) - int64_t(pos);
+			if (diff == 0) {
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+		memcpy((void*)&slot->data, &value, sizeof(T));
+		slot->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop_one(T& value) {
+		uint64_t pos = m_head.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true) {
+			slot = &m_slots[pos & m_mask];
+			uint64_t seq = slot->seq.load(std::memory_order_acquire);
+			int64_t diff = int64_t(seq) - int64_t(pos + 1);
+			if (diff == 0) {
+				if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = m_head.load(std::memory_order_relaxed);
+			}
+		}
+		memcpy((void*)&value, &slot->data, sizeof(T));
+		slot->seq.store(pos + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	alignas(64) std::atomic<uint64_t> m_tail{0};
+	alignas(64) std::atomic<uint64_t> m_head{0};
+	alignas(64) shm_ring_waiter m_not_empty;
+	shm_ring_waiter m_not_full;
+	shm_pointer<Slot> m_slots;
+	uint64_t m_mask = 0;
+};
+
+// 单生产者单消费者的变长记录队列，每条记录是4字节长度加内容，按8字节对齐
+// 末尾放不下一条记录时写一个回绕标记，从缓冲区开头继续写，一条记录总是连续的
+// 消费者可以直接在缓冲区上读记录，处理完一批之后再一次性释放空间
+class shm_record_ring {
+	static constexpr uint32_t kWrap = 0xFFFFFFFF;
+	static constexpr size_t kHeader = sizeof(uint32_t);
+
+public:
+	explicit shm_record_ring(size_t capacity_bytes = 64 * 1024) {
+		size_t n = 64;
+		while (n < capacity_bytes) {
+			n <<= 1;
+		}
+		m_buffer = g_alloc->Malloc<char>(n);
+		m_mask = n - 1;
+	}
+
+	shm_record_ring(const shm_record_ring&) = delete;
+	shm_record_ring& operator=(const shm_record_ring&) = delete;
+
+	~shm_record_ring() {
+		g_alloc->Free(m_buffer, capacity());
+	}
+
+	// 缓冲区的字节数，一条记录最多占一半
+	size_t capacity() const {
+		return size_t(m_mask + 1);
+	}
+
+	size_t max_record_size() const {
+		return capacity() / 2 - kHeader;
+	}
+
+	bool empty() const {
+		return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+	}
+
+	bool try_push(const Slice& record) {
+		return push_batch(&record, 1) == 1;
+	}
+
+	// 依次写入，空间不够时停下，返回写入的条数
+	size_t push_batch(const Slice* records, size_t n) {
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t count = 0;
+		for (; count < n; count++) {
+			assert(records[count].size() <= max_record_size());
+			if (!write(tail, records[count]))
+				break;
+		}
+		if (count > 0) {
+			m_tail.store(tail, std::memory_order_release);
+			m_not_empty.notify();
+		}
+		return count;
+	}
+
+	bool try_pop(std::string& record) {
+		return pop_batch([&record](const Slice& r) { record.assign(r.data(), r.size()); }, 1) == 1;
+	}
+
+	// 最多处理max_count条，f(const Slice&)直接读缓冲区中的记录，返回之后空间才会被释放
+	template <class F>
+	size_t pop_batch(F&& f, size_t max_count = SIZE_MAX) {
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		uint64_t tail = m_tail.load(std::memory_order_acquire);
+		size_t count = 0;
+		while (count < max_count && head != tail) {
+			size_t off = size_t(head & m_mask);
+			uint32_t len;
+			memcpy(&len, m_buffer.Ptr() + off, kHeader);
+			if (len == kWrap) {
+				head += capacity() - off;
+				continue;
+			}
+			f(Slice(m_buffer.Ptr() + off + kHeader, len));
+			head += record_bytes(len);
+			++count;
+		}
+		if (head != m_head.load(std::memory_order_relaxed)) {
+			m_head.store(head, std::memory_order_release);
+			m_not_full.notify();
+		}
+		return count;
+	}
+
+	// 空间不够时阻塞
+	bool push(const Slice& record, int timeout_ms = -1) {
+		while (!try_push(record)) {
+			auto ready = [this, &record] {
+				uint64_t tail = m_tail.load(std::memory_order_relaxed);
+				return room(tail, m_head.load(std::memory_order_acquire)) >= need_bytes(tail, record.size());
+			};
+			if (!m_not_full.wait(ready, timeout_ms))
+				return false;
+		}
+		return true;
+	}
+
+	// 队列空时阻塞，有数据之后处理一批
+	template <class F>
+	size_t pop_batch_wait(F&& f, size_t max_count = SIZE_MAX, int timeout_ms = -1) {
+		size_t count = 0;
+		while ((count = pop_batch(f, max_count)) == 0) {
+			if (!m_not_empty.wait([this] { return !empty(); }, timeout_ms))
+				return 0;
+		}
+		return count;
+	}
+
+private:
+	static size_t record_bytes(size_t len) {
+		return (kHeader + len + 7) & ~size_t(7);
+	}
+
+	size_t room(uint64_t tail, uint64_t head) const {
+		return capacity() - size_t(tail - head);
+	}
+
+	// 在tail处写入一条记录需要的空间，末尾放不下时还要算上跳过的部分
+	// 记录最多占一半缓冲区，所以队列为空时一定放得下
+	size_t need_bytes(uint64_t tail, size_t len) const {
+		size_t bytes = record_bytes(len);
+		size_t till_end = capacity() - size_t(tail & m_mask);
+		return bytes <= till_end ? bytes : till_end + bytes;
+	}
+
+	// 写入一条记录并推进tail，还没有发布给消费者
+	bool write(uint64_t& tail, const Slice& record) {
+		size_t bytes = record_bytes(record.size());
+		size_t off = size_t(tail & m_mask);
+		size_t till_end = capacity() - off;
+		size_t need = need_bytes(tail, record.size());
+		if (room(tail, m_cached_head) < need) {
+			m_cached_head = m_head.load(std::memory_order_acquire);
+			if (room(tail, m_cached_head) < need)
+				return false;
+		}
+
+		if (bytes > till_end) {
+			memcpy(m_buffer.Ptr() + off, &kWrap, kHeader);
+			tail += till_end;
+			off = 0;
+		}
+		uint32_t len = uint32_t(record.size());
+		memcpy(m_buffer.Ptr() + off, &len, kHeader);
+		memcpy(m_buffer.Ptr() + off + kHeader, record.data(), record.size());
+		tail += bytes;
+		return true;
+	}
+
+private:
+	alignas(64) std::atomic<uint64_t> m_tail{0};
+	uint64_t m_cached_head = 0;
+	alignas(64) std::atomic<uint64_t> m_head{0};
+	alignas(64) shm_ring_waiter m_not_empty;
+	shm_ring_waiter m_not_full;
+	shm_pointer<char> m_buffer;
+	uint64_t m_mask = 0;
+};
+
+} // namespace smd
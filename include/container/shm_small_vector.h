@@ -0,0 +1,224 @@
+﻿#pragma once
+#include <container/shm_pointer.h>
+#include <container/shm_vector.h>
+
+namespace smd {
+
+// 前N个元素直接存放在对象内部，超过N个之后才搬到共享内存堆上
+// 适合元素个数通常很少的小集合，大多数情况下不需要额外分配
+template <class T, size_t N>
+class shm_small_vector {
+	static_assert(N > 0, "inline capacity must be positive");
+
+public:
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	typedef T& reference;
+	typedef const T& const_reference;
+
+	shm_small_vector() {}
+
+	shm_small_vector(const shm_small_vector& r) {
+		reserve(r.size());
+		for (size_t i = 0; i < r.size(); i++) {
+			push_back(r[i]);
+		}
+	}
+
+	// 对方在堆上时直接拿走堆上的空间，在对象内部时只能逐个移动元素
+	shm_small_vector(shm_small_vector&& r) noexcept {
+		steal(r);
+	}
+
+	shm_small_vector& operator=(const shm_small_vector& r) {
+		if (this != &r) {
+			clear();
+			reserve(r.size());
+			for (size_t i = 0; i < r.size(); i++) {
+				push_back(r[i]);
+			}
+		}
+		return *this;
+	}
+
+	shm_small_vector& operator=(shm_small_vector&& r) noexcept {
+		if (this != &r) {
+			destroy();
+			steal(r);
+		}
+		return *this;
+	}
+
+	~shm_small_vector() {
+		destroy();
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	// 是否还存放在对象内部
+	bool is_inline() const {
+		return m_heap == shm_nullptr;
+	}
+
+	//访问元素相关
+	reference operator[](size_t i) {
+		assert(i < m_size);
+		return data()[i];
+	}
+
+	const_reference operator[](size_t i) const {
+		assert(i < m_size);
+		return data()[i];
+	}
+
+	reference front() {
+		return data()[0];
+	}
+
+	reference back() {
+		return data()[m_size - 1];
+	}
+
+	value_type* data() {
+		return is_inline() ? (value_type*)m_inline : m_heap.Ptr();
+	}
+
+	const value_type* data() const {
+		return is_inline() ? (const value_type*)m_inline : m_heap.Ptr();
+	}
+
+	iterator begin() {
+		return data();
+	}
+
+	const_iterator begin() const {
+		return data();
+	}
+
+	iterator end() {
+		return data() + m_size;
+	}
+
+	const_iterator end() const {
+		return data() + m_size;
+	}
+
+	void push_back(const value_type& value) {
+		emplace_back(value);
+	}
+
+	void push_back(value_type&& value) {
+		emplace_back(std::move(value));
+	}
+
+	template <typename... P>
+	reference emplace_back(P&&... params) {
+		if (m_size == m_capacity) {
+			// 参数可能引用了本容器中的元素，所以要先在新的空间中构造好，再搬迁旧元素
+			auto new_heap = g_alloc->Malloc<value_type>(std::max<size_t>(m_size + 1, m_capacity * 2));
+			::new (new_heap.Ptr() + m_size) value_type(std::forward<P>(params)...);
+			relocate(new_heap);
+		} else {
+			::new (data() + m_size) value_type(std::forward<P>(params)...);
+		}
+
+		++m_size;
+		return back();
+	}
+
+	void pop_back() {
+		assert(m_size > 0);
+		--m_size;
+		data()[m_size].~value_type();
+	}
+
+	void clear() {
+		while (!empty()) {
+			pop_back();
+		}
+	}
+
+	// 设置容量
+	void reserve(size_t new_capacity) {
+		if (new_capacity <= m_capacity)
+			return;
+
+		relocate(g_alloc->Malloc<value_type>(new_capacity));
+	}
+
+	// 改变元素的数目
+	void resize(size_t n, const value_type& val) {
+		reserve(n);
+		while (m_size < n) {
+			push_back(val);
+		}
+		while (m_size > n) {
+			pop_back();
+		}
+	}
+
+	// 元素个数不超过N的时候搬回对象内部，释放堆上的空间
+	void shrink_to_fit() {
+		if (is_inline() || m_size > N)
+			return;
+
+		relocate_n(m_heap.Ptr(), m_size, (value_type*)m_inline);
+		g_alloc->Free(m_heap, m_capacity);
+		m_capacity = N;
+	}
+
+private:
+	// 释放所有元素和堆上的空间，回到刚构造时的状态
+	void destroy() {
+		clear();
+		if (!is_inline()) {
+			g_alloc->Free(m_heap, m_capacity);
+			m_heap = shm_nullptr;
+			m_capacity = N;
+		}
+	}
+
+	// 要求自己是空的并且在对象内部，拿走r的元素之后r也回到这个状态
+	void steal(shm_small_vector& r) {
+		if (r.is_inline()) {
+			relocate_n((value_type*)r.m_inline, r.m_size, (value_type*)m_inline);
+		} else {
+			m_heap = r.m_heap;
+			m_capacity = r.m_capacity;
+			r.m_heap = shm_nullptr;
+			r.m_capacity = N;
+		}
+		m_size = r.m_size;
+		r.m_size = 0;
+	}
+
+	// 把元素搬到新的堆空间上
+	void relocate(shm_pointer<value_type> new_heap) {
+		relocate_n(data(), m_size, new_heap.Ptr());
+		if (!is_inline()) {
+			g_alloc->Free(m_heap, m_capacity);
+		}
+
+		m_heap = new_heap;
+		m_capacity = uint32_t(g_alloc->GetCapacity(m_heap));
+	}
+
+private:
+	shm_pointer<value_type> m_heap = shm_nullptr;
+	uint32_t m_size = 0;
+	uint32_t m_capacity = N;
+	alignas(value_type) char m_inline[sizeof(value_type) * N];
+};
+
+} // namespace smd
@@ -3,103 +3,173 @@
 #include <assert.h>
 
 #include <common/utility.h>
+#include <common/hash.h>
+#include <common/slice.h>
 #include <common/functional.h>
 #include <mem_alloc/alloc.h>
 #include <container/shm_pointer.h>
 
 namespace smd {
 
+// 不超过kInlineCapacity个字符的短字符串直接存放在对象内部，不需要分配共享内存
+// 长字符串存放在共享内存堆上，对象内部只记录偏移、容量和长度
+// 最后一个字节是标记：短字符串时是长度，长字符串时是kHeapTag，两种方式都不依赖对象地址，可以直接按字节搬迁
 class shm_string {
 public:
-	shm_string(size_t size = 0) {
-		resize(GetSuitableCapacity(size + 1));
+	shm_string(size_t capacity = 0) {
+		init_inline();
+		reserve(capacity);
 	}
 
 	shm_string(const std::string& r) {
-		resize(GetSuitableCapacity(r.size() + 1));
-		internal_copy(r.data(), r.size());
+		init(r.data(), r.size());
 	}
 
 	shm_string(const shm_string& r) {
-		resize(GetSuitableCapacity(r.size() + 1));
-		internal_copy(r.data(), r.size());
+		init(r.data(), r.size());
 	}
 
-	shm_string(const char* buf, size_t size) {
-		resize(GetSuitableCapacity(size + 1));
-		internal_copy(buf, size);
+	// 移动时直接按字节拿走对方的内容，对方变成空的短字符串
+	shm_string(shm_string&& r) noexcept {
+		memcpy((void*)this, (const void*)&r, sizeof(shm_string));
+		r.init_inline();
 	}
 
-	shm_string& operator=(const std::string& r) {
-		shm_string(r).swap(*this);
-		return *this;
+	// 显式构造，避免查找时不小心用Slice构造出临时的shm_string
+	explicit shm_string(const Slice& r) {
+		init(r.data(), r.size());
+	}
+
+	shm_string(const char* s) {
+		init(s, strlen(s));
+	}
+
+	shm_string(const char* buf, size_t size) {
+		init(buf, size);
 	}
 
-	shm_string& operator=(const shm_string& r) {
+	// 赋值时放得下就直接覆盖原有的空间，不会重新分配
+	shm_string& operator=(const shm_string& r) { return assign(r.data(), r.size()); }
+	shm_string& operator=(const std::string& r) { return assign(r.data(), r.size()); }
+	shm_string& operator=(const Slice& r) { return assign(r.data(), r.size()); }
+	shm_string& operator=(const char* s) { return assign(s, strlen(s)); }
+
+	shm_string& operator=(shm_string&& r) noexcept {
 		if (this != &r) {
-			shm_string(r).swap(*this);
+			release();
+			memcpy((void*)this, (const void*)&r, sizeof(shm_string));
+			r.init_inline();
 		}
 		return *this;
 	}
 
 	~shm_string() {
-		resize(0);
-		m_size = 0;
+		release();
 	}
 
-	char* data() { return m_ptr.Ptr(); }
-	const char* data() const { return m_ptr.Ptr(); }
-	size_t size() const { return m_size; }
-	bool empty() { return m_size > 0; }
-	size_t capacity() const { return m_capacity; }
-
-	shm_string& assign(const std::string& r) {
-		if (r.size() < m_capacity) {
-			internal_copy(r.data(), r.size());
-			shrink_to_fit();
+	char* data() { return is_inline() ? m_inline : shm_pointer<char>(m_heap.offset).Ptr(); }
+	const char* data() const { return is_inline() ? m_inline : shm_pointer<char>(m_heap.offset).Ptr(); }
+	size_t size() const { return is_inline() ? tag() : m_heap.size; }
+	bool empty() const { return size() == 0; }
+	// 不包括结尾的0
+	size_t capacity() const { return buffer_size() - 1; }
+
+	// 是否存放在对象内部
+	bool is_inline() const { return tag() != kHeapTag; }
+
+	shm_string& assign(const shm_string& r) { return assign(r.data(), r.size()); }
+	shm_string& assign(const std::string& r) { return assign(r.data(), r.size()); }
+	shm_string& assign(const Slice& r) { return assign(r.data(), r.size()); }
+	shm_string& assign(const char* s) { return assign(s, strlen(s)); }
+
+	shm_string& assign(const char* s, size_t n) {
+		if (n < buffer_size()) {
+			// s可能指向自身，用memmove
+			char* ptr = data();
+			memmove(ptr, s, n);
+			ptr[n] = '\0';
+			set_size(n);
 		} else {
-			resize(GetSuitableCapacity(r.size() + 1));
-			internal_copy(r.data(), r.size());
+			// 先拷到新空间再释放旧空间，s指向自身也没有问题
+			auto new_buffer_size = GetSuitableCapacity(n + 1);
+			auto ptr = g_alloc->Malloc<char>(new_buffer_size);
+			memcpy(ptr.Ptr(), s, n);
+			ptr.Ptr()[n] = '\0';
+			reset_heap(ptr, new_buffer_size, n);
 		}
 
 		return *this;
 	}
 
-	shm_string& append(const shm_string& str) {
-		if (capacity() <= size() + str.size()) {
-			resize(GetSuitableCapacity(size() + str.size() + 1));
+	shm_string& append(const shm_string& str) { return append(str.data(), str.size()); }
+	shm_string& append(const std::string& str) { return append(str.data(), str.size()); }
+	shm_string& append(const Slice& str) { return append(str.data(), str.size()); }
+	shm_string& append(const char* s) { return append(s, strlen(s)); }
+
+	shm_string& append(const char* s, size_t n) {
+		const size_t old_size = size();
+		if (buffer_size() <= old_size + n && !try_expand(GetSuitableCapacity(old_size + n + 1))) {
+			// 空间按2的幂增长，连续append的均摊开销是O(1)
+			auto new_buffer_size = GetSuitableCapacity(old_size + n + 1);
+			auto ptr = g_alloc->Malloc<char>(new_buffer_size);
+			memcpy(ptr.Ptr(), data(), old_size);
+			memcpy(ptr.Ptr() + old_size, s, n);
+			ptr.Ptr()[old_size + n] = '\0';
+			reset_heap(ptr, new_buffer_size, old_size + n);
+			return *this;
 		}
 
-		internal_append(str.data(), str.size());
+		// s可能指向自身，原地扩容不会移动数据，所以这里依然有效
+		char* ptr = data();
+		memmove(ptr + old_size, s, n);
+		ptr[old_size + n] = '\0';
+		set_size(old_size + n);
 		return *this;
 	}
 
-	shm_string& append(const std::string& str) {
-		if (capacity() <= size() + str.size()) {
-			resize(GetSuitableCapacity(size() + str.size() + 1));
-		}
-
-		internal_append(str.data(), str.size());
-		return *this;
+	void push_back(char c) {
+		append(&c, 1);
 	}
 
-	shm_string& append(const char* s) {
-		size_t len = strlen(s);
-		if (capacity() <= size() + len) {
-			resize(GetSuitableCapacity(size() + len + 1));
-		}
+	shm_string& operator+=(const Slice& str) { return append(str.data(), str.size()); }
+	shm_string& operator+=(char c) { return append(&c, 1); }
 
-		internal_append(s, len);
-		return *this;
+	// 预留至少能放下n个字符的空间，原有的内容会保留下来
+	void reserve(size_t n) {
+		if (n < buffer_size())
+			return;
+
+		auto new_buffer_size = GetSuitableCapacity(n + 1);
+		if (try_expand(new_buffer_size))
+			return;
+
+		const size_t old_size = size();
+		auto ptr = g_alloc->Malloc<char>(new_buffer_size);
+		memcpy(ptr.Ptr(), data(), old_size + 1);
+		reset_heap(ptr, new_buffer_size, old_size);
 	}
 
-	shm_string& append(const char* s, size_t n) {
-		if (capacity() <= size() + n) {
-			resize(GetSuitableCapacity(size() + n + 1));
+	// 释放多余的空间，短字符串搬回对象内部
+	void shrink_to_fit() {
+		if (is_inline())
+			return;
+
+		const size_t len = size();
+		if (len <= kInlineCapacity) {
+			shm_pointer<char> ptr(m_heap.offset);
+			const uint32_t old_capacity = m_heap.capacity;
+			memcpy(m_inline, ptr.Ptr(), len + 1);
+			set_tag(uint8_t(len));
+			g_alloc->Free(ptr, old_capacity);
+			return;
 		}
 
-		internal_append(s, n);
-		return *this;
+		auto new_buffer_size = GetSuitableCapacity(len + 1);
+		if (new_buffer_size < m_heap.capacity) {
+			auto ptr = g_alloc->Malloc<char>(new_buffer_size);
+			memcpy(ptr.Ptr(), data(), len + 1);
+			reset_heap(ptr, new_buffer_size, len);
+		}
 	}
 
 	int compare(const shm_string& b) const {
@@ -114,9 +184,10 @@ public:
 		return r;
 	}
 
+	// 只清空内容，保留空间给下次赋值使用
 	void clear() {
-		m_size = 0;
-		shrink_to_fit();
+		set_size(0);
+		data()[0] = '\0';
 	}
 
 	std::string ToString() const { return std::string(data(), size()); }
@@ -142,55 +213,100 @@ public:
 	}
 
 private:
+	enum : uint8_t {
+		kInlineCapacity = 22,
+		kHeapTag = 0xff,
+	};
+
 	static size_t GetSuitableCapacity(size_t size) {
-		if (size <= 16)
-			return 16;
-		else
-			return util::Utility::NextPowOf2(uint32_t(size));
+		return util::Utility::NextPowOf2(uint32_t(size));
 	}
 
 	void swap(shm_string& x) {
-		std::swap(m_ptr, x.m_ptr);
-		std::swap(m_capacity, x.m_capacity);
-		std::swap(m_size, x.m_size);
+		char tmp[sizeof(shm_string)];
+		memcpy(tmp, (void*)this, sizeof(shm_string));
+		memcpy((void*)this, (void*)&x, sizeof(shm_string));
+		memcpy((void*)&x, tmp, sizeof(shm_string));
 	}
 
-	void resize(size_t capacity) {
-		if (m_ptr != shm_nullptr) {
-			g_alloc->Free(m_ptr, m_capacity);
-			m_capacity = 0;
-		}
+	uint8_t tag() const {
+		return uint8_t(m_inline[kInlineCapacity + 1]);
+	}
 
-		if (capacity > 0) {
-			m_capacity = capacity;
-			m_ptr = g_alloc->Malloc<char>(m_capacity);
+	void set_tag(uint8_t tag) {
+		m_inline[kInlineCapacity + 1] = char(tag);
+	}
+
+	void init_inline() {
+		m_inline[0] = '\0';
+		set_tag(0);
+	}
+
+	// 释放堆上的空间，变回空的短字符串
+	void release() {
+		if (!is_inline()) {
+			shm_pointer<char> ptr(m_heap.offset);
+			g_alloc->Free(ptr, m_heap.capacity);
+			init_inline();
 		}
 	}
 
-	void internal_copy(const char* buf, size_t len) {
-		m_size = 0;
-		internal_append(buf, len);
+	void init(const char* buf, size_t len) {
+		init_inline();
+		assign(buf, len);
 	}
 
-	void internal_append(const char* buf, size_t len) {
-		// 最后有一个0
-		assert(m_capacity > m_size + len);
-		char* ptr = m_ptr.Ptr();
-		memcpy(&ptr[m_size], buf, len);
-		ptr[len] = '\0';
-		m_size = len;
+	// 可以存放的字节数，包括结尾的0
+	size_t buffer_size() const {
+		return is_inline() ? kInlineCapacity + 1 : m_heap.capacity;
 	}
 
-	void shrink_to_fit() {
-		// 在此添加代码缩容
+	void set_size(size_t size) {
+		if (is_inline()) {
+			set_tag(uint8_t(size));
+		} else {
+			m_heap.size = uint32_t(size);
+		}
+	}
+
+	// 堆上的空间紧挨着的伙伴块空闲时原地扩容，不用搬迁数据
+	bool try_expand(size_t new_buffer_size) {
+		if (is_inline())
+			return false;
+
+		shm_pointer<char> ptr(m_heap.offset);
+		if (!g_alloc->TryExpand(ptr, new_buffer_size))
+			return false;
+
+		m_heap.capacity = uint32_t(g_alloc->GetCapacity(ptr));
+		return true;
+	}
+
+	// 释放旧空间，换成已经写好内容的新空间
+	void reset_heap(shm_pointer<char> ptr, size_t buffer_size, size_t len) {
+		release();
+		m_heap.offset = ptr.Raw();
+		m_heap.capacity = uint32_t(buffer_size);
+		m_heap.size = uint32_t(len);
+		set_tag(kHeapTag);
 	}
 
 private:
-	shm_pointer<char> m_ptr = shm_nullptr;
-	size_t m_capacity = 0;
-	size_t m_size = 0;
+	struct HeapRep {
+		int64_t offset;
+		uint32_t capacity;
+		uint32_t size;
+	};
+
+	// m_inline的最后一个字节是标记，HeapRep只用到前16个字节
+	union {
+		HeapRep m_heap;
+		char m_inline[kInlineCapacity + 2];
+	};
 };
 
+static_assert(sizeof(shm_string) == 24, "shm_string should be 24 bytes");
+
 inline bool operator!=(const shm_string& x, const shm_string& y) { return !(x == y); }
 inline bool operator<(const shm_string& x, const shm_string& y) { return x.compare(y) < 0; }
 inline bool operator>(const shm_string& x, const shm_string& y) { return x.compare(y) > 0; }
@@ -200,6 +316,45 @@ int64_t compare(const shm_string& x, const shm_string& y) {
 	return x.compare(y);
 }
 
+// 和Slice直接比较，Slice可以由std::string、std::string_view、const char*隐式构造，查找的时候不用构造shm_string
+inline bool operator==(const shm_string& x, const Slice& y) { return Slice(x.data(), x.size()) == y; }
+inline bool operator==(const Slice& x, const shm_string& y) { return y == x; }
+inline bool operator==(const shm_string& x, const std::string& y) { return x == Slice(y); }
+inline bool operator==(const shm_string& x, const char* y) { return x == Slice(y); }
+inline bool operator!=(const shm_string& x, const Slice& y) { return !(x == y); }
+inline bool operator!=(const Slice& x, const shm_string& y) { return !(x == y); }
+inline bool operator!=(const shm_string& x, const std::string& y) { return !(x == y); }
+inline bool operator!=(const shm_string& x, const char* y) { return !(x == y); }
+
+inline int64_t compare(const shm_string& x, const Slice& y) {
+	return Slice(x.data(), x.size()).compare(y);
+}
+
+inline int64_t compare(const Slice& x, const shm_string& y) {
+	return x.compare(Slice(y.data(), y.size()));
+}
+
+// 前8个字节按大端序拼成整数，不足8个字节的补0，整数的大小关系和memcmp一致
+template <>
+struct key_prefix<shm_string> {
+	static constexpr bool enabled = true;
+
+	static uint64_t get(const char* data, size_t size) {
+		uint64_t v = 0;
+		memcpy(&v, data, size < sizeof(v) ? size : sizeof(v));
+#ifdef _MSC_VER
+		return _byteswap_uint64(v);
+#else
+		return __builtin_bswap64(v);
+#endif
+	}
+
+	static uint64_t get(const shm_string& s) { return get(s.data(), s.size()); }
+	static uint64_t get(const Slice& s) { return get(s.data(), s.size()); }
+	static uint64_t get(const std::string& s) { return get(s.data(), s.size()); }
+	static uint64_t get(const char* s) { return get(s, strlen(s)); }
+};
+
 } // namespace smd
 
 namespace std {
@@ -207,9 +362,23 @@ template <>
 struct hash<smd::shm_string> {
 	typedef smd::shm_string argument_type;
 	typedef std::size_t result_type;
+	typedef void is_transparent;
 
 	result_type operator()(argument_type const& s) const {
-		return std::hash<std::string>()(s.ToString());
+		// 直接对共享内存中的字节做哈希，和Slice的哈希结果相同
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+
+	result_type operator()(const smd::Slice& s) const {
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+
+	result_type operator()(const std::string& s) const {
+		return smd::util::Hash::Bytes(s.data(), s.size());
+	}
+
+	result_type operator()(const char* s) const {
+		return smd::util::Hash::Bytes(s, strlen(s));
 	}
 };
 
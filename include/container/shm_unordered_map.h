@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <container/shm_hashtable.h>
+
+namespace smd {
+
+// key/value形式的哈希表，元素存放在独立的节点中，插入删除其它元素不会让引用失效
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<>>
+class shm_unordered_map
+	: public shm_hashtable<Key, std::pair<Key, Value>, select1st<std::pair<Key, Value>>, Hash, KeyEqual> {
+	typedef shm_hashtable<Key, std::pair<Key, Value>, select1st<std::pair<Key, Value>>, Hash, KeyEqual> base_type;
+
+public:
+	typedef typename base_type::iterator iterator;
+	typedef Value mapped_type;
+
+	shm_unordered_map(size_t bucket_count = 1)
+		: base_type(bucket_count) {}
+
+	// key不存在的时候才用参数构造value
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& key, P&&... params) {
+		return this->emplace_unique(key, std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<P>(params)...));
+	}
+
+	template <class V>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+		auto res = try_emplace(key, std::forward<V>(value));
+		if (!res.second) {
+			res.first->second = std::forward<V>(value);
+		}
+		return res;
+	}
+
+	mapped_type& operator[](const Key& key) {
+		return try_emplace(key).first->second;
+	}
+
+	mapped_type& at(const Key& key) {
+		auto it = this->find(key);
+		assert(it != this->end());
+		return it->second;
+	}
+};
+
+} // namespace smd
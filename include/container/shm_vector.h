@@ -1,13 +1,30 @@
 ﻿#pragma once
+#include <type_traits>
+#include <utility>
 #include <container/shm_pointer.h>
 
 namespace smd {
 
+// 把src处的count个元素搬到未初始化的dst处，搬完之后src处的元素已经析构
+// 可平凡拷贝的类型直接memcpy，其它类型逐个移动构造后析构
+template <class T>
+void relocate_n(T* src, size_t count, T* dst) {
+	if (std::is_trivially_copyable<T>::value) {
+		memcpy((void*)dst, (const void*)src, sizeof(T) * count);
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			::new (dst + i) T(std::move(src[i]));
+			src[i].~T();
+		}
+	}
+}
+
 template <class T>
 class shm_vector {
 	typedef T value_type;
 	typedef shm_pointer<T> iterator;
 	typedef T& reference;
+	typedef const T& const_reference;
 	typedef iterator pointer;
 
 public:
@@ -23,6 +40,11 @@ public:
 		}
 	}
 
+	// 移动时只交换偏移，对方变成没有分配空间的空vector
+	shm_vector(shm_vector&& r) noexcept {
+		swap(r);
+	}
+
 	shm_vector& operator=(const shm_vector& r) {
 		if (this != &r) {
 			shm_vector(r).swap(*this);
@@ -30,13 +52,19 @@ public:
 		return *this;
 	}
 
-	~shm_vector() {
-		while (!empty()) {
-			pop_back();
+	shm_vector& operator=(shm_vector&& r) noexcept {
+		if (this != &r) {
+			shm_vector(std::move(r)).swap(*this);
 		}
+		return *this;
+	}
 
-		//实际分配的空间比容量大1.
-		g_alloc->Free(m_start, capacity() + 1);
+	~shm_vector() {
+		clear();
+
+		if (m_start != shm_nullptr) {
+			g_alloc->Free(m_start, capacity());
+		}
 		m_finish = shm_nullptr;
 		m_end_of_storage = shm_nullptr;
 	}
@@ -45,7 +73,7 @@ public:
 		return m_finish - m_start;
 	}
 
-	bool empty() {
+	bool empty() const {
 		return m_finish == m_start;
 	}
 
@@ -55,36 +83,138 @@ public:
 
 	//访问元素相关
 	reference operator[](size_t i) {
-		return *m_start[i];
+		return m_start[i];
 	}
 
-	reference operator[](size_t i) const {
-		return *m_start[i];
+	const_reference operator[](size_t i) const {
+		return m_start[i];
 	}
 
 	reference front() {
-		return **m_start;
+		return *m_start;
 	}
 
 	reference back() {
-		return *(m_start[size() - 1]);
+		return m_start[size() - 1];
+	}
+
+	value_type* data() {
+		return m_start.Ptr();
+	}
+
+	const value_type* data() const {
+		return m_start.Ptr();
+	}
+
+	iterator begin() {
+		return m_start;
+	}
+
+	iterator end() {
+		return m_finish;
 	}
 
 	void push_back(const value_type& value) {
-		if (m_finish != m_end_of_storage) {
-			auto new_element = g_alloc->New<value_type>(value);
-			*m_finish = new_element;
-			++m_finish;
+		emplace_back(value);
+	}
+
+	void push_back(value_type&& value) {
+		emplace_back(std::move(value));
+	}
+
+	template <typename... P>
+	reference emplace_back(P&&... params) {
+		if (m_finish == m_end_of_storage && !try_expand(size() + 1)) {
+			// 参数可能引用了本容器中的元素，所以要先在新的空间中构造好，再搬迁旧元素
+			auto old_size = size();
+			auto new_start = allocate(recommend(old_size + 1));
+			::new ((new_start + old_size).Ptr()) value_type(std::forward<P>(params)...);
+			relocate(new_start, old_size);
+			m_finish = m_start + (old_size + 1);
+			return back();
+		}
+
+		::new (m_finish.Ptr()) value_type(std::forward<P>(params)...);
+		++m_finish;
+		return back();
+	}
+
+	// 在pos之前插入一个元素，返回指向新元素的迭代器
+	template <typename... P>
+	iterator emplace(iterator pos, P&&... params) {
+		const size_t index = pos - m_start;
+		assert(index <= size());
+		if (index == size()) {
+			emplace_back(std::forward<P>(params)...);
+			return m_start + index;
+		}
+
+		// 先构造出来，参数引用的元素在搬迁之后就失效了
+		value_type tmp(std::forward<P>(params)...);
+		if (m_finish == m_end_of_storage && !try_expand(size() + 1)) {
+			auto new_start = allocate(recommend(size() + 1));
+			auto old_size = size();
+			relocate(new_start, old_size);
+			m_finish = m_start + old_size;
+		}
+
+		value_type* first = (m_start + index).Ptr();
+		value_type* last = m_finish.Ptr();
+		if (std::is_trivially_copyable<value_type>::value) {
+			memmove((void*)(first + 1), (const void*)first, sizeof(value_type) * (last - first));
+			::new (first) value_type(std::move(tmp));
+		} else {
+			::new (last) value_type(std::move(*(last - 1)));
+			for (value_type* p = last - 1; p != first; --p) {
+				*p = std::move(*(p - 1));
+			}
+			*first = std::move(tmp);
+		}
+
+		++m_finish;
+		return m_start + index;
+	}
+
+	iterator insert(iterator pos, const value_type& value) {
+		return emplace(pos, value);
+	}
+
+	iterator insert(iterator pos, value_type&& value) {
+		return emplace(pos, std::move(value));
+	}
+
+	// 删除pos处的元素，返回指向下一个元素的迭代器
+	iterator erase(iterator pos) {
+		return erase(pos, pos + 1);
+	}
+
+	iterator erase(iterator first, iterator last) {
+		assert(first - m_start >= 0 && last - first >= 0 && m_finish - last >= 0);
+		const size_t count = last - first;
+		if (count == 0)
+			return first;
+
+		value_type* dst = first.Ptr();
+		value_type* src = last.Ptr();
+		value_type* finish = m_finish.Ptr();
+		if (std::is_trivially_copyable<value_type>::value) {
+			memmove((void*)dst, (const void*)src, sizeof(value_type) * (finish - src));
 		} else {
-			reserve(capacity() + 2);
-			push_back(value);
+			for (; src != finish; ++dst, ++src) {
+				*dst = std::move(*src);
+			}
+			for (; dst != finish; ++dst) {
+				dst->~value_type();
+			}
 		}
+
+		m_finish = m_finish + (-int64_t(count));
+		return first;
 	}
 
 	void pop_back() {
 		--m_finish;
-		auto d = *m_finish;
-		g_alloc->Delete(d);
+		(m_finish.Ptr())->~value_type();
 	}
 
 	void clear() {
@@ -95,19 +225,38 @@ public:
 
 	// 设置容量
 	void reserve(size_t new_capacity) {
+		if (m_start != shm_nullptr && new_capacity <= capacity())
+			return;
+		if (try_expand(new_capacity))
+			return;
+
 		auto old_size = size();
-		new_capacity = GetSuitableCapacity(std::max(old_size, new_capacity));
+		auto new_start = allocate(std::max(old_size, new_capacity));
+		relocate(new_start, old_size);
+		m_finish = m_start + old_size;
+	}
 
-		//多分配一个，用来存放尾结点
-		auto new_list = g_alloc->Malloc<shm_pointer<value_type>>(new_capacity + 1);
-		if (old_size > 0) {
-			memcpy(new_list.Ptr(), m_start.Ptr(), sizeof(shm_pointer<value_type>) * old_size);
-			g_alloc->Free(m_start, capacity() + 1);
+	// 释放多余的容量
+	void shrink_to_fit() {
+		auto old_size = size();
+		if (old_size == 0) {
+			if (m_start != shm_nullptr) {
+				g_alloc->Free(m_start, capacity());
+			}
+			m_finish = shm_nullptr;
+			m_end_of_storage = shm_nullptr;
+			return;
 		}
 
-		m_start = new_list;
+		auto new_start = allocate(old_size);
+		if (g_alloc->GetCapacity(new_start) >= capacity()) {
+			// 块的大小没有变化，不用搬迁
+			g_alloc->Free(new_start, old_size);
+			return;
+		}
+
+		relocate(new_start, old_size);
 		m_finish = m_start + old_size;
-		m_end_of_storage = m_start + new_capacity;
 	}
 
 	// 改变vector中元素的数目
@@ -146,20 +295,45 @@ private:
 		std::swap(m_end_of_storage, x.m_end_of_storage);
 	}
 
-	size_t GetSuitableCapacity(size_t size) {
-		if (size < 1)
-			size = 1;
-		return util::Utility::NextPowOf2(uint32_t(size));
+	// 按几何级数增长，保证push_back的均摊复杂度是O(1)
+	size_t recommend(size_t new_size) const {
+		return std::max(new_size, capacity() * 2);
 	}
 
-	void shrink_to_fit() {
-		// 在此添加代码缩容
+	shm_pointer<value_type> allocate(size_t n) {
+		return g_alloc->Malloc<value_type>(n < 1 ? 1 : n);
+	}
+
+	// 伙伴块后面紧挨着的兄弟块如果空闲，直接合并，不用搬迁元素
+	bool try_expand(size_t new_capacity) {
+		if (m_start == shm_nullptr)
+			return false;
+
+		if (!g_alloc->TryExpand(m_start, recommend(new_capacity)))
+			return false;
+
+		m_end_of_storage = m_start + g_alloc->GetCapacity(m_start);
+		return true;
+	}
+
+	// 把现有的count个元素搬到新的空间，并释放旧空间，容量按实际分到的块大小计算
+	void relocate(shm_pointer<value_type> new_start, size_t count) {
+		if (m_start != shm_nullptr) {
+			if (count > 0) {
+				relocate_n(m_start.Ptr(), count, new_start.Ptr());
+			}
+
+			g_alloc->Free(m_start, capacity());
+		}
+
+		m_start = new_start;
+		m_end_of_storage = m_start + g_alloc->GetCapacity(m_start);
 	}
 
 private:
-	shm_pointer<shm_pointer<value_type>> m_start = shm_nullptr;
-	shm_pointer<shm_pointer<value_type>> m_finish = shm_nullptr;
-	shm_pointer<shm_pointer<value_type>> m_end_of_storage = shm_nullptr;
+	shm_pointer<value_type> m_start = shm_nullptr;
+	shm_pointer<value_type> m_finish = shm_nullptr;
+	shm_pointer<value_type> m_end_of_storage = shm_nullptr;
 };
 
 } // namespace smd
@@ -7,10 +7,15 @@ namespace smd {
 
 class Alloc {
 public:
+	// 数据区的起始地址按缓存行对齐，伙伴算法分出的块都是按自身大小对齐的偏移，这样块的地址也是对齐的
+	// 原子变量、futex等待的字段不会跨缓存行，也不会因为地址不对齐而失败
+	static constexpr size_t kStorageAlign = 64;
+
 	Alloc(void* ptr, size_t off_set, unsigned level, bool attached) {
 		const char* base_ptr = (const char*)ptr + off_set;
 		m_buddy = (SmdBuddyAlloc::buddy*)base_ptr;
-		g_storage_ptr = base_ptr + SmdBuddyAlloc::get_index_size(level);
+		const size_t storage_off = off_set + SmdBuddyAlloc::get_index_size(level);
+		g_storage_ptr = (const char*)ptr + ((storage_off + kStorageAlign - 1) & ~(kStorageAlign - 1));
 
 		if (!attached) {
 			m_buddy = SmdBuddyAlloc::buddy_new(base_ptr, level);
@@ -31,6 +36,26 @@ public:
 		return shm_pointer<T>(addr);
 	}
 
+	// 实际分配到的块可以容纳多少个T，伙伴算法会把大小向上取整为2的幂
+	template <class T>
+	size_t GetCapacity(const shm_pointer<T>& p) const {
+		return size_t(SmdBuddyAlloc::buddy_size(m_buddy, int(p.Raw()))) / sizeof(T);
+	}
+
+	// 尝试原地扩容到n个T，成功之后p的位置不变
+	template <class T>
+	bool TryExpand(const shm_pointer<T>& p, size_t n) {
+		assert(p != shm_nullptr && p != 0);
+		auto old_size = SmdBuddyAlloc::buddy_size(m_buddy, int(p.Raw()));
+		if (!SmdBuddyAlloc::buddy_expand(m_buddy, int(p.Raw()), uint32_t(sizeof(T) * n)))
+			return false;
+
+		auto new_size = SmdBuddyAlloc::buddy_size(m_buddy, int(p.Raw()));
+		SMD_LOG_DEBUG("expand: 0x%08x:(%d->%d)", p.Raw(), old_size, new_size);
+		m_used += new_size - old_size;
+		return true;
+	}
+
 	template <class T>
 	void Free(shm_pointer<T>& p, size_t n = 1) {
 		assert(p != shm_nullptr && p != 0);
@@ -80,14 +105,14 @@ private:
 		}
 
 		SMD_LOG_DEBUG("malloc: 0x%08x:(%llu)", off_set, size);
-		m_used += size;
+		// 按实际占用的块大小统计，这样原地扩容或者利用了块内余量之后仍然能对得上
+		m_used += SmdBuddyAlloc::block_size(uint32_t(size));
 		return off_set;
 	}
 
 	void _Free(int64_t off_set, size_t size) {
 		SMD_LOG_DEBUG("free: 0x%08x:(%llu)", off_set, size);
-		m_used -= size;
-		SmdBuddyAlloc::buddy_free(m_buddy, int(off_set));
+		m_used -= SmdBuddyAlloc::buddy_free(m_buddy, int(off_set));
 	}
 
 private:
@@ -44,8 +44,13 @@ public:
 		return self;
 	}
 
+	// 申请s字节实际占用的块大小
+	static uint32_t block_size(uint32_t s) {
+		return s == 0 ? 1 : next_pow_of_2(s);
+	}
+
 	static int buddy_alloc(buddy* self, uint32_t s) {
-		const uint32_t size = s == 0 ? 1 : next_pow_of_2(s);
+		const uint32_t size = block_size(s);
 		uint32_t length = 1 << self->level;
 
 		// 空间不够了
@@ -100,7 +105,8 @@ public:
 		return -1;
 	}
 
-	static void buddy_free(buddy* self, int offset) {
+	// 返回释放的块大小
+	static int buddy_free(buddy* self, int offset) {
 		assert(offset < (1 << self->level));
 		int left = 0;
 		int length = 1 << self->level;
@@ -111,10 +117,10 @@ public:
 			case NODE_USED:
 				assert(offset == left);
 				_combine(self, index);
-				return;
+				return length;
 			case NODE_UNUSED:
 				assert(0);
-				return;
+				return 0;
 			default:
 				length /= 2;
 				if (offset < left + length) {
@@ -155,6 +161,54 @@ public:
 		}
 	}
 
+	// 尝试原地扩容：只要当前块是左孩子并且兄弟块空闲，就可以和兄弟合并成大一倍的块
+	// 成功返回true，失败的时候不修改任何状态
+	static bool buddy_expand(buddy* self, int offset, uint32_t s) {
+		assert(offset < (1 << self->level));
+		const uint32_t size = block_size(s);
+		if (size > (uint32_t(1) << self->level))
+			return false;
+
+		int left = 0;
+		uint32_t length = 1 << self->level;
+		int index = 0;
+
+		for (;;) {
+			if (self->tree[index] == NODE_USED) {
+				assert(offset == left);
+				break;
+			}
+
+			if (self->tree[index] == NODE_UNUSED) {
+				assert(0);
+				return false;
+			}
+
+			length /= 2;
+			if (offset < left + int(length)) {
+				index = index * 2 + 1;
+			} else {
+				left += length;
+				index = index * 2 + 2;
+			}
+		}
+
+		if (length >= size)
+			return true;
+
+		// 先检查，再修改
+		int target = index;
+		for (uint32_t l = length; l < size; l *= 2) {
+			if ((target & 1) == 0 || self->tree[target + 1] != NODE_UNUSED)
+				return false;
+			target = (target + 1) / 2 - 1;
+		}
+
+		self->tree[target] = NODE_USED;
+		_mark_parent(self, target);
+		return true;
+	}
+
 	static void _dump(buddy* self, int index, int level) {
 		switch (self->tree[index]) {
 		case NODE_UNUSED:
@@ -2,9 +2,19 @@
 #include <time.h>
 #include <container/shm_string.h>
 #include <container/shm_list.h>
+#include <container/shm_intrusive_list.h>
+#include <container/shm_deque.h>
+#include <container/shm_ring.h>
+#include <container/shm_change_log.h>
 #include <container/shm_vector.h>
+#include <container/shm_array.h>
+#include <container/shm_small_vector.h>
 #include <container/shm_hash.h>
+#include <container/shm_unordered_map.h>
+#include <container/shm_intern_string.h>
+#include <container/shm_flat_hash.h>
 #include <container/shm_map.h>
+#include <container/shm_btree_map.h>
 #include <common/slice.h>
 #include <mem_alloc/shm_handle.h>
 
@@ -17,6 +27,7 @@ struct ShmHead {
 	time_t last_visit_time;
 	uint32_t visit_num;
 	int shm_key;
+	shm_pointer<shm_string_pool> string_pool;
 	shm_pointer<T> entry;
 };
 
@@ -50,13 +61,20 @@ Env<T>::Env(void* ptr, bool is_attached)
 	m_head.visit_num++;
 	m_head.last_visit_time = time(nullptr);
 	if (!is_attached) {
+		// 字符串池要先于entry创建，entry构造的时候可能就会用到
+		m_head.string_pool = g_alloc->New<shm_string_pool>();
+		g_string_pool = m_head.string_pool.Ptr();
 		m_head.entry = g_alloc->New<T>();
+	} else {
+		g_string_pool = m_head.string_pool.Ptr();
 	}
 }
 
 template <typename T>
 Env<T>* Env<T>::Create(int shm_key, unsigned level, bool enable_attach) {
-	size_t size = sizeof(ShmHead<T>) + SmdBuddyAlloc::get_index_size(level) + SmdBuddyAlloc::get_storage_size(level);
+	// 多留出数据区对齐需要的空间
+	size_t size = sizeof(ShmHead<T>) + SmdBuddyAlloc::get_index_size(level) + Alloc::kStorageAlign +
+				  SmdBuddyAlloc::get_storage_size(level);
 	auto [ptr, is_attached] = g_shmHandle.acquire(shm_key, size, enable_attach);
 	if (ptr == nullptr) {
 		SMD_LOG_ERROR("acquire failed, key:%d, size:%llu", shm_key, size);
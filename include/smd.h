@@ -4,7 +4,7 @@
 namespace smd {
 
 struct StSmd {
-	shm_map<shm_string, shm_string> all_strings;
+	shm_unordered_map<shm_string, shm_string> all_strings;
 	shm_map<shm_string, shm_list<shm_string>> all_lists;
 	shm_map<shm_string, shm_map<shm_string, shm_string>> all_maps;
 	shm_map<shm_string, shm_hash<shm_string>> all_hashes;
@@ -15,7 +15,7 @@ public:
 	//
 	// 内置string, list, map, hash 四种基本数据类型
 	//
-	shm_map<shm_string, shm_string>& GetAllStrings() {
+	shm_unordered_map<shm_string, shm_string>& GetAllStrings() {
 		return GetEntry().all_strings;
 	}
 
@@ -45,21 +45,22 @@ public:
 // 写操作
 void SmdEnv::SSet(const Slice& key, const Slice& value) {
 	auto& all_strings = GetAllStrings();
-	shm_string str_key(key.data(), key.size());
-	auto it = all_strings.find(str_key);
+	auto it = all_strings.find(key);
 	if (it == all_strings.end()) {
-		shm_string str_value(value.data(), value.size());
-		all_strings.insert(std::make_pair(str_key, str_value));
+		// key和value直接在节点中构造，不需要临时对象
+		all_strings.emplace(std::piecewise_construct, std::forward_as_tuple(key.data(), key.size()),
+			std::forward_as_tuple(value.data(), value.size()));
 	} else {
-		it->second = value.ToString();
+		// 原有空间放得下时直接覆盖，频繁更新的key不会分配内存
+		it->second.assign(value);
 	}
 }
 
 // 读操作
 bool SmdEnv::SGet(const Slice& key, Slice* value) {
+	// 直接用Slice查找，读操作不会分配共享内存
 	auto& all_strings = GetAllStrings();
-	shm_string str_value(key.data(), key.size());
-	auto it = all_strings.find(str_value);
+	auto it = all_strings.find(key);
 	if (it == all_strings.end()) {
 		return false;
 	} else {
@@ -77,13 +78,6 @@ bool SmdEnv::SGet(const Slice& key, Slice* value) {
 // 删除操作
 bool SmdEnv::SDel(const Slice& key) {
 	auto& all_strings = GetAllStrings();
-	shm_string str_value(key.data(), key.size());
-	auto it = all_strings.find(str_value);
-	if (it == all_strings.end()) {
-		return false;
-	}
-
-	it = all_strings.erase(it);
-	return true;
+	return all_strings.erase(key) > 0;
 }
 } // namespace smd